@@ -4,36 +4,79 @@
 
 #include "bench.h"
 
+#include <algorithm>
 #include <iostream>
 #include <sys/time.h>
 
 using namespace benchmark;
 
-std::map<std::string, BenchFunction> BenchRunner::benchmarks;
+// Constructed on first use, benchmarks register from static initializers
+std::map<std::string, BenchFunction>& BenchRunner::benchmarks()
+{
+    static std::map<std::string, BenchFunction> benchmarks;
+    return benchmarks;
+}
 
 static double gettimedouble(void) {
     struct timeval tv;
     gettimeofday(&tv, NULL);
     return tv.tv_usec * 0.000001 + tv.tv_sec;
 }
+
+// Nearest-rank percentile of sorted samples
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    size_t rank = (size_t)(p * sorted.size() + 0.5);
+    return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+static void PrintResult(const Result& result, OutputFormat format, bool fFirst)
+{
+    if (format == FORMAT_JSON) {
+        std::cout << (fFirst ? "" : ",\n")
+                  << "  {\"name\": \"" << result.name << "\", \"count\": " << result.count
+                  << ", \"min\": " << result.minTime << ", \"max\": " << result.maxTime
+                  << ", \"average\": " << result.average << ", \"median\": " << result.median
+                  << ", \"p90\": " << result.p90 << ", \"p99\": " << result.p99 << "}";
+    } else {
+        std::cout << result.name << "," << result.count << "," << result.minTime << "," << result.maxTime << ","
+                  << result.average << "," << result.median << "," << result.p90 << "," << result.p99 << "\n";
+    }
+    std::cout.flush();
+}
+
 /*set callback function for bench call */
 BenchRunner::BenchRunner(std::string name, BenchFunction func)
 {
-    benchmarks.insert(std::make_pair(name, func));
+    benchmarks().insert(std::make_pair(name, func));
 }
 
 void
-BenchRunner::RunAll(double elapsedTimeForOne)
+BenchRunner::RunAll(double elapsedTimeForOne, OutputFormat format, const std::string& filter)
 {
-    std::cout << "Benchmark" << "," << "count" << "," << "min" << "," << "max" << "," << "average" << "\n";
+    if (format == FORMAT_JSON)
+        std::cout << "[\n";
+    else
+        std::cout << "Benchmark" << "," << "count" << "," << "min" << "," << "max" << "," << "average"
+                  << "," << "median" << "," << "p90" << "," << "p99" << "\n";
 
-    for (std::map<std::string,BenchFunction>::iterator it = benchmarks.begin();
-         it != benchmarks.end(); ++it) {
+    bool fFirst = true;
+    for (std::map<std::string,BenchFunction>::iterator it = benchmarks().begin();
+         it != benchmarks().end(); ++it) {
 
+        if (it->first.find(filter) == std::string::npos)
+            continue;
         State state(it->first, elapsedTimeForOne);
         BenchFunction& func = it->second;
         func(state);
+        PrintResult(state.result, format, fFirst);
+        fFirst = false;
     }
+
+    if (format == FORMAT_JSON)
+        std::cout << "\n]\n";
 }
 
 bool State::KeepRunning()
@@ -53,6 +96,7 @@ bool State::KeepRunning()
         double elapsedOne = (now - lastTime)/timeCheckCount;
         if (elapsedOne < minTime) minTime = elapsedOne;
         if (elapsedOne > maxTime) maxTime = elapsedOne;
+        samples.push_back(elapsedOne);
         if (elapsedOne*timeCheckCount < maxElapsed/16) timeCheckCount *= 2;
     }
     lastTime = now;
@@ -62,9 +106,16 @@ bool State::KeepRunning()
 
     --count;
 
-    // Output results
-    double average = (now-beginTime)/count;
-    std::cout << name << "," << count << "," << minTime << "," << maxTime << "," << average << "\n";
+    // Record results
+    std::sort(samples.begin(), samples.end());
+    result.name = name;
+    result.count = count;
+    result.minTime = minTime;
+    result.maxTime = maxTime;
+    result.average = (now-beginTime)/count;
+    result.median = percentile(samples, 0.5);
+    result.p90 = percentile(samples, 0.9);
+    result.p99 = percentile(samples, 0.99);
 
     return false;
 }
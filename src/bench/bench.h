@@ -5,8 +5,10 @@
 #ifndef BITCOIN_BENCH_BENCH_H
 #define BITCOIN_BENCH_BENCH_H
 
+#include <limits>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <boost/function.hpp>
 #include <boost/preprocessor/cat.hpp>
@@ -36,6 +38,16 @@ BENCHMARK(CODE_TO_TIME);
  
 namespace benchmark {
 
+    /** Timings of one benchmark, in seconds per iteration */
+    struct Result {
+        std::string name;
+        int64_t count;
+        double minTime, maxTime, average;
+        double median, p90, p99;
+
+        Result() : count(0), minTime(0), maxTime(0), average(0), median(0), p90(0), p99(0) {}
+    };
+
     class State {
         std::string name;
         double maxElapsed;
@@ -43,25 +55,36 @@ namespace benchmark {
         double lastTime, minTime, maxTime;
         int64_t count;
         int64_t timeCheckCount;
+        // Per-iteration time of every timed batch, for the percentiles
+        std::vector<double> samples;
     public:
+        Result result;
+
         State(std::string _name, double _maxElapsed) : name(_name), maxElapsed(_maxElapsed), count(0) {
             minTime = std::numeric_limits<double>::max();
             maxTime = std::numeric_limits<double>::min();
             timeCheckCount = 1;
+            result.name = name;
         }
         bool KeepRunning();
     };
 
     typedef boost::function<void(State&)> BenchFunction;
 
+    enum OutputFormat {
+        FORMAT_CSV,
+        FORMAT_JSON,
+    };
+
     class BenchRunner
     {
-        static std::map<std::string, BenchFunction> benchmarks;
+        static std::map<std::string, BenchFunction>& benchmarks();
 
     public:
         BenchRunner(std::string name, BenchFunction func);
 
-        static void RunAll(double elapsedTimeForOne=1.0);
+        /** Run the benchmarks whose name contains `filter` and print their results to stdout */
+        static void RunAll(double elapsedTimeForOne=1.0, OutputFormat format=FORMAT_CSV, const std::string& filter="");
     };
 }
 
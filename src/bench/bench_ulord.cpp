@@ -4,18 +4,42 @@
 
 #include "bench.h"
 
+#include "crypto/sha256.h"
 #include "key.h"
 #include "main.h"
 #include "util.h"
 
+#include <iostream>
+
 int
 main(int argc, char** argv)
 {
+    SHA256AutoDetect();
     ECC_Start();
     SetupEnvironment();
     fPrintToDebugLog = false; // don't want to write to debug.log file
+    ParseParameters(argc, argv);
+
+    if (mapArgs.count("-?") || mapArgs.count("-help")) {
+        std::cout << "Usage: bench_ulord [options]\n\n"
+                  << "  -filter=<text>    Only run the benchmarks whose name contains <text>\n"
+                  << "  -format=<format>  Output format, csv or json (default: csv)\n"
+                  << "  -time=<secs>      Time to spend on each benchmark (default: 1)\n"
+                  << "\nTimes are in seconds per iteration. median, p90 and p99 are taken over\n"
+                  << "the timed batches of iterations.\n";
+        ECC_Stop();
+        return 0;
+    }
 
-    benchmark::BenchRunner::RunAll();
+    std::string strFormat = GetArg("-format", "csv");
+    if (strFormat != "csv" && strFormat != "json") {
+        std::cerr << "Error: unknown -format " << strFormat << "\n";
+        ECC_Stop();
+        return 1;
+    }
+    benchmark::BenchRunner::RunAll(atof(GetArg("-time", "1").c_str()),
+        strFormat == "json" ? benchmark::FORMAT_JSON : benchmark::FORMAT_CSV,
+        GetArg("-filter", ""));
 
     ECC_Stop();
 }
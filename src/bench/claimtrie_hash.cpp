@@ -0,0 +1,87 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "claimtrie.h"
+#include "nameclaim.h"
+#include "random.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+// Merkle root recomputation after a block's worth of claims lands on a trie
+// that already holds a few thousand names. One iteration applies
+// CLAIMS_PER_BLOCK random claims to a fresh cache and hashes it.
+
+static const int TRIE_NAMES = 5000;
+static const int CLAIMS_PER_BLOCK = 200;
+
+static std::string RandomName()
+{
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789-";
+    std::string name(4 + insecure_rand() % 12, ' ');
+    for (size_t i = 0; i < name.size(); ++i)
+        name[i] = alphabet[insecure_rand() % (sizeof(alphabet) - 1)];
+    return name;
+}
+
+static void InsertRandomClaims(CClaimTrieCache& trieCache, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        COutPoint outPoint(GetRandHash(), 0);
+        std::string name = RandomName();
+        CClaimValue claim(outPoint, ClaimIdHash(outPoint.hash, outPoint.n), 1 + insecure_rand() % 1000, 1, 1, "", name);
+        trieCache.insertClaimIntoTrie(name, claim);
+    }
+}
+
+static void ClaimTrieMerkleHash(benchmark::State& state, int nThreads)
+{
+    boost::filesystem::path pathTemp = GetTempPath() / strprintf("bench_ulord_%lu_%i", (unsigned long)GetTime(), (int)(GetRand(100000)));
+    boost::filesystem::create_directories(pathTemp);
+    mapArgs["-datadir"] = pathTemp.string();
+    ClearDatadirCache();
+
+    boost::thread_group threadGroup;
+    for (int i = 0; i < nThreads - 1; ++i)
+        threadGroup.create_thread(&ThreadClaimTrieHash);
+    nClaimTrieHashThreads = nThreads;
+
+    {
+        seed_insecure_rand(true);
+        CClaimTrie trie(true, false, 1);
+        CClaimTrieCache base(&trie, false);
+        InsertRandomClaims(base, TRIE_NAMES);
+        base.getMerkleHash();
+        base.flush();
+
+        while (state.KeepRunning()) {
+            CClaimTrieCache trieCache(&trie, false);
+            InsertRandomClaims(trieCache, CLAIMS_PER_BLOCK);
+            trieCache.getMerkleHash();
+        }
+    }
+
+    nClaimTrieHashThreads = 0;
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    mapArgs.erase("-datadir");
+    ClearDatadirCache();
+    boost::filesystem::remove_all(pathTemp);
+}
+
+static void ClaimTrieMerkleHashSerial(benchmark::State& state)
+{
+    ClaimTrieMerkleHash(state, 0);
+}
+
+static void ClaimTrieMerkleHashParallel(benchmark::State& state)
+{
+    ClaimTrieMerkleHash(state, std::max(2, (int)boost::thread::hardware_concurrency()));
+}
+
+BENCHMARK(ClaimTrieMerkleHashSerial);
+BENCHMARK(ClaimTrieMerkleHashParallel);
@@ -0,0 +1,57 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "consensus/merkle.h"
+#include "crypto/sha256.h"
+#include "hash.h"
+#include "random.h"
+#include "uint256.h"
+
+#include <vector>
+
+// SHA-256 with whichever transforms SHA256AutoDetect() picked in main().
+
+static const uint64_t BUFFER_SIZE = 1000 * 1000;
+
+static void SHA256(benchmark::State& state)
+{
+    uint8_t hash[CSHA256::OUTPUT_SIZE];
+    std::vector<uint8_t> in(BUFFER_SIZE, 0);
+    while (state.KeepRunning())
+        CSHA256().Write(in.data(), in.size()).Finalize(hash);
+}
+
+static void SHA256_32b(benchmark::State& state)
+{
+    std::vector<uint8_t> in(32, 0);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 1000; ++i)
+            CSHA256().Write(in.data(), in.size()).Finalize(in.data());
+    }
+}
+
+static void SHA256D64_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> in(64 * 1024, 0);
+    while (state.KeepRunning())
+        SHA256D64(in.data(), in.data(), 1024);
+}
+
+// The root of a block of 2000 transactions.
+static void MerkleRoot(benchmark::State& state)
+{
+    std::vector<uint256> leaves(2000);
+    for (size_t i = 0; i < leaves.size(); ++i)
+        leaves[i] = GetRandHash();
+    while (state.KeepRunning()) {
+        bool mutated = false;
+        leaves[0] = ComputeMerkleRoot(leaves, &mutated);
+    }
+}
+
+BENCHMARK(SHA256);
+BENCHMARK(SHA256_32b);
+BENCHMARK(SHA256D64_1024);
+BENCHMARK(MerkleRoot);
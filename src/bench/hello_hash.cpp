@@ -0,0 +1,224 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "checkqueue.h"
+#include "hash.h"
+#include "primitives/block.h"
+#include "tinyformat.h"
+
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+// Hello PoW throughput. The reported average is the time for one hash, so
+// hashes/s is its inverse.
+
+static void HelloHashInput(std::vector<uint8_t>& input, uint32_t nonce)
+{
+    input.assign(INPUT_LEN, 0);
+    for (size_t i = 0; i < input.size(); ++i)
+        input[i] = (uint8_t)(i * 31);
+    memcpy(&input[INPUT_LEN - sizeof(nonce)], &nonce, sizeof(nonce));
+}
+
+// Reference for the old per-call cost: a fresh zeroed 1 MiB arena and a
+// rebuild of the one-way function tables for every hash.
+static void HelloHashFreshArena(benchmark::State& state)
+{
+    std::vector<uint8_t> input;
+    uint8_t output[OUTPUT_LEN];
+    uint32_t nonce = 0;
+    while (state.KeepRunning()) {
+        HelloHashInput(input, nonce++);
+        initOneWayFunction();
+        helloContext* ctx = helloCreateContext();
+        helloHashWithContext(ctx, &input[0], INPUT_LEN, output);
+        helloFreeContext(ctx);
+    }
+}
+
+static void HelloHashThreadArena(benchmark::State& state)
+{
+    std::vector<uint8_t> input;
+    uint8_t output[OUTPUT_LEN];
+    uint32_t nonce = 0;
+    while (state.KeepRunning()) {
+        HelloHashInput(input, nonce++);
+        helloHash(&input[0], INPUT_LEN, output);
+    }
+}
+
+// One iteration hashes HELLO_BATCH_LANES nonces.
+static void HelloHashBatchLanes(benchmark::State& state)
+{
+    std::vector<uint8_t> input;
+    uint8_t output[HELLO_BATCH_LANES * OUTPUT_LEN];
+    uint32_t nonce = 0;
+    helloContext* ctx = helloGetThreadContext();
+    while (state.KeepRunning()) {
+        HelloHashInput(input, nonce);
+        helloHashBatch(ctx, &input[0], HELLO_BATCH_LANES, output);
+        nonce += HELLO_BATCH_LANES;
+    }
+}
+
+static void HelloBlockHeaderGetHash(benchmark::State& state)
+{
+    CBlockHeader header;
+    header.nVersion = 1;
+    header.nTime = 1524057440;
+    header.nBits = 0x1f00ffff;
+    uint32_t nonce = 0;
+    while (state.KeepRunning()) {
+        header.nNonce = ArithToUint256(arith_uint256(nonce++));
+        header.GetHash();
+    }
+}
+
+// The three steps of powFunction on their own, with the parameters it uses.
+static void HelloInitWorkMemory(benchmark::State& state)
+{
+    std::vector<uint8_t> input;
+    helloContext* ctx = helloCreateContext();
+    uint32_t nonce = 0;
+    helloInit();
+    while (state.KeepRunning()) {
+        HelloHashInput(input, nonce++);
+        initWorkMemory(&input[0], INPUT_LEN, ctx->Maddr, 128);
+    }
+    helloFreeContext(ctx);
+}
+
+static void HelloModifyWorkMemory(benchmark::State& state)
+{
+    std::vector<uint8_t> input;
+    helloContext* ctx = helloCreateContext();
+    uint8_t c[OUTPUT_LEN];
+    helloInit();
+    HelloHashInput(input, 0);
+    initWorkMemory(&input[0], INPUT_LEN, ctx->Maddr, 128);
+    while (state.KeepRunning()) {
+        modifyWorkMemory(ctx->Maddr, 4, WORK_MEMORY_SIZE >> 11, c);
+    }
+    helloFreeContext(ctx);
+}
+
+static void HelloCalculateFinalResult(benchmark::State& state)
+{
+    std::vector<uint8_t> input;
+    helloContext* ctx = helloCreateContext();
+    uint8_t c[OUTPUT_LEN], output[OUTPUT_LEN];
+    helloInit();
+    HelloHashInput(input, 0);
+    initWorkMemory(&input[0], INPUT_LEN, ctx->Maddr, 128);
+    modifyWorkMemory(ctx->Maddr, 4, WORK_MEMORY_SIZE >> 11, c);
+    while (state.KeepRunning()) {
+        calculateFinalResult(ctx->Maddr, c, 8, output);
+    }
+    helloFreeContext(ctx);
+}
+
+// One of the funcInfor one-way functions on a 32 byte input, the size
+// modifyWorkMemory feeds them. Each output is the next input.
+static void HelloOneWayFunction(benchmark::State& state, int nFunction)
+{
+    uint8_t data[OUTPUT_LEN], output[OUTPUT_LEN];
+    for (int i = 0; i < OUTPUT_LEN; ++i)
+        data[i] = (uint8_t)i;
+    helloInit();
+    while (state.KeepRunning()) {
+        funcInfor[nFunction].func32(data, output);
+        memcpy(data, output, OUTPUT_LEN);
+    }
+}
+
+// Throughput scaling over cores: one iteration is HASHES_PER_THREAD hashes
+// on each of nThreads threads, so with perfect scaling the average stays
+// flat as nThreads grows.
+static const int HASHES_PER_THREAD = 4;
+
+class CHelloHashCheck
+{
+private:
+    uint32_t nFirstNonce;
+
+public:
+    CHelloHashCheck() : nFirstNonce(0) {}
+    CHelloHashCheck(uint32_t nFirstNonceIn) : nFirstNonce(nFirstNonceIn) {}
+
+    bool operator()()
+    {
+        std::vector<uint8_t> input;
+        uint8_t output[OUTPUT_LEN];
+        for (int i = 0; i < HASHES_PER_THREAD; ++i) {
+            HelloHashInput(input, nFirstNonce + i);
+            helloHash(&input[0], INPUT_LEN, output);
+        }
+        return true;
+    }
+
+    void swap(CHelloHashCheck& check)
+    {
+        std::swap(nFirstNonce, check.nFirstNonce);
+    }
+};
+
+static void HelloHashRound(CCheckQueue<CHelloHashCheck>& queue, int nThreads, uint32_t& nonce)
+{
+    std::vector<CHelloHashCheck> vChecks;
+    for (int i = 0; i < nThreads; ++i) {
+        vChecks.push_back(CHelloHashCheck(nonce));
+        nonce += HASHES_PER_THREAD;
+    }
+    CCheckQueueControl<CHelloHashCheck> control(&queue);
+    control.Add(vChecks);
+    control.Wait();
+}
+
+// The workers are started once, before timing starts, and reused for every
+// round so that only the hashing is measured. The calling thread is one of
+// the nThreads, as in block validation.
+static void HelloHashThreads(benchmark::State& state, int nThreads)
+{
+    CCheckQueue<CHelloHashCheck> queue(1);
+    boost::thread_group threadGroup;
+    for (int i = 0; i < nThreads - 1; ++i)
+        threadGroup.create_thread(boost::bind(&CCheckQueue<CHelloHashCheck>::Thread, &queue));
+    uint32_t nonce = 0;
+    HelloHashRound(queue, nThreads, nonce);
+    while (state.KeepRunning())
+        HelloHashRound(queue, nThreads, nonce);
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+// Names and thread counts are only known at run time, so these register
+// themselves instead of going through BENCHMARK.
+static struct CHelloBenchRegistrar
+{
+    CHelloBenchRegistrar()
+    {
+        for (int i = 0; i < FUNCTION_NUM; ++i)
+            benchmark::BenchRunner(strprintf("HelloOneWay_%02d_%s", i, funcInfor[i].funcName),
+                boost::bind(&HelloOneWayFunction, _1, i));
+        int nCores = std::max(1, (int)boost::thread::hardware_concurrency());
+        for (int nThreads = 1; ; nThreads = std::min(nThreads * 2, nCores)) {
+            benchmark::BenchRunner(strprintf("HelloHashThreads_%03d", nThreads),
+                boost::bind(&HelloHashThreads, _1, nThreads));
+            if (nThreads == nCores)
+                break;
+        }
+    }
+} helloBenchRegistrar;
+
+BENCHMARK(HelloHashFreshArena);
+BENCHMARK(HelloHashThreadArena);
+BENCHMARK(HelloHashBatchLanes);
+BENCHMARK(HelloBlockHeaderGetHash);
+BENCHMARK(HelloInitWorkMemory);
+BENCHMARK(HelloModifyWorkMemory);
+BENCHMARK(HelloCalculateFinalResult);
@@ -0,0 +1,80 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "netbase.h"
+#include "socketevents.h"
+
+#include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+
+// One turn of ThreadSocketHandler's loop with many idle loopback peers and
+// one busy one: declare interest in every socket, wait, read the message.
+
+static const int IDLE_PEERS = 400;
+
+static void SocketEventsLoop(benchmark::State& state, const std::string& strName)
+{
+    boost::scoped_ptr<CSocketEvents> socketEvents(CreateSocketEvents(strName));
+    if (!socketEvents)
+        return;
+
+    SOCKET hListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(hListen, (struct sockaddr*)&addr, len) == SOCKET_ERROR ||
+        getsockname(hListen, (struct sockaddr*)&addr, &len) == SOCKET_ERROR ||
+        listen(hListen, SOMAXCONN) == SOCKET_ERROR)
+        return;
+
+    std::vector<SOCKET> vClients, vServers;
+    for (int i = 0; i <= IDLE_PEERS; i++) {
+        SOCKET hClient = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (connect(hClient, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR)
+            break;
+        vClients.push_back(hClient);
+        vServers.push_back(accept(hListen, NULL, NULL));
+        SetSocketNonBlocking(vServers.back(), true);
+    }
+    CloseSocket(hListen);
+
+    std::vector<int> vPrevEvents(vServers.size(), -1);
+    std::vector<std::pair<SOCKET, int> > vReady;
+    while (state.KeepRunning()) {
+        send(vClients[0], "x", 1, MSG_NOSIGNAL);
+        for (size_t i = 0; i < vServers.size(); i++) {
+            socketEvents->Watch(vServers[i], SOCKET_EVENT_RECV, vPrevEvents[i]);
+            vPrevEvents[i] = SOCKET_EVENT_RECV;
+        }
+        vReady.clear();
+        socketEvents->Wait(50, vReady);
+        char ch;
+        for (size_t i = 0; i < vReady.size(); i++)
+            recv(vReady[i].first, &ch, 1, MSG_DONTWAIT);
+    }
+
+    BOOST_FOREACH(SOCKET& s, vClients)
+        CloseSocket(s);
+    BOOST_FOREACH(SOCKET& s, vServers)
+        CloseSocket(s);
+}
+
+static void SocketEventsSelect(benchmark::State& state)
+{
+    SocketEventsLoop(state, "select");
+}
+
+BENCHMARK(SocketEventsSelect);
+
+#ifdef USE_EPOLL
+static void SocketEventsEpoll(benchmark::State& state)
+{
+    SocketEventsLoop(state, "epoll");
+}
+
+BENCHMARK(SocketEventsEpoll);
+#endif
@@ -141,6 +141,21 @@ public:
         return true;
     }
 
+    /**
+     * Like Get(), but also moves the item to the front so that it is pruned
+     * last. This turns the container into an LRU cache.
+     */
+    bool GetAndTouch(const K& key, V& value)
+    {
+        map_it it = mapIndex.find(key);
+        if(it == mapIndex.end()) {
+            return false;
+        }
+        listItems.splice(listItems.begin(), listItems, it->second);
+        value = it->second->value;
+        return true;
+    }
+
     void Erase(const K& key)
     {
         map_it it = mapIndex.find(key);
@@ -122,6 +122,10 @@ public:
     //! Byte offset within rev?????.dat where this block's undo data is stored
     unsigned int nUndoPos;
 
+    //! CRC32C of the block as stored in blk?????.dat, valid if fHaveDataChecksum is set
+    uint32_t nDataChecksum;
+    bool fHaveDataChecksum;
+
     //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
     arith_uint256 nChainWork;
 
@@ -157,6 +161,8 @@ public:
         nFile = 0;
         nDataPos = 0;
         nUndoPos = 0;
+        nDataChecksum = 0;
+        fHaveDataChecksum = false;
         nChainWork = arith_uint256();
         nTx = 0;
         nChainTx = 0;
@@ -359,6 +365,37 @@ public:
     }
 };
 
+/**
+ * Checksum of a stored block. It is kept under its own key next to the block
+ * index entry, so binaries that do not know about it neither read nor drop
+ * it. The position tells whether it still describes the stored data.
+ */
+class CDiskBlockChecksum
+{
+public:
+    int nFile;
+    unsigned int nDataPos;
+    uint32_t nChecksum;
+
+    CDiskBlockChecksum() : nFile(0), nDataPos(0), nChecksum(0) {}
+
+    explicit CDiskBlockChecksum(const CBlockIndex* pindex) :
+        nFile(pindex->nFile), nDataPos(pindex->nDataPos), nChecksum(pindex->nDataChecksum) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(VARINT(nFile));
+        READWRITE(VARINT(nDataPos));
+        READWRITE(nChecksum);
+    }
+
+    bool Matches(const CBlockIndex* pindex) const {
+        return (pindex->nStatus & BLOCK_HAVE_DATA) && pindex->nFile == nFile && pindex->nDataPos == nDataPos;
+    }
+};
+
 /** An in-memory indexed chain of blocks. */
 class CChain {
 private:
@@ -4,11 +4,14 @@
 
 #include "claimtrie.h"
 #include "coins.h"
+#include "checkqueue.h"
 #include "hash.h"
+#include "memusage.h"
 
 #include <boost/scoped_ptr.hpp>
 #include <iostream>
 #include <algorithm>
+#include <limits>
 
 std::vector<unsigned char> heightToVch(int n)
 {
@@ -107,6 +110,20 @@ bool CClaimTrieNode::getBestClaim(CClaimValue& claim) const
     }
 }
 
+CClaimTrieNodeVersion::CClaimTrieNodeVersion(const CClaimTrieNode& node) : hasValue(false), nHeightOfLastTakeover(0)
+{
+    children.reserve(node.children.size());
+    for (nodeMapType::const_iterator itChild = node.children.begin(); itChild != node.children.end(); ++itChild)
+        children.push_back(std::make_pair(itChild->first, itChild->second->hash));
+    CClaimValue claim;
+    if (node.getBestClaim(claim))
+    {
+        hasValue = true;
+        outPoint = claim.outPoint;
+        nHeightOfLastTakeover = node.nHeightOfLastTakeover;
+    }
+}
+
 bool CClaimTrieNode::haveClaim(const COutPoint& outPoint) const
 {
     for (std::vector<CClaimValue>::const_iterator itclaim = claims.begin(); itclaim != claims.end(); ++itclaim)
@@ -151,6 +168,166 @@ bool CClaimTrie::empty() const
     return root.empty();
 }
 
+/**
+ * The queues are stored one leveldb entry per claim or support. The key is
+ * the row the entry belongs to (a big-endian height or a name) followed by
+ * what tells entries of a row apart, so a row is read with one prefix seek
+ * and a changed row only writes the entries that differ.
+ */
+typedef std::pair<std::string, COutPoint> nameOutPointKeyType;
+typedef std::map<nameOutPointKeyType, CClaimValue> claimQueueEntriesType;
+typedef std::map<nameOutPointKeyType, CSupportValue> supportQueueEntriesType;
+typedef std::map<nameOutPointKeyType, char> expirationQueueEntriesType;
+typedef std::map<COutPoint, int> queueNameEntriesType;
+
+static CBigEndianHeight QueueKey(int nHeight)
+{
+    return CBigEndianHeight(nHeight);
+}
+
+static const std::string& QueueKey(const std::string& name)
+{
+    return name;
+}
+
+template<typename V>
+static void RowToEntries(const std::vector<std::pair<std::string, V> >& row, std::map<nameOutPointKeyType, V>& entries)
+{
+    for (typename std::vector<std::pair<std::string, V> >::const_iterator it = row.begin(); it != row.end(); ++it)
+        entries[nameOutPointKeyType(it->first, it->second.outPoint)] = it->second;
+}
+
+template<typename V>
+static void EntriesToRow(const std::map<nameOutPointKeyType, V>& entries, std::vector<std::pair<std::string, V> >& row)
+{
+    row.clear();
+    for (typename std::map<nameOutPointKeyType, V>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+        row.push_back(std::make_pair(it->first.first, it->second));
+}
+
+static void RowToEntries(const expirationQueueRowType& row, expirationQueueEntriesType& entries)
+{
+    for (expirationQueueRowType::const_iterator it = row.begin(); it != row.end(); ++it)
+        entries[nameOutPointKeyType(it->name, it->outPoint)] = '1';
+}
+
+static void EntriesToRow(const expirationQueueEntriesType& entries, expirationQueueRowType& row)
+{
+    row.clear();
+    for (expirationQueueEntriesType::const_iterator it = entries.begin(); it != entries.end(); ++it)
+        row.push_back(nameOutPointType(it->first.first, it->first.second));
+}
+
+static void RowToEntries(const queueNameRowType& row, queueNameEntriesType& entries)
+{
+    for (queueNameRowType::const_iterator it = row.begin(); it != row.end(); ++it)
+        entries[it->outPoint] = it->nHeight;
+}
+
+static void EntriesToRow(const queueNameEntriesType& entries, queueNameRowType& row)
+{
+    row.clear();
+    for (queueNameEntriesType::const_iterator it = entries.begin(); it != entries.end(); ++it)
+        row.push_back(outPointHeightType(it->first, it->second));
+}
+
+template<typename P, typename S, typename V>
+static bool ReadQueueEntries(const CDBWrapper& db, char keyType, const P& prefix, std::map<S, V>& entries)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
+    pcursor->Seek(std::make_pair(keyType, prefix));
+    while (pcursor->Valid())
+    {
+        std::pair<char, std::pair<P, S> > key;
+        if (!pcursor->GetKey(key) || key.first != keyType || key.second.first != prefix)
+            break;
+        if (!pcursor->GetValue(entries[key.second.second]))
+            return error("%s(): error reading claim trie queue entry from disk", __func__);
+        pcursor->Next();
+    }
+    return true;
+}
+
+// Reads a row and keeps what it holds on disk in rowsOnDisk
+template<typename Entries, typename K, typename Row>
+static bool ReadQueueRow(const CDBWrapper& db, char keyType, const K& key, Row& row, std::map<K, Row>& rowsOnDisk)
+{
+    Entries entries;
+    if (!ReadQueueEntries(db, keyType, QueueKey(key), entries))
+        return false;
+    Row& rowOnDisk = rowsOnDisk[key];
+    EntriesToRow(entries, rowOnDisk);
+    if (entries.empty())
+        return false;
+    row = rowOnDisk;
+    return true;
+}
+
+// Drops what is kept of rows on disk that have not been changed
+template<typename K, typename Row>
+static void PruneRowsOnDisk(std::map<K, Row>& rowsOnDisk, const std::map<K, Row>& dirtyRows)
+{
+    typename std::map<K, Row>::iterator it = rowsOnDisk.begin();
+    while (it != rowsOnDisk.end())
+    {
+        if (dirtyRows.count(it->first) == 0)
+            rowsOnDisk.erase(it++);
+        else
+            ++it;
+    }
+}
+
+template<typename Entries, typename K, typename Row>
+static void BatchWriteQueue(const CDBWrapper& db, CDBBatch& batch, char keyType, const std::map<K, Row>& rows, const std::map<K, Row>& rowsOnDisk)
+{
+    for (typename std::map<K, Row>::const_iterator itRow = rows.begin(); itRow != rows.end(); ++itRow)
+    {
+        Entries before, after;
+        typename std::map<K, Row>::const_iterator itOnDisk = rowsOnDisk.find(itRow->first);
+        if (itOnDisk != rowsOnDisk.end())
+            RowToEntries(itOnDisk->second, before);
+        else
+            ReadQueueEntries(db, keyType, QueueKey(itRow->first), before);
+        RowToEntries(itRow->second, after);
+        for (typename Entries::const_iterator it = before.begin(); it != before.end(); ++it)
+        {
+            if (after.count(it->first) == 0)
+                batch.Erase(std::make_pair(keyType, std::make_pair(QueueKey(itRow->first), it->first)));
+        }
+        for (typename Entries::const_iterator it = after.begin(); it != after.end(); ++it)
+        {
+            typename Entries::const_iterator itBefore = before.find(it->first);
+            if (itBefore == before.end() || !(itBefore->second == it->second))
+                batch.Write(std::make_pair(keyType, std::make_pair(QueueKey(itRow->first), it->first)), it->second);
+        }
+    }
+}
+
+// Rewrites the rows of an old one-value-per-row queue as entries
+template<typename Entries, typename K, typename Row>
+static bool UpgradeQueueRows(const CDBWrapper& db, CDBBatch& batch, char oldKeyType, char keyType, unsigned int& nRows)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
+    pcursor->Seek(oldKeyType);
+    while (pcursor->Valid())
+    {
+        std::pair<char, K> key;
+        if (!pcursor->GetKey(key) || key.first != oldKeyType)
+            break;
+        Row row;
+        if (!pcursor->GetValue(row))
+            return error("%s(): error reading claim trie queue row '%c' from disk", __func__, oldKeyType);
+        Entries entries;
+        RowToEntries(row, entries);
+        for (typename Entries::const_iterator it = entries.begin(); it != entries.end(); ++it)
+            batch.Write(std::make_pair(keyType, std::make_pair(QueueKey(key.second), it->first)), it->second);
+        batch.Erase(key);
+        ++nRows;
+        pcursor->Next();
+    }
+    return true;
+}
+
 template<typename K> bool CClaimTrie::keyTypeEmpty(char keyType, K& dummy) const
 {
     boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
@@ -183,7 +360,7 @@ bool CClaimTrie::queueEmpty() const
             return false;
     }
     int dummy;
-    return keyTypeEmpty(CLAIM_QUEUE_ROW, dummy);
+    return keyTypeEmpty(CLAIM_QUEUE_ENTRY, dummy);
 }
 
 bool CClaimTrie::expirationQueueEmpty() const
@@ -194,7 +371,7 @@ bool CClaimTrie::expirationQueueEmpty() const
             return false;
     }
     int dummy;
-    return keyTypeEmpty(EXP_QUEUE_ROW, dummy);
+    return keyTypeEmpty(EXP_QUEUE_ENTRY, dummy);
 }
 
 bool CClaimTrie::supportEmpty() const
@@ -216,7 +393,7 @@ bool CClaimTrie::supportQueueEmpty() const
             return false;
     }
     int dummy;
-    return keyTypeEmpty(SUPPORT_QUEUE_ROW, dummy);
+    return keyTypeEmpty(SUPPORT_QUEUE_ENTRY, dummy);
 }
 
 void CClaimTrie::setExpirationTime(int t)
@@ -224,6 +401,16 @@ void CClaimTrie::setExpirationTime(int t)
     nExpirationTime = t;
 }
 
+void CClaimTrie::setHistoryDepth(int nDepth)
+{
+    nHistoryDepth = std::max(nDepth, 0);
+}
+
+void CClaimTrie::setCacheSize(size_t nBytes)
+{
+    nCacheSize = nBytes;
+}
+
 void CClaimTrie::clear()
 {
     clear(&root);
@@ -231,6 +418,8 @@ void CClaimTrie::clear()
 
 void CClaimTrie::clear(CClaimTrieNode* current)
 {
+    if (!current->children.loaded())
+        return;
     for (nodeMapType::const_iterator itchildren = current->children.begin(); itchildren != current->children.end(); ++itchildren)
     {
         clear(itchildren->second);
@@ -429,6 +618,39 @@ std::vector<namedNodeType> CClaimTrie::flattenTrie() const
     return nodes;
 }
 
+bool CClaimTrie::recursiveGetNodesFrom(std::string& name, const CClaimTrieNode* current, const std::string& startName, size_t nLimit, bool fClaimsOnly, std::vector<namedNodeType>& nodes, std::string& nextName) const
+{
+    if (name >= startName && (!fClaimsOnly || !current->claims.empty()))
+    {
+        if (nLimit && nodes.size() == nLimit)
+        {
+            nextName = name;
+            return false;
+        }
+        // Only what callers read: the hash, the claims and the takeover height
+        CClaimTrieNode node(current->hash);
+        node.claims = current->claims;
+        node.nHeightOfLastTakeover = current->nHeightOfLastTakeover;
+        nodes.push_back(namedNodeType(name, node));
+    }
+    for (nodeMapType::const_iterator it = current->children.begin(); it != current->children.end(); ++it)
+    {
+        name.push_back(it->first);
+        // Skip subtrees whose names all sort before startName
+        bool fSkip = startName.compare(0, name.size(), name) > 0;
+        if (!fSkip && !recursiveGetNodesFrom(name, it->second, startName, nLimit, fClaimsOnly, nodes, nextName))
+            return false;
+        name.erase(name.size() - 1);
+    }
+    return true;
+}
+
+bool CClaimTrie::getNodesFrom(const std::string& startName, size_t nLimit, bool fClaimsOnly, std::vector<namedNodeType>& nodes, std::string& nextName) const
+{
+    std::string name;
+    return !recursiveGetNodesFrom(name, &root, startName, nLimit, fClaimsOnly, nodes, nextName);
+}
+
 const CClaimTrieNode* CClaimTrie::getNodeForName(const std::string& name) const
 {
     const CClaimTrieNode* current = &root;
@@ -555,27 +777,43 @@ CAmount CClaimTrie::getEffectiveAmountForClaim(const std::string& name, uint160
 
 }
 
-bool CClaimTrie::checkConsistency() const
+bool CClaimTrie::checkConsistency(bool fFull) const
 {
     if (empty())
         return true;
-    return recursiveCheckConsistency(&root);
+    std::string name;
+    return recursiveCheckConsistency(&root, name, fFull);
 }
 
-bool CClaimTrie::recursiveCheckConsistency(const CClaimTrieNode* node) const
+bool CClaimTrie::recursiveCheckConsistency(const CClaimTrieNode* node, std::string& name, bool fFull) const
 {
-    std::vector<unsigned char> vchToHash;
+    // Children that are still on disk are taken on trust, unless fFull is
+    // set; then they are read into a temporary list, so that checking does
+    // not fill the cache.
+    std::vector<CClaimTrieChildren::value_type> vOnDisk;
+    const std::vector<CClaimTrieChildren::value_type>* pChildren = &node->children.vChildren;
+    if (!node->children.loaded())
+    {
+        if (!fFull)
+            return true;
+        loadChildren(name, vOnDisk);
+        pChildren = &vOnDisk;
+    }
 
-    for (nodeMapType::const_iterator it = node->children.begin(); it != node->children.end(); ++it)
+    std::vector<unsigned char> vchToHash;
+    bool fConsistent = true;
+    for (std::vector<CClaimTrieChildren::value_type>::const_iterator it = pChildren->begin(); it != pChildren->end() && fConsistent; ++it)
     {
-        if (recursiveCheckConsistency(it->second))
-        {
-            vchToHash.push_back(it->first);
-            vchToHash.insert(vchToHash.end(), it->second->hash.begin(), it->second->hash.end());
-        }
-        else
-            return false;
+        name.push_back(it->first);
+        fConsistent = recursiveCheckConsistency(it->second, name, fFull);
+        name.erase(name.size() - 1);
+        vchToHash.push_back(it->first);
+        vchToHash.insert(vchToHash.end(), it->second->hash.begin(), it->second->hash.end());
     }
+    for (std::vector<CClaimTrieChildren::value_type>::iterator it = vOnDisk.begin(); it != vOnDisk.end(); ++it)
+        delete it->second;
+    if (!fConsistent)
+        return false;
 
     CClaimValue claim;
     bool hasClaim = node->getBestClaim(claim);
@@ -594,6 +832,184 @@ bool CClaimTrie::recursiveCheckConsistency(const CClaimTrieNode* node) const
     return calculatedHash == node->hash;
 }
 
+bool CClaimTrie::getAddressForClaim(const COutPoint& outPoint, std::string& sAddress) const
+{
+    claimAddressType::const_iterator itAddress = dirtyClaimAddresses.find(outPoint);
+    if (itAddress != dirtyClaimAddresses.end())
+    {
+        sAddress = itAddress->second;
+        return true;
+    }
+    return db.Read(std::make_pair(CLAIM_ADDRESS, outPoint), sAddress);
+}
+
+std::vector<nameOutPointType> CClaimTrie::getNamesForAddress(const std::string& sAddress) const
+{
+    std::set<std::pair<std::string, COutPoint> > names;
+    boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
+    pcursor->Seek(std::make_pair(ADDRESS_NAME, sAddress));
+    while (pcursor->Valid())
+    {
+        std::pair<char, addressNameType> key;
+        if (!pcursor->GetKey(key) || key.first != ADDRESS_NAME || key.second.first != sAddress)
+            break;
+        names.insert(key.second.second);
+        pcursor->Next();
+    }
+    // Apply the changes that have not been written yet.
+    addressIndexType::const_iterator itDirty = dirtyAddressIndex.lower_bound(addressNameType(sAddress, std::make_pair(std::string(), COutPoint(uint256(), 0))));
+    for (; itDirty != dirtyAddressIndex.end() && itDirty->first.first == sAddress; ++itDirty)
+    {
+        if (itDirty->second)
+            names.insert(itDirty->first.second);
+        else
+            names.erase(itDirty->first.second);
+    }
+    std::vector<nameOutPointType> ret;
+    for (std::set<std::pair<std::string, COutPoint> >::const_iterator it = names.begin(); it != names.end(); ++it)
+        ret.push_back(nameOutPointType(it->first, it->second));
+    return ret;
+}
+
+bool CClaimTrie::getClaimById(const uint160& claimId, std::string& name, CClaimValue& claim) const
+{
+    std::set<std::pair<std::string, COutPoint> > candidates;
+    boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
+    pcursor->Seek(std::make_pair(CLAIM_ID, claimId));
+    while (pcursor->Valid())
+    {
+        std::pair<char, claimIdNameType> key;
+        if (!pcursor->GetKey(key) || key.first != CLAIM_ID || key.second.first != claimId)
+            break;
+        candidates.insert(key.second.second);
+        pcursor->Next();
+    }
+    claimIdIndexType::const_iterator itDirty = dirtyClaimIdIndex.lower_bound(claimIdNameType(claimId, std::make_pair(std::string(), COutPoint(uint256(), 0))));
+    for (; itDirty != dirtyClaimIdIndex.end() && itDirty->first.first == claimId; ++itDirty)
+    {
+        if (itDirty->second)
+            candidates.insert(itDirty->first.second);
+        else
+            candidates.erase(itDirty->first.second);
+    }
+    for (std::set<std::pair<std::string, COutPoint> >::const_iterator it = candidates.begin(); it != candidates.end(); ++it)
+    {
+        const CClaimTrieNode* current = getNodeForName(it->first);
+        if (!current)
+            continue;
+        for (std::vector<CClaimValue>::const_iterator itClaim = current->claims.begin(); itClaim != current->claims.end(); ++itClaim)
+        {
+            if (itClaim->outPoint == it->second && itClaim->claimId == claimId)
+            {
+                name = it->first;
+                claim = *itClaim;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool CClaimTrie::getNodeVersion(const std::string& name, int nTrieHeight, CClaimTrieNodeVersion& version) const
+{
+    // The first version recorded above nTrieHeight is the state the node
+    // had at nTrieHeight. Dirty rows replace the rows on disk at their height.
+    int nFound = std::numeric_limits<int>::max();
+    for (nodeVersionRowsType::const_iterator itRow = dirtyNodeVersionRows.upper_bound(nTrieHeight); itRow != dirtyNodeVersionRows.end() && nFound == std::numeric_limits<int>::max(); ++itRow)
+    {
+        for (nodeVersionRowType::const_iterator itVersion = itRow->second.begin(); itVersion != itRow->second.end(); ++itVersion)
+        {
+            if (itVersion->first == name)
+            {
+                version = itVersion->second;
+                nFound = itRow->first;
+                break;
+            }
+        }
+    }
+    boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
+    pcursor->Seek(std::make_pair(NODE_VERSION, std::make_pair(name, CBigEndianHeight(nTrieHeight + 1))));
+    while (pcursor->Valid())
+    {
+        std::pair<char, std::pair<std::string, CBigEndianHeight> > key;
+        if (!pcursor->GetKey(key) || key.first != NODE_VERSION || key.second.first != name || key.second.second.nHeight >= nFound)
+            break;
+        if (dirtyNodeVersionRows.count(key.second.second.nHeight) == 0)
+        {
+            if (!pcursor->GetValue(version))
+                return error("%s(): error reading claim trie history from disk", __func__);
+            nFound = key.second.second.nHeight;
+            break;
+        }
+        pcursor->Next();
+    }
+    if (nFound != std::numeric_limits<int>::max())
+        return true;
+    // Not changed since nTrieHeight
+    const CClaimTrieNode* current = getNodeForName(name);
+    if (!current)
+        return false;
+    version = CClaimTrieNodeVersion(*current);
+    return true;
+}
+
+int CClaimTrie::getOldestProofHeight() const
+{
+    return std::max(nHistoryStart, nCurrentHeight - nHistoryDepth) - 1;
+}
+
+bool CClaimTrie::getProofForName(const std::string& name, int nHeight, CClaimTrieProof& proof) const
+{
+    if (nHeight < getOldestProofHeight() || nHeight >= nCurrentHeight)
+        return false;
+    // The trie is at height n + 1 once block n is connected
+    int nTrieHeight = nHeight + 1;
+    std::vector<CClaimTrieProofNode> nodes;
+    bool fNameHasValue = false;
+    COutPoint outPoint;
+    int nHeightOfLastTakeover = 0;
+    CClaimTrieNodeVersion current;
+    if (!getNodeVersion("", nTrieHeight, current))
+        return false;
+    for (size_t nPos = 0; ; ++nPos)
+    {
+        uint256 valueHash;
+        if (current.hasValue)
+            valueHash = getValueHash(current.outPoint, current.nHeightOfLastTakeover);
+        bool fNext = false;
+        std::vector<std::pair<unsigned char, uint256> > children;
+        for (std::vector<std::pair<unsigned char, uint256> >::const_iterator itChild = current.children.begin(); itChild != current.children.end(); ++itChild)
+        {
+            if (nPos == name.size() || itChild->first != (unsigned char)name[nPos]) // Leaf node
+            {
+                children.push_back(*itChild);
+            }
+            else // Full node
+            {
+                fNext = true;
+                children.push_back(std::make_pair(itChild->first, uint256()));
+            }
+        }
+        if (nPos == name.size())
+        {
+            fNameHasValue = current.hasValue;
+            if (fNameHasValue)
+            {
+                outPoint = current.outPoint;
+                nHeightOfLastTakeover = current.nHeightOfLastTakeover;
+            }
+            valueHash.SetNull();
+        }
+        nodes.push_back(CClaimTrieProofNode(children, current.hasValue, valueHash));
+        if (!fNext)
+            break;
+        if (!getNodeVersion(name.substr(0, nPos + 1), nTrieHeight, current))
+            return false;
+    }
+    proof = CClaimTrieProof(nodes, fNameHasValue, outPoint, nHeightOfLastTakeover);
+    return true;
+}
+
 bool CClaimTrie::getQueueRow(int nHeight, claimQueueRowType& row) const
 {
     claimQueueType::const_iterator itQueueRow = dirtyQueueRows.find(nHeight);
@@ -602,7 +1018,7 @@ bool CClaimTrie::getQueueRow(int nHeight, claimQueueRowType& row) const
         row = itQueueRow->second;
         return true;
     }
-    return db.Read(std::make_pair(CLAIM_QUEUE_ROW, nHeight), row);
+    return ReadQueueRow<claimQueueEntriesType>(db, CLAIM_QUEUE_ENTRY, nHeight, row, diskQueueRows);
 }
 
 bool CClaimTrie::getQueueNameRow(const std::string& name, queueNameRowType& row) const
@@ -613,7 +1029,7 @@ bool CClaimTrie::getQueueNameRow(const std::string& name, queueNameRowType& row)
         row = itQueueNameRow->second;
         return true;
     }
-    return db.Read(std::make_pair(CLAIM_QUEUE_NAME_ROW, name), row);
+    return ReadQueueRow<queueNameEntriesType>(db, CLAIM_QUEUE_NAME_ENTRY, name, row, diskQueueNameRows);
 }
 
 bool CClaimTrie::getExpirationQueueRow(int nHeight, expirationQueueRowType& row) const
@@ -624,7 +1040,7 @@ bool CClaimTrie::getExpirationQueueRow(int nHeight, expirationQueueRowType& row)
         row = itQueueRow->second;
         return true;
     }
-    return db.Read(std::make_pair(EXP_QUEUE_ROW, nHeight), row);
+    return ReadQueueRow<expirationQueueEntriesType>(db, EXP_QUEUE_ENTRY, nHeight, row, diskExpirationQueueRows);
 }
 
 void CClaimTrie::updateQueueRow(int nHeight, claimQueueRowType& row)
@@ -772,7 +1188,7 @@ bool CClaimTrie::getSupportQueueRow(int nHeight, supportQueueRowType& row) const
         row = itQueueRow->second;
         return true;
     }
-    return db.Read(std::make_pair(SUPPORT_QUEUE_ROW, nHeight), row);
+    return ReadQueueRow<supportQueueEntriesType>(db, SUPPORT_QUEUE_ENTRY, nHeight, row, diskSupportQueueRows);
 }
 
 bool CClaimTrie::getSupportQueueNameRow(const std::string& name, queueNameRowType& row) const
@@ -783,7 +1199,7 @@ bool CClaimTrie::getSupportQueueNameRow(const std::string& name, queueNameRowTyp
         row = itQueueNameRow->second;
         return true;
     }
-    return db.Read(std::make_pair(SUPPORT_QUEUE_NAME_ROW, name), row);
+    return ReadQueueRow<queueNameEntriesType>(db, SUPPORT_QUEUE_NAME_ENTRY, name, row, diskSupportQueueNameRows);
 }
 
 bool CClaimTrie::getSupportExpirationQueueRow(int nHeight, expirationQueueRowType& row) const
@@ -794,11 +1210,28 @@ bool CClaimTrie::getSupportExpirationQueueRow(int nHeight, expirationQueueRowTyp
         row = itQueueRow->second;
         return true;
     }
-    return db.Read(std::make_pair(SUPPORT_EXP_QUEUE_ROW, nHeight), row);
+    return ReadQueueRow<expirationQueueEntriesType>(db, SUPPORT_EXP_QUEUE_ENTRY, nHeight, row, diskSupportExpirationQueueRows);
 }
 
-bool CClaimTrie::update(nodeCacheType& cache, hashMapType& hashes, std::map<std::string, int>& takeoverHeights, const uint256& hashBlockIn, claimQueueType& queueCache, queueNameType& queueNameCache, expirationQueueType& expirationQueueCache, int nNewHeight, supportMapType& supportCache, supportQueueType& supportQueueCache, queueNameType& supportQueueNameCache, expirationQueueType& supportExpirationQueueCache)
+bool CClaimTrie::update(nodeCacheType& cache, hashMapType& hashes, std::map<std::string, int>& takeoverHeights, const uint256& hashBlockIn, claimQueueType& queueCache, queueNameType& queueNameCache, expirationQueueType& expirationQueueCache, int nNewHeight, supportMapType& supportCache, supportQueueType& supportQueueCache, queueNameType& supportQueueNameCache, expirationQueueType& supportExpirationQueueCache, addressIndexType& addressIndexCache, claimAddressType& claimAddressCache, claimIdIndexType& claimIdIndexCache)
 {
+    if (nNewHeight > nCurrentHeight)
+    {
+        if (nHistoryDepth > 0)
+            recordNodeVersions(cache, hashes, nNewHeight);
+        if (nNewHeight - nHistoryDepth > 0)
+        {
+            pruneNodeVersions(nNewHeight - nHistoryDepth);
+            nHistoryStart = std::max(nHistoryStart, nNewHeight - nHistoryDepth);
+        }
+    }
+    else if (nNewHeight < nCurrentHeight)
+    {
+        // The nodes now look the way the versions above nNewHeight describe
+        for (int nHeight = nCurrentHeight; nHeight > nNewHeight; --nHeight)
+            eraseNodeVersions(nHeight);
+        nHistoryStart = std::min(nHistoryStart, nNewHeight);
+    }
     for (nodeCacheType::iterator itcache = cache.begin(); itcache != cache.end(); ++itcache)
     {
         if (!updateName(itcache->first, itcache->second))
@@ -842,11 +1275,71 @@ bool CClaimTrie::update(nodeCacheType& cache, hashMapType& hashes, std::map<std:
     {
         updateSupportExpirationQueue(itSupportExpirationQueue->first, itSupportExpirationQueue->second);
     }
+    for (addressIndexType::iterator itAddressName = addressIndexCache.begin(); itAddressName != addressIndexCache.end(); ++itAddressName)
+    {
+        dirtyAddressIndex[itAddressName->first] = itAddressName->second;
+    }
+    for (claimAddressType::iterator itClaimAddress = claimAddressCache.begin(); itClaimAddress != claimAddressCache.end(); ++itClaimAddress)
+    {
+        dirtyClaimAddresses[itClaimAddress->first] = itClaimAddress->second;
+    }
+    for (claimIdIndexType::iterator itClaimId = claimIdIndexCache.begin(); itClaimId != claimIdIndexCache.end(); ++itClaimId)
+    {
+        dirtyClaimIdIndex[itClaimId->first] = itClaimId->second;
+    }
+    PruneRowsOnDisk(diskQueueRows, dirtyQueueRows);
+    PruneRowsOnDisk(diskQueueNameRows, dirtyQueueNameRows);
+    PruneRowsOnDisk(diskExpirationQueueRows, dirtyExpirationQueueRows);
+    PruneRowsOnDisk(diskSupportQueueRows, dirtySupportQueueRows);
+    PruneRowsOnDisk(diskSupportQueueNameRows, dirtySupportQueueNameRows);
+    PruneRowsOnDisk(diskSupportExpirationQueueRows, dirtySupportExpirationQueueRows);
     hashBlock = hashBlockIn;
     nCurrentHeight = nNewHeight;
     return true;
 }
 
+void CClaimTrie::recordNodeVersions(const nodeCacheType& cache, const hashMapType& hashes, int nHeight)
+{
+    std::set<std::string> names;
+    for (nodeCacheType::const_iterator itcache = cache.begin(); itcache != cache.end(); ++itcache)
+        names.insert(itcache->first);
+    for (hashMapType::const_iterator ithash = hashes.begin(); ithash != hashes.end(); ++ithash)
+        names.insert(ithash->first);
+    nodeVersionRowType& row = dirtyNodeVersionRows[nHeight];
+    row.clear();
+    for (std::set<std::string>::const_iterator itName = names.begin(); itName != names.end(); ++itName)
+    {
+        // Nodes created by this block have no earlier state
+        const CClaimTrieNode* current = getNodeForName(*itName);
+        if (current)
+            row.push_back(std::make_pair(*itName, CClaimTrieNodeVersion(*current)));
+    }
+}
+
+void CClaimTrie::eraseNodeVersions(int nHeight)
+{
+    dirtyNodeVersionRows[nHeight].clear();
+}
+
+// Erases the versions of nHeight and of every height below it, so that
+// lowering -claimtriehistory drops all of the history it no longer keeps
+void CClaimTrie::pruneNodeVersions(int nHeight)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
+    pcursor->Seek(NODE_VERSION_ROW);
+    while (pcursor->Valid())
+    {
+        std::pair<char, CBigEndianHeight> key;
+        if (!pcursor->GetKey(key) || key.first != NODE_VERSION_ROW || key.second.nHeight > nHeight)
+            break;
+        eraseNodeVersions(key.second.nHeight);
+        pcursor->Next();
+    }
+    for (nodeVersionRowsType::iterator itRow = dirtyNodeVersionRows.begin(); itRow != dirtyNodeVersionRows.end() && itRow->first <= nHeight; ++itRow)
+        itRow->second.clear();
+    eraseNodeVersions(nHeight);
+}
+
 void CClaimTrie::markNodeDirty(const std::string &name, CClaimTrieNode* node)
 {
     std::pair<nodeCacheType::iterator, bool> ret;
@@ -896,7 +1389,7 @@ bool CClaimTrie::updateName(const std::string &name, CClaimTrieNode* updatedNode
             std::string newName = ss.str();
             if (!recursiveNullify(itchild->second, newName))
                 return false;
-            current->children.erase(itchild++);
+            itchild = current->children.erase(itchild);
         }
         else
             ++itchild;
@@ -979,47 +1472,17 @@ void CClaimTrie::BatchWriteNode(CDBBatch& batch, const std::string& name, const
 
 void CClaimTrie::BatchWriteQueueRows(CDBBatch& batch)
 {
-    for (claimQueueType::iterator itQueue = dirtyQueueRows.begin(); itQueue != dirtyQueueRows.end(); ++itQueue)
-    {
-        if (itQueue->second.empty())
-        {
-            batch.Erase(std::make_pair(CLAIM_QUEUE_ROW, itQueue->first));
-        }
-        else
-        {
-            batch.Write(std::make_pair(CLAIM_QUEUE_ROW, itQueue->first), itQueue->second);
-        }
-    }
+    BatchWriteQueue<claimQueueEntriesType>(db, batch, CLAIM_QUEUE_ENTRY, dirtyQueueRows, diskQueueRows);
 }
 
 void CClaimTrie::BatchWriteQueueNameRows(CDBBatch& batch)
 {
-    for (queueNameType::iterator itQueue = dirtyQueueNameRows.begin(); itQueue != dirtyQueueNameRows.end(); ++itQueue)
-    {
-        if (itQueue->second.empty())
-        {
-            batch.Erase(std::make_pair(CLAIM_QUEUE_NAME_ROW, itQueue->first));
-        }
-        else
-        {
-            batch.Write(std::make_pair(CLAIM_QUEUE_NAME_ROW, itQueue->first), itQueue->second);
-        }
-    }
+    BatchWriteQueue<queueNameEntriesType>(db, batch, CLAIM_QUEUE_NAME_ENTRY, dirtyQueueNameRows, diskQueueNameRows);
 }
 
 void CClaimTrie::BatchWriteExpirationQueueRows(CDBBatch& batch)
 {
-    for (expirationQueueType::iterator itQueue = dirtyExpirationQueueRows.begin(); itQueue != dirtyExpirationQueueRows.end(); ++itQueue)
-    {
-        if (itQueue->second.empty())
-        {
-            batch.Erase(std::make_pair(EXP_QUEUE_ROW, itQueue->first));
-        }
-        else
-        {
-            batch.Write(std::make_pair(EXP_QUEUE_ROW, itQueue->first), itQueue->second);
-        }
-    }
+    BatchWriteQueue<expirationQueueEntriesType>(db, batch, EXP_QUEUE_ENTRY, dirtyExpirationQueueRows, diskExpirationQueueRows);
 }
 
 void CClaimTrie::BatchWriteSupportNodes(CDBBatch& batch)
@@ -1039,46 +1502,78 @@ void CClaimTrie::BatchWriteSupportNodes(CDBBatch& batch)
 
 void CClaimTrie::BatchWriteSupportQueueRows(CDBBatch& batch)
 {
-    for (supportQueueType::iterator itQueue = dirtySupportQueueRows.begin(); itQueue != dirtySupportQueueRows.end(); ++itQueue)
+    BatchWriteQueue<supportQueueEntriesType>(db, batch, SUPPORT_QUEUE_ENTRY, dirtySupportQueueRows, diskSupportQueueRows);
+}
+
+void CClaimTrie::BatchWriteSupportQueueNameRows(CDBBatch& batch)
+{
+    BatchWriteQueue<queueNameEntriesType>(db, batch, SUPPORT_QUEUE_NAME_ENTRY, dirtySupportQueueNameRows, diskSupportQueueNameRows);
+}
+
+void CClaimTrie::BatchWriteSupportExpirationQueueRows(CDBBatch& batch)
+{
+    BatchWriteQueue<expirationQueueEntriesType>(db, batch, SUPPORT_EXP_QUEUE_ENTRY, dirtySupportExpirationQueueRows, diskSupportExpirationQueueRows);
+}
+
+void CClaimTrie::BatchWriteAddressIndex(CDBBatch& batch)
+{
+    for (addressIndexType::iterator itAddressName = dirtyAddressIndex.begin(); itAddressName != dirtyAddressIndex.end(); ++itAddressName)
     {
-        if (itQueue->second.empty())
+        if (itAddressName->second)
         {
-            batch.Erase(std::make_pair(SUPPORT_QUEUE_ROW, itQueue->first));
+            batch.Write(std::make_pair(ADDRESS_NAME, itAddressName->first), '\0');
         }
         else
         {
-            batch.Write(std::make_pair(SUPPORT_QUEUE_ROW, itQueue->first), itQueue->second);
+            batch.Erase(std::make_pair(ADDRESS_NAME, itAddressName->first));
         }
     }
+    // Addresses of claims are kept once they leave the trie, so that a
+    // claim restored by a disconnected block can be indexed again.
+    for (claimAddressType::iterator itClaimAddress = dirtyClaimAddresses.begin(); itClaimAddress != dirtyClaimAddresses.end(); ++itClaimAddress)
+    {
+        batch.Write(std::make_pair(CLAIM_ADDRESS, itClaimAddress->first), itClaimAddress->second);
+    }
 }
 
-void CClaimTrie::BatchWriteSupportQueueNameRows(CDBBatch& batch)
+void CClaimTrie::BatchWriteClaimIdIndex(CDBBatch& batch)
 {
-    for (queueNameType::iterator itQueue = dirtySupportQueueNameRows.begin(); itQueue != dirtySupportQueueNameRows.end(); ++itQueue)
+    for (claimIdIndexType::iterator itClaimId = dirtyClaimIdIndex.begin(); itClaimId != dirtyClaimIdIndex.end(); ++itClaimId)
     {
-        if (itQueue->second.empty())
+        if (itClaimId->second)
         {
-            batch.Erase(std::make_pair(SUPPORT_QUEUE_NAME_ROW, itQueue->first));
+            batch.Write(std::make_pair(CLAIM_ID, itClaimId->first), '\0');
         }
         else
         {
-            batch.Write(std::make_pair(SUPPORT_QUEUE_NAME_ROW, itQueue->first), itQueue->second);
+            batch.Erase(std::make_pair(CLAIM_ID, itClaimId->first));
         }
     }
 }
 
-void CClaimTrie::BatchWriteSupportExpirationQueueRows(CDBBatch& batch)
+void CClaimTrie::BatchWriteNodeVersionRows(CDBBatch& batch)
 {
-    for (expirationQueueType::iterator itQueue = dirtySupportExpirationQueueRows.begin(); itQueue != dirtySupportExpirationQueueRows.end(); ++itQueue)
+    for (nodeVersionRowsType::iterator itRow = dirtyNodeVersionRows.begin(); itRow != dirtyNodeVersionRows.end(); ++itRow)
     {
-        if (itQueue->second.empty())
+        // Drop whatever was stored for this height before writing the new row
+        std::vector<std::string> names;
+        if (db.Read(std::make_pair(NODE_VERSION_ROW, CBigEndianHeight(itRow->first)), names))
         {
-            batch.Erase(std::make_pair(SUPPORT_EXP_QUEUE_ROW, itQueue->first));
+            for (std::vector<std::string>::iterator itName = names.begin(); itName != names.end(); ++itName)
+                batch.Erase(std::make_pair(NODE_VERSION, std::make_pair(*itName, CBigEndianHeight(itRow->first))));
         }
-        else
+        if (itRow->second.empty())
+        {
+            batch.Erase(std::make_pair(NODE_VERSION_ROW, CBigEndianHeight(itRow->first)));
+            continue;
+        }
+        names.clear();
+        for (nodeVersionRowType::iterator itVersion = itRow->second.begin(); itVersion != itRow->second.end(); ++itVersion)
         {
-            batch.Write(std::make_pair(SUPPORT_EXP_QUEUE_ROW, itQueue->first), itQueue->second);
+            batch.Write(std::make_pair(NODE_VERSION, std::make_pair(itVersion->first, CBigEndianHeight(itRow->first))), itVersion->second);
+            names.push_back(itVersion->first);
         }
+        batch.Write(std::make_pair(NODE_VERSION_ROW, CBigEndianHeight(itRow->first)), names);
     }
 }
 
@@ -1090,21 +1585,39 @@ bool CClaimTrie::WriteToDisk()
     dirtyNodes.clear();
     BatchWriteQueueRows(batch);
     dirtyQueueRows.clear();
+    diskQueueRows.clear();
     BatchWriteQueueNameRows(batch);
     dirtyQueueNameRows.clear();
+    diskQueueNameRows.clear();
     BatchWriteExpirationQueueRows(batch);
     dirtyExpirationQueueRows.clear();
+    diskExpirationQueueRows.clear();
     BatchWriteSupportNodes(batch);
     dirtySupportNodes.clear();
     BatchWriteSupportQueueRows(batch);
     dirtySupportQueueRows.clear();
+    diskSupportQueueRows.clear();
     BatchWriteSupportQueueNameRows(batch);
     dirtySupportQueueNameRows.clear();
+    diskSupportQueueNameRows.clear();
     BatchWriteSupportExpirationQueueRows(batch);
     dirtySupportExpirationQueueRows.clear();
+    diskSupportExpirationQueueRows.clear();
+    BatchWriteAddressIndex(batch);
+    dirtyAddressIndex.clear();
+    dirtyClaimAddresses.clear();
+    BatchWriteClaimIdIndex(batch);
+    dirtyClaimIdIndex.clear();
+    BatchWriteNodeVersionRows(batch);
+    dirtyNodeVersionRows.clear();
+    batch.Write(TRIE_DB_VERSION, CLAIMTRIE_DB_VERSION);
+    batch.Write(HISTORY_START, nHistoryStart);
     batch.Write(HASH_BLOCK, hashBlock);
     batch.Write(CURRENT_HEIGHT, nCurrentHeight);
-    return db.WriteBatch(batch);
+    if (!db.WriteBatch(batch))
+        return false;
+    evictNodes();
+    return true;
 }
 
 bool CClaimTrie::InsertFromDisk(const std::string& name, CClaimTrieNode* node)
@@ -1126,16 +1639,184 @@ bool CClaimTrie::InsertFromDisk(const std::string& name, CClaimTrieNode* node)
     return true;
 }
 
-bool CClaimTrie::ReadFromDisk(bool check)
+// Held while a node's children are read, so that two hashing threads
+// reaching the same node do not both fill it.
+static boost::mutex cs_claimtrieload;
+
+void CClaimTrieChildren::loadFromDisk() const
+{
+    boost::lock_guard<boost::mutex> lock(cs_claimtrieload);
+    stub* pLoad = pStub.load(std::memory_order_relaxed);
+    if (!pLoad)
+        return;
+    std::vector<value_type> vLoaded;
+    pLoad->pTrie->loadChildren(pLoad->name, vLoaded);
+    vChildren.swap(vLoaded);
+    pStub.store(NULL, std::memory_order_release);
+    delete pLoad;
+}
+
+void CClaimTrie::loadChildren(const std::string& name, std::vector<CClaimTrieChildren::value_type>& children) const
+{
+    // Keys are ordered by name length first, so the children of a node are
+    // the run of names one character longer that start with its name.
+    boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
+    pcursor->Seek(std::make_pair(TRIE_NODE, name + '\0'));
+    while (pcursor->Valid())
+    {
+        std::pair<char, std::string> key;
+        if (!pcursor->GetKey(key) || key.first != TRIE_NODE || key.second.size() != name.size() + 1 || key.second.compare(0, name.size(), name) != 0)
+            break;
+        CClaimTrieNode* node = new CClaimTrieNode();
+        if (!pcursor->GetValue(*node))
+        {
+            LogPrintf("%s(): error reading claim trie node %s from disk\n", __func__, key.second);
+            delete node;
+            break;
+        }
+        unloadChildren(node, key.second);
+        children.push_back(std::make_pair((unsigned char)key.second[name.size()], node));
+        pcursor->Next();
+    }
+}
+
+void CClaimTrie::unloadChildren(CClaimTrieNode* node, const std::string& name) const
+{
+    for (std::vector<CClaimTrieChildren::value_type>::iterator it = node->children.vChildren.begin(); it != node->children.vChildren.end(); ++it)
+    {
+        if (it->second->children.loaded())
+            unloadChildren(it->second, name + (char)it->first);
+        delete it->second;
+    }
+    node->children.clear();
+    CClaimTrieChildren::stub* pStub = new CClaimTrieChildren::stub();
+    pStub->pTrie = this;
+    pStub->name = name;
+    node->children.setStub(pStub);
+}
+
+size_t CClaimTrie::recursiveDynamicUsage(const CClaimTrieNode* node) const
+{
+    size_t nUsage = memusage::MallocUsage(sizeof(CClaimTrieNode)) + memusage::DynamicUsage(node->claims) + memusage::DynamicUsage(node->children.vChildren);
+    if (node->children.loaded())
+    {
+        for (std::vector<CClaimTrieChildren::value_type>::const_iterator it = node->children.vChildren.begin(); it != node->children.vChildren.end(); ++it)
+            nUsage += recursiveDynamicUsage(it->second);
+    }
+    return nUsage;
+}
+
+void CClaimTrie::recursiveEvict(CClaimTrieNode* node, std::string& name, size_t& nUsage)
+{
+    for (std::vector<CClaimTrieChildren::value_type>::iterator it = node->children.vChildren.begin(); it != node->children.vChildren.end() && nUsage > nCacheSize; ++it)
+    {
+        CClaimTrieNode* child = it->second;
+        if (!child->children.loaded())
+            continue;
+        name.push_back(it->first);
+        if (child->children.fUsed.exchange(false, std::memory_order_relaxed))
+        {
+            // Second chance: evicted on the next pass unless touched again
+            recursiveEvict(child, name, nUsage);
+        }
+        else
+        {
+            size_t nChildUsage = recursiveDynamicUsage(child);
+            unloadChildren(child, name);
+            nUsage -= nChildUsage - recursiveDynamicUsage(child);
+        }
+        name.erase(name.size() - 1);
+    }
+}
+
+void CClaimTrie::evictNodes()
+{
+    if (nCacheSize == 0)
+        return;
+    size_t nUsage = recursiveDynamicUsage(&root);
+    if (nUsage > nCacheSize)
+    {
+        std::string name;
+        recursiveEvict(&root, name, nUsage);
+    }
+    LogPrint("claimtrie", "%s: %u bytes of claim trie nodes in memory\n", __func__, nUsage);
+}
+
+bool CClaimTrie::upgradeQueueRows()
+{
+    CDBBatch batch(&db.GetObfuscateKey());
+    unsigned int nRows = 0;
+    if (!UpgradeQueueRows<claimQueueEntriesType, int, claimQueueRowType>(db, batch, CLAIM_QUEUE_ROW, CLAIM_QUEUE_ENTRY, nRows) ||
+        !UpgradeQueueRows<queueNameEntriesType, std::string, queueNameRowType>(db, batch, CLAIM_QUEUE_NAME_ROW, CLAIM_QUEUE_NAME_ENTRY, nRows) ||
+        !UpgradeQueueRows<expirationQueueEntriesType, int, expirationQueueRowType>(db, batch, EXP_QUEUE_ROW, EXP_QUEUE_ENTRY, nRows) ||
+        !UpgradeQueueRows<supportQueueEntriesType, int, supportQueueRowType>(db, batch, SUPPORT_QUEUE_ROW, SUPPORT_QUEUE_ENTRY, nRows) ||
+        !UpgradeQueueRows<queueNameEntriesType, std::string, queueNameRowType>(db, batch, SUPPORT_QUEUE_NAME_ROW, SUPPORT_QUEUE_NAME_ENTRY, nRows) ||
+        !UpgradeQueueRows<expirationQueueEntriesType, int, expirationQueueRowType>(db, batch, SUPPORT_EXP_QUEUE_ROW, SUPPORT_EXP_QUEUE_ENTRY, nRows))
+        return false;
+    if (nRows == 0)
+        return true;
+    LogPrintf("%s: Rewriting %u claim trie queue rows as entries\n", __func__, nRows);
+    return db.WriteBatch(batch, true);
+}
+
+// Indexes the claims of a trie written before the claimId index was kept
+bool CClaimTrie::indexClaimIds()
+{
+    CDBBatch batch(&db.GetObfuscateKey());
+    unsigned int nClaims = 0;
+    boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
+    pcursor->Seek(TRIE_NODE);
+    while (pcursor->Valid())
+    {
+        std::pair<char, std::string> key;
+        if (!pcursor->GetKey(key) || key.first != TRIE_NODE)
+            break;
+        CClaimTrieNode node;
+        if (!pcursor->GetValue(node))
+            return error("%s(): error reading claim trie from disk", __func__);
+        for (std::vector<CClaimValue>::const_iterator itClaim = node.claims.begin(); itClaim != node.claims.end(); ++itClaim)
+        {
+            batch.Write(std::make_pair(CLAIM_ID, claimIdNameType(itClaim->claimId, std::make_pair(key.second, itClaim->outPoint))), '\0');
+            ++nClaims;
+        }
+        pcursor->Next();
+    }
+    if (nClaims > 0)
+        LogPrintf("%s: Indexing %u claims by claimId\n", __func__, nClaims);
+    batch.Write(TRIE_DB_VERSION, CLAIMTRIE_DB_VERSION);
+    return db.WriteBatch(batch, true);
+}
+
+bool CClaimTrie::ReadFromDisk(bool check, bool fFullCheck)
 {
     if (!db.Read(HASH_BLOCK, hashBlock))
         LogPrintf("%s: Couldn't read the best block's hash\n", __func__);
     if (!db.Read(CURRENT_HEIGHT, nCurrentHeight))
         LogPrintf("%s: Couldn't read the current height\n", __func__);
+    // Tries written before history was kept can only prove their current state
+    if (!db.Read(HISTORY_START, nHistoryStart))
+        nHistoryStart = nCurrentHeight;
+    // Databases written before the version was kept hold version 0
+    int nVersion = 0;
+    if (db.Exists(TRIE_DB_VERSION) && !db.Read(TRIE_DB_VERSION, nVersion))
+        return error("%s(): error reading the claim trie database version", __func__);
+    if (nVersion > CLAIMTRIE_DB_VERSION)
+        return error("%s(): unknown claim trie database version %d, this version only reads up to %d", __func__, nVersion, CLAIMTRIE_DB_VERSION);
+    if (!upgradeQueueRows())
+        return error("%s(): error upgrading the claim trie queues", __func__);
+    if (nVersion < 2 && !indexClaimIds())
+        return error("%s(): error indexing claims by claimId", __func__);
+    if (nCacheSize > 0)
+    {
+        // Paged: only the root, everything below it is read when touched
+        if (db.Exists(std::make_pair(TRIE_NODE, std::string())) && !db.Read(std::make_pair(TRIE_NODE, std::string()), root))
+            return error("%s(): error reading claim trie from disk", __func__);
+        unloadChildren(&root, std::string());
+    }
     boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
     pcursor->SeekToFirst();
     
-    while (pcursor->Valid())
+    while (nCacheSize == 0 && pcursor->Valid())
     {
         std::pair<char, std::string> key;
         if (pcursor->GetKey(key))
@@ -1160,8 +1841,12 @@ bool CClaimTrie::ReadFromDisk(bool check)
     }
     if (check)
     {
-        LogPrintf("Checking Claim trie consistency...");
-        if (checkConsistency())
+        // Paged tries only hold the root in memory at this point
+        if (nCacheSize > 0 && !fFullCheck)
+            LogPrintf("Checking Claim trie consistency of the nodes in memory (use -checkclaimtrie for all of them)...");
+        else
+            LogPrintf("Checking Claim trie consistency...");
+        if (checkConsistency(fFullCheck))
         {
             LogPrintf("consistent\n");
             return true;
@@ -1172,41 +1857,85 @@ bool CClaimTrie::ReadFromDisk(bool check)
     return true;
 }
 
-bool CClaimTrieCache::recursiveComputeMerkleHash(CClaimTrieNode* tnCurrent, std::string sPos) const
+/**
+ * Recomputes the hashes of one dirty subtree. Only reads the shared state of
+ * the cache; the new hashes go to `hashes` and the names that are no longer
+ * dirty to `cleaned`, so that several subtrees can run at once.
+ */
+class CClaimTrieHashJob
+{
+private:
+    const CClaimTrieCache* pcache;
+    CClaimTrieNode* pnode;
+    std::string sPos;
+    hashMapType* phashes;
+    std::vector<std::string>* pcleaned;
+
+public:
+    CClaimTrieHashJob() : pcache(NULL), pnode(NULL), phashes(NULL), pcleaned(NULL) {}
+    CClaimTrieHashJob(const CClaimTrieCache* pcacheIn, CClaimTrieNode* pnodeIn, const std::string& sPosIn,
+                      hashMapType& hashes, std::vector<std::string>& cleaned) :
+        pcache(pcacheIn), pnode(pnodeIn), sPos(sPosIn), phashes(&hashes), pcleaned(&cleaned) {}
+
+    bool operator()()
+    {
+        return pcache->recursiveComputeMerkleHash(pnode, sPos, *phashes, *pcleaned);
+    }
+
+    void swap(CClaimTrieHashJob& job)
+    {
+        std::swap(pcache, job.pcache);
+        std::swap(pnode, job.pnode);
+        sPos.swap(job.sPos);
+        std::swap(phashes, job.phashes);
+        std::swap(pcleaned, job.pcleaned);
+    }
+};
+
+int nClaimTrieHashThreads = 0;
+static CCheckQueue<CClaimTrieHashJob> claimtriehashqueue(1);
+// CCheckQueueControl requires a single master at a time.
+static boost::mutex cs_claimtriehashqueue;
+
+void ThreadClaimTrieHash()
+{
+    RenameThread("ulord-triehash");
+    claimtriehashqueue.Thread();
+}
+
+bool CClaimTrieCache::recursiveComputeMerkleHash(CClaimTrieNode* tnCurrent, const std::string& sPos, hashMapType& hashes, std::vector<std::string>& cleaned) const
 {
     if (sPos == "" && tnCurrent->empty())
     {
-        cacheHashes[""] = uint256S("0000000000000000000000000000000000000000000000000000000000000001");
+        hashes[""] = uint256S("0000000000000000000000000000000000000000000000000000000000000001");
         return true;
     }
     std::vector<unsigned char> vchToHash;
-    nodeCacheType::iterator cachedNode;
-
+    vchToHash.reserve(tnCurrent->children.size() * 33 + 32);
+    nodeCacheType::const_iterator cachedNode;
+    std::string sNextPos(sPos);
+    sNextPos.push_back('\0');
 
     for (nodeMapType::iterator it = tnCurrent->children.begin(); it != tnCurrent->children.end(); ++it)
     {
-        std::stringstream ss;
-        ss << it->first;
-        std::string sNextPos = sPos + ss.str();
+        sNextPos[sPos.size()] = it->first;
         if (dirtyHashes.count(sNextPos) != 0)
         {
             // the child might be in the cache, so look for it there
             cachedNode = cache.find(sNextPos);
             if (cachedNode != cache.end())
-                recursiveComputeMerkleHash(cachedNode->second, sNextPos);
+                recursiveComputeMerkleHash(cachedNode->second, sNextPos, hashes, cleaned);
             else
-                recursiveComputeMerkleHash(it->second, sNextPos);
+                recursiveComputeMerkleHash(it->second, sNextPos, hashes, cleaned);
         }
         vchToHash.push_back(it->first);
-        hashMapType::iterator ithash = cacheHashes.find(sNextPos);
-        if (ithash != cacheHashes.end())
-        {
-            vchToHash.insert(vchToHash.end(), ithash->second.begin(), ithash->second.end());
-        }
-        else
-        {
-            vchToHash.insert(vchToHash.end(), it->second->hash.begin(), it->second->hash.end());
-        }
+        const uint256* pchildHash = &it->second->hash;
+        hashMapType::const_iterator ithash = hashes.find(sNextPos);
+        if (ithash != hashes.end())
+            pchildHash = &ithash->second;
+        else if ((ithash = cacheHashes.find(sNextPos)) != cacheHashes.end())
+            pchildHash = &ithash->second;
+        vchToHash.insert(vchToHash.end(), pchildHash->begin(), pchildHash->end());
     }
     
     CClaimValue claim;
@@ -1225,16 +1954,58 @@ bool CClaimTrieCache::recursiveComputeMerkleHash(CClaimTrieNode* tnCurrent, std:
     }
 
     CHash256 hasher;
-    std::vector<unsigned char> vchHash(hasher.OUTPUT_SIZE);
+    uint256 hash;
     hasher.Write(vchToHash.data(), vchToHash.size());
-    hasher.Finalize(&(vchHash[0]));
-    cacheHashes[sPos] = uint256(vchHash);
-    std::set<std::string>::iterator itDirty = dirtyHashes.find(sPos);
-    if (itDirty != dirtyHashes.end())
-        dirtyHashes.erase(itDirty);
+    hasher.Finalize(hash.begin());
+    hashes[sPos] = hash;
+    if (dirtyHashes.count(sPos) != 0)
+        cleaned.push_back(sPos);
     return true;
 }
 
+void CClaimTrieCache::computeMerkleHash(CClaimTrieNode* root) const
+{
+    std::vector<std::string> cleaned;
+    if (nClaimTrieHashThreads > 1 && root->children.size() > 1)
+    {
+        // Hand the dirty subtrees below the root to the hashing threads,
+        // then fold their results back in before hashing the root itself.
+        std::vector<std::pair<std::string, CClaimTrieNode*> > subtrees;
+        for (nodeMapType::iterator it = root->children.begin(); it != root->children.end(); ++it)
+        {
+            std::string sPos(1, it->first);
+            if (dirtyHashes.count(sPos) == 0)
+                continue;
+            nodeCacheType::const_iterator cachedNode = cache.find(sPos);
+            subtrees.push_back(std::make_pair(sPos, cachedNode != cache.end() ? cachedNode->second : it->second));
+        }
+        if (subtrees.size() > 1)
+        {
+            std::vector<hashMapType> vHashes(subtrees.size());
+            std::vector<std::vector<std::string> > vCleaned(subtrees.size());
+            std::vector<CClaimTrieHashJob> vJobs;
+            for (size_t i = 0; i < subtrees.size(); i++)
+                vJobs.push_back(CClaimTrieHashJob(this, subtrees[i].second, subtrees[i].first, vHashes[i], vCleaned[i]));
+            {
+                boost::lock_guard<boost::mutex> lock(cs_claimtriehashqueue);
+                CCheckQueueControl<CClaimTrieHashJob> control(&claimtriehashqueue);
+                control.Add(vJobs);
+                control.Wait();
+            }
+            for (size_t i = 0; i < subtrees.size(); i++)
+            {
+                for (hashMapType::iterator ithash = vHashes[i].begin(); ithash != vHashes[i].end(); ++ithash)
+                    cacheHashes[ithash->first] = ithash->second;
+                for (std::vector<std::string>::iterator itName = vCleaned[i].begin(); itName != vCleaned[i].end(); ++itName)
+                    dirtyHashes.erase(*itName);
+            }
+        }
+    }
+    recursiveComputeMerkleHash(root, "", cacheHashes, cleaned);
+    for (std::vector<std::string>::iterator itName = cleaned.begin(); itName != cleaned.end(); ++itName)
+        dirtyHashes.erase(*itName);
+}
+
 uint256 CClaimTrieCache::getMerkleHash() const
 {
     if (empty())
@@ -1246,9 +2017,9 @@ uint256 CClaimTrieCache::getMerkleHash() const
     {
         nodeCacheType::iterator cachedNode = cache.find("");
         if (cachedNode != cache.end())
-            recursiveComputeMerkleHash(cachedNode->second, "");
+            computeMerkleHash(cachedNode->second);
         else
-            recursiveComputeMerkleHash(&(base->root), "");
+            computeMerkleHash(&(base->root));
     }
     hashMapType::iterator ithash = cacheHashes.find("");
     if (ithash != cacheHashes.end())
@@ -1287,6 +2058,25 @@ bool CClaimTrieCache::getOriginalInfoForName(const std::string& name, CClaimValu
     return itOriginalCache->second->getBestClaim(claim);
 }
 
+std::string CClaimTrieCache::getAddressForClaim(const CClaimValue& claim) const
+{
+    // Claims read back from disk have lost saddr, which is not serialized.
+    if (!claim.saddr.empty())
+        return claim.saddr;
+    claimAddressType::const_iterator itAddress = claimAddressCache.find(claim.outPoint);
+    if (itAddress != claimAddressCache.end())
+        return itAddress->second;
+    std::string sAddress;
+    base->getAddressForClaim(claim.outPoint, sAddress);
+    return sAddress;
+}
+
+void CClaimTrieCache::setClaimAddress(const COutPoint& outPoint, const std::string& sAddress) const
+{
+    if (!sAddress.empty())
+        claimAddressCache[outPoint] = sAddress;
+}
+
 bool CClaimTrieCache::insertClaimIntoTrie(const std::string& name, CClaimValue claim, bool fCheckTakeover) const
 {
     if(!base)
@@ -1357,6 +2147,10 @@ bool CClaimTrieCache::insertClaimIntoTrie(const std::string& name, CClaimValue c
     {
         currentNode = addNodeToCache(name, currentNode);
     }
+    claim.saddr = getAddressForClaim(claim);
+    if (!claim.saddr.empty())
+        addressIndexCache[addressNameType(claim.saddr, std::make_pair(name, claim.outPoint))] = true;
+    claimIdIndexCache[claimIdNameType(claim.claimId, std::make_pair(name, claim.outPoint))] = true;
     bool fChanged = false;
     if (currentNode->claims.empty())
     {
@@ -1472,6 +2266,11 @@ bool CClaimTrieCache::removeClaimFromTrie(const std::string& name, const COutPoi
         return false;
     }
 
+    std::string sAddress = getAddressForClaim(claim);
+    if (!sAddress.empty())
+        addressIndexCache[addressNameType(sAddress, std::make_pair(name, outPoint))] = false;
+    claimIdIndexCache[claimIdNameType(claim.claimId, std::make_pair(name, outPoint))] = false;
+
     if (fChanged)
     {
         for (std::string::const_iterator itCur = name.begin(); itCur != name.end(); ++itCur)
@@ -1635,13 +2434,15 @@ bool CClaimTrieCache::addClaim(const std::string& name, const COutPoint& outPoin
         delayForClaim = getDelayForName(name);
     }
     CClaimValue newClaim(outPoint, claimId, nAmount, nHeight, nHeight + delayForClaim,addr,name);
+    setClaimAddress(outPoint, addr);
     return addClaimToQueues(name, newClaim);
 }
 
 bool CClaimTrieCache::undoSpendClaim(const std::string& name, const COutPoint& outPoint, uint160 claimId, CAmount nAmount, int nHeight, int nValidAtHeight,std::string addr) const
 {
     LogPrintf("%s: name: %s, txhash: %s, nOut: %d, claimId: %s, nAmount: %d, nHeight: %d, nValidAtHeight: %d, nCurrentHeight: %d\n", __func__, name, outPoint.hash.GetHex(), outPoint.n, claimId.GetHex(), nAmount, nHeight, nValidAtHeight, nCurrentHeight);
-    CClaimValue claim(outPoint, claimId, nAmount, nHeight, nValidAtHeight,name,addr);
+    CClaimValue claim(outPoint, claimId, nAmount, nHeight, nValidAtHeight,addr,name);
+    setClaimAddress(outPoint, addr);
     if (nValidAtHeight < nCurrentHeight)
     {
         nameOutPointType entry(name, claim.outPoint);
@@ -2607,6 +3408,9 @@ bool CClaimTrieCache::clear() const
     supportQueueNameCache.clear();
     namesToCheckForTakeover.clear();
     cacheTakeoverHeights.clear();
+    addressIndexCache.clear();
+    claimAddressCache.clear();
+    claimIdIndexCache.clear();
     return true;
 }
 
@@ -2614,7 +3418,7 @@ bool CClaimTrieCache::flush()
 {
     if (dirty())
         getMerkleHash();
-    bool success = base->update(cache, cacheHashes, cacheTakeoverHeights, getBestBlock(), claimQueueCache, claimQueueNameCache, expirationQueueCache, nCurrentHeight, supportCache, supportQueueCache, supportQueueNameCache, supportExpirationQueueCache);
+    bool success = base->update(cache, cacheHashes, cacheTakeoverHeights, getBestBlock(), claimQueueCache, claimQueueNameCache, expirationQueueCache, nCurrentHeight, supportCache, supportQueueCache, supportQueueNameCache, supportExpirationQueueCache, addressIndexCache, claimAddressCache, claimIdIndexCache);
     if (success)
     {
         success = clear();
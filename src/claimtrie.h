@@ -12,6 +12,8 @@
 #include "dbwrapper.h"
 #include "primitives/transaction.h"
 
+#include <algorithm>
+#include <atomic>
 #include <string>
 #include <vector>
 #include <map>
@@ -20,14 +22,34 @@
 #define HASH_BLOCK 'h'
 #define CURRENT_HEIGHT 't'
 #define TRIE_NODE 'n'
+#define CLAIM_QUEUE_ENTRY 'R'
+#define CLAIM_QUEUE_NAME_ENTRY 'M'
+#define EXP_QUEUE_ENTRY 'E'
+#define SUPPORT 's'
+#define SUPPORT_QUEUE_ENTRY 'U'
+#define SUPPORT_QUEUE_NAME_ENTRY 'P'
+#define SUPPORT_EXP_QUEUE_ENTRY 'X'
+#define ADDRESS_NAME 'a'
+#define CLAIM_ADDRESS 'A'
+#define CLAIM_ID 'i'
+#define NODE_VERSION 'v'
+#define NODE_VERSION_ROW 'V'
+#define HISTORY_START 'H'
+#define TRIE_DB_VERSION 'D'
+
+// leveldb keys of the old one-value-per-row queues, only read to upgrade them
 #define CLAIM_QUEUE_ROW 'r'
 #define CLAIM_QUEUE_NAME_ROW 'm'
 #define EXP_QUEUE_ROW 'e'
-#define SUPPORT 's'
 #define SUPPORT_QUEUE_ROW 'u'
 #define SUPPORT_QUEUE_NAME_ROW 'p'
 #define SUPPORT_EXP_QUEUE_ROW 'x'
 
+// Version of the claim trie database layout, stored under TRIE_DB_VERSION.
+// 1: queues are stored one entry per claim or support.
+// 2: claims are indexed by claimId.
+static const int CLAIMTRIE_DB_VERSION = 2;
+
 uint256 getValueHash(COutPoint outPoint, int nHeightOfLastTakeover);
 
 class CClaimValue
@@ -137,7 +159,116 @@ class CClaimTrie;
 
 typedef std::vector<CSupportValue> supportMapEntryType;
 
-typedef std::map<unsigned char, CClaimTrieNode*> nodeMapType;
+/**
+ * Children of a trie node, sorted by character in one contiguous vector.
+ * Most nodes have a single child, so this replaces a heap allocated
+ * red-black tree node per character with one small array per node. Offers
+ * the part of the std::map interface the trie uses; unlike std::map,
+ * inserting or erasing invalidates iterators.
+ *
+ * With -claimtriecache the children of a node in CClaimTrie may still be in
+ * the database; they are read the first time they are touched. Copies are
+ * always loaded. The const interface may be used from several threads at
+ * once (the claim trie hashing threads walk the base trie), so loading is
+ * serialized and the access bit is atomic.
+ */
+class CClaimTrieChildren
+{
+public:
+    typedef std::pair<unsigned char, CClaimTrieNode*> value_type;
+    typedef std::vector<value_type>::iterator iterator;
+    typedef std::vector<value_type>::const_iterator const_iterator;
+
+    CClaimTrieChildren() : pStub(NULL), fUsed(false) {}
+    CClaimTrieChildren(const CClaimTrieChildren& other) : pStub(NULL), fUsed(false)
+    {
+        other.load();
+        vChildren = other.vChildren;
+    }
+    ~CClaimTrieChildren() { delete pStub.load(); }
+
+    CClaimTrieChildren& operator=(const CClaimTrieChildren& other)
+    {
+        if (this != &other)
+        {
+            other.load();
+            vChildren = other.vChildren;
+            delete pStub.exchange(NULL);
+        }
+        return *this;
+    }
+
+    iterator begin() { load(); return vChildren.begin(); }
+    iterator end() { load(); return vChildren.end(); }
+    const_iterator begin() const { load(); return vChildren.begin(); }
+    const_iterator end() const { load(); return vChildren.end(); }
+    size_t size() const { load(); return vChildren.size(); }
+    bool empty() const { load(); return vChildren.empty(); }
+    void clear() { delete pStub.exchange(NULL); std::vector<value_type>().swap(vChildren); }
+    bool loaded() const { return pStub.load(std::memory_order_acquire) == NULL; }
+
+    iterator find(unsigned char c)
+    {
+        iterator it = lower_bound(c);
+        return (it != vChildren.end() && it->first == c) ? it : vChildren.end();
+    }
+
+    const_iterator find(unsigned char c) const
+    {
+        load();
+        const_iterator it = std::lower_bound(vChildren.begin(), vChildren.end(), c, keycompare());
+        return (it != vChildren.end() && it->first == c) ? it : vChildren.end();
+    }
+
+    CClaimTrieNode*& operator[](unsigned char c)
+    {
+        iterator it = lower_bound(c);
+        if (it == vChildren.end() || it->first != c)
+            it = vChildren.insert(it, value_type(c, NULL));
+        return it->second;
+    }
+
+    //! Returns the iterator following the erased child
+    iterator erase(iterator it) { return vChildren.erase(it); }
+
+private:
+    friend class CClaimTrie;
+
+    struct keycompare
+    {
+        bool operator()(const value_type& child, unsigned char c) const { return child.first < c; }
+    };
+
+    //! Where to read children that are not in memory yet
+    struct stub
+    {
+        const CClaimTrie* pTrie;
+        std::string name;
+    };
+
+    void load() const
+    {
+        fUsed.store(true, std::memory_order_relaxed);
+        if (!loaded())
+            loadFromDisk();
+    }
+    void loadFromDisk() const;
+    void setStub(stub* pStubIn) { delete pStub.exchange(pStubIn); }
+
+    iterator lower_bound(unsigned char c)
+    {
+        load();
+        return std::lower_bound(vChildren.begin(), vChildren.end(), c, keycompare());
+    }
+
+    mutable std::vector<value_type> vChildren;
+    //! Set while the children are on disk only; cleared after vChildren is filled
+    mutable std::atomic<stub*> pStub;
+    //! Touched since the last eviction pass
+    mutable std::atomic<bool> fUsed;
+};
+
+typedef CClaimTrieChildren nodeMapType;
 
 typedef std::pair<std::string, CClaimTrieNode> namedNodeType;
 
@@ -275,6 +406,88 @@ typedef std::map<std::string, CClaimTrieNode*, nodenamecompare> nodeCacheType;
 
 typedef std::map<std::string, uint256> hashMapType;
 
+// (address, (name, outPoint)) of a claim in the trie -> whether it was added or removed
+typedef std::pair<std::string, std::pair<std::string, COutPoint> > addressNameType;
+typedef std::map<addressNameType, bool> addressIndexType;
+
+typedef std::map<COutPoint, std::string> claimAddressType;
+
+// (claimId, (name, outPoint)) of a claim in the trie -> whether it was added or removed
+typedef std::pair<uint160, std::pair<std::string, COutPoint> > claimIdNameType;
+typedef std::map<claimIdNameType, bool> claimIdIndexType;
+
+//! Default for -claimtriecache, in MiB
+static const int DEFAULT_CLAIMTRIE_CACHE = 100;
+
+//! Default for -claimtriehistory, how deep a block can be to build proofs for it
+static const int DEFAULT_CLAIMTRIE_HISTORY = 1000;
+
+//! Default for -checkclaimtrie, whether the startup check also reads the nodes left on disk
+static const bool DEFAULT_CHECK_CLAIMTRIE = false;
+
+/** A height serialized big-endian, so that leveldb keys sort by it */
+class CBigEndianHeight
+{
+public:
+    int nHeight;
+
+    CBigEndianHeight() : nHeight(0) {}
+    CBigEndianHeight(int nHeight) : nHeight(nHeight) {}
+
+    bool operator==(const CBigEndianHeight& other) const { return nHeight == other.nHeight; }
+    bool operator!=(const CBigEndianHeight& other) const { return nHeight != other.nHeight; }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return 4;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        ser_writedata32be(s, nHeight);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        nHeight = ser_readdata32be(s);
+    }
+};
+
+/**
+ * What a proof needs to know about a node: the hashes of its children and
+ * its controlling claim. Kept for the nodes a block changed, keyed by the
+ * height the block moved the trie to, so older states of the trie can be
+ * walked without disconnecting blocks.
+ */
+class CClaimTrieNodeVersion
+{
+public:
+    std::vector<std::pair<unsigned char, uint256> > children;
+    bool hasValue;
+    COutPoint outPoint;
+    int nHeightOfLastTakeover;
+
+    CClaimTrieNodeVersion() : hasValue(false), nHeightOfLastTakeover(0) {}
+    CClaimTrieNodeVersion(const CClaimTrieNode& node);
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(children);
+        READWRITE(hasValue);
+        READWRITE(outPoint);
+        READWRITE(nHeightOfLastTakeover);
+    }
+};
+
+typedef std::vector<std::pair<std::string, CClaimTrieNodeVersion> > nodeVersionRowType;
+// height -> the nodes as they were before the trie reached that height; an
+// empty row erases the height
+typedef std::map<int, nodeVersionRowType> nodeVersionRowsType;
+
 struct claimsForNameType
 {
     std::vector<CClaimValue> claims;
@@ -286,6 +499,7 @@ struct claimsForNameType
 };
 
 class CClaimTrieCache;
+class CClaimTrieProof;
 
 class CClaimTrie
 {
@@ -294,6 +508,7 @@ public:
                : db(GetDataDir() / "claimtrie", 100, fMemory, fWipe, false)
                , nCurrentHeight(1), nExpirationTime(262974)
                , nProportionalDelayFactor(nProportionalDelayFactor)
+               , nHistoryDepth(DEFAULT_CLAIMTRIE_HISTORY), nHistoryStart(1), nCacheSize(0)
                , root(uint256S("0000000000000000000000000000000000000000000000000000000000000000"))
     {}
     
@@ -302,12 +517,25 @@ public:
     bool empty() const;
     void clear();
     
-    bool checkConsistency() const;
+    /**
+     * Recompute the node hashes and compare them with the stored ones. With
+     * -claimtriecache only the nodes in memory are checked, unless fFull is
+     * set.
+     */
+    bool checkConsistency(bool fFull = false) const;
     
     bool WriteToDisk();
-    bool ReadFromDisk(bool check = false);
+    bool ReadFromDisk(bool check = false, bool fFullCheck = false);
     
     std::vector<namedNodeType> flattenTrie() const;
+    /**
+     * Up to nLimit nodes (0 for all) in name order, starting at startName,
+     * without their children. With fClaimsOnly only nodes holding claims
+     * are returned. Returns whether there are more, nextName being where
+     * the next page starts.
+     */
+    bool getNodesFrom(const std::string& startName, size_t nLimit, bool fClaimsOnly,
+                      std::vector<namedNodeType>& nodes, std::string& nextName) const;
     bool getInfoForName(const std::string& name, CClaimValue& claim) const;
     bool getLastTakeoverForName(const std::string& name, int& lastTakeoverHeight) const;
 
@@ -321,6 +549,8 @@ public:
     bool supportExpirationQueueEmpty() const;
     
     void setExpirationTime(int t);
+    void setHistoryDepth(int nDepth);
+    void setCacheSize(size_t nBytes);
     
     bool getQueueRow(int nHeight, claimQueueRowType& row) const;
     bool getQueueNameRow(const std::string& name, queueNameRowType& row) const;
@@ -341,14 +571,26 @@ public:
     unsigned int getTotalNamesInTrie() const;
     unsigned int getTotalClaimsInTrie() const;
     CAmount getTotalValueOfClaimsInTrie(bool fControllingOnly) const;
+
+    bool getAddressForClaim(const COutPoint& outPoint, std::string& sAddress) const;
+    std::vector<nameOutPointType> getNamesForAddress(const std::string& sAddress) const;
+    bool getClaimById(const uint160& claimId, std::string& name, CClaimValue& claim) const;
+
+    int getOldestProofHeight() const;
+    bool getProofForName(const std::string& name, int nHeight, CClaimTrieProof& proof) const;
     
     friend class CClaimTrieCache;
+    friend class CClaimTrieChildren;
     
     // leveldb 
     CDBWrapper db;
     int nCurrentHeight;
     int nExpirationTime;
     int nProportionalDelayFactor;
+    int nHistoryDepth;
+    int nHistoryStart;
+    //! Bytes of nodes to keep in memory, 0 to load the whole trie
+    size_t nCacheSize;
     const CClaimTrieNode* getNodeForName(const std::string& name) const;
 private:
     void clear(CClaimTrieNode* current);
@@ -362,15 +604,29 @@ private:
                 supportMapType& supportCache,
                 supportQueueType& supportQueueCache,
                 queueNameType& supportQueueNameCache,
-                expirationQueueType& supportExpirationQueueCache);
+                expirationQueueType& supportExpirationQueueCache,
+                addressIndexType& addressIndexCache,
+                claimAddressType& claimAddressCache,
+                claimIdIndexType& claimIdIndexCache);
     bool updateName(const std::string& name, CClaimTrieNode* updatedNode);
+    void recordNodeVersions(const nodeCacheType& cache, const hashMapType& hashes, int nHeight);
+    void eraseNodeVersions(int nHeight);
+    void pruneNodeVersions(int nHeight);
+    bool getNodeVersion(const std::string& name, int nTrieHeight, CClaimTrieNodeVersion& version) const;
     bool updateHash(const std::string& name, uint256& hash);
     bool updateTakeoverHeight(const std::string& name, int nTakeoverHeight);
     bool recursiveNullify(CClaimTrieNode* node, std::string& name);
     
-    bool recursiveCheckConsistency(const CClaimTrieNode* node) const;
+    bool recursiveCheckConsistency(const CClaimTrieNode* node, std::string& name, bool fFull) const;
     
     bool InsertFromDisk(const std::string& name, CClaimTrieNode* node);
+    void loadChildren(const std::string& name, std::vector<CClaimTrieChildren::value_type>& children) const;
+    void unloadChildren(CClaimTrieNode* node, const std::string& name) const;
+    size_t recursiveDynamicUsage(const CClaimTrieNode* node) const;
+    void recursiveEvict(CClaimTrieNode* node, std::string& name, size_t& nUsage);
+    void evictNodes();
+    bool upgradeQueueRows();
+    bool indexClaimIds();
     
     unsigned int getTotalNamesRecursive(const CClaimTrieNode* current) const;
     unsigned int getTotalClaimsRecursive(const CClaimTrieNode* current) const;
@@ -379,6 +635,9 @@ private:
     bool recursiveFlattenTrie(const std::string& name,
                               const CClaimTrieNode* current,
                               std::vector<namedNodeType>& nodes) const;
+    bool recursiveGetNodesFrom(std::string& name, const CClaimTrieNode* current,
+                               const std::string& startName, size_t nLimit, bool fClaimsOnly,
+                               std::vector<namedNodeType>& nodes, std::string& nextName) const;
     
     void markNodeDirty(const std::string& name, CClaimTrieNode* node);
     void updateQueueRow(int nHeight, claimQueueRowType& row);
@@ -401,11 +660,17 @@ private:
     void BatchWriteSupportQueueRows(CDBBatch& batch);
     void BatchWriteSupportQueueNameRows(CDBBatch& batch);
     void BatchWriteSupportExpirationQueueRows(CDBBatch& batch);
+    void BatchWriteAddressIndex(CDBBatch& batch);
+    void BatchWriteClaimIdIndex(CDBBatch& batch);
+    void BatchWriteNodeVersionRows(CDBBatch& batch);
     template<typename K> bool keyTypeEmpty(char key, K& dummy) const;
     
     CClaimTrieNode root;
     uint256 hashBlock;
     
+    // Rows changed since the last write. Each replaces its row on disk, which
+    // is stored as one entry per claim or support so only the entries that
+    // differ are written.
     claimQueueType dirtyQueueRows;
     queueNameType dirtyQueueNameRows;
     expirationQueueType dirtyExpirationQueueRows;
@@ -414,8 +679,24 @@ private:
     queueNameType dirtySupportQueueNameRows;
     expirationQueueType dirtySupportExpirationQueueRows;
     
+    // What the rows read since the last write hold on disk, so writing a
+    // changed row does not have to read it again to find what differs
+    mutable claimQueueType diskQueueRows;
+    mutable queueNameType diskQueueNameRows;
+    mutable expirationQueueType diskExpirationQueueRows;
+    
+    mutable supportQueueType diskSupportQueueRows;
+    mutable queueNameType diskSupportQueueNameRows;
+    mutable expirationQueueType diskSupportExpirationQueueRows;
+    
     nodeCacheType dirtyNodes;
     supportMapType dirtySupportNodes;
+
+    addressIndexType dirtyAddressIndex;
+    claimAddressType dirtyClaimAddresses;
+    claimIdIndexType dirtyClaimIdIndex;
+
+    nodeVersionRowsType dirtyNodeVersionRows;
 };
 
 class CClaimTrieProofNode
@@ -442,8 +723,15 @@ public:
     int nHeightOfLastTakeover;
 };
 
+/** Number of threads, including the caller, that recompute dirty root subtrees */
+extern int nClaimTrieHashThreads;
+
+/** Run an instance of the claim trie hashing thread */
+void ThreadClaimTrieHash();
+
 class CClaimTrieCache
 {
+    friend class CClaimTrieHashJob;
 public:
     CClaimTrieCache(CClaimTrie* base, bool fRequireTakeoverHeights = true)
                     : base(base),
@@ -522,6 +810,9 @@ private:
     mutable expirationQueueType supportExpirationQueueCache;
     mutable std::set<std::string> namesToCheckForTakeover;
     mutable std::map<std::string, int> cacheTakeoverHeights; 
+    mutable addressIndexType addressIndexCache;
+    mutable claimAddressType claimAddressCache;
+    mutable claimIdIndexType claimIdIndexCache;
     mutable int nCurrentHeight; // Height of the block that is being worked on, which is
                                 // one greater than the height of the chain's tip
     
@@ -531,7 +822,10 @@ private:
     
     bool reorderTrieNode(const std::string& name, bool fCheckTakeover) const;
     bool recursiveComputeMerkleHash(CClaimTrieNode* tnCurrent,
-                                    std::string sPos) const;
+                                    const std::string& sPos,
+                                    hashMapType& hashes,
+                                    std::vector<std::string>& cleaned) const;
+    void computeMerkleHash(CClaimTrieNode* root) const;
     bool recursivePruneName(CClaimTrieNode* tnCurrent, unsigned int nPos,
                             std::string sName,
                             bool* pfNullified = NULL) const;
@@ -597,6 +891,9 @@ private:
 
     bool getOriginalInfoForName(const std::string& name, CClaimValue& claim) const;
 
+    std::string getAddressForClaim(const CClaimValue& claim) const;
+    void setClaimAddress(const COutPoint& outPoint, const std::string& sAddress) const;
+
     int getNumBlocksOfContinuousOwnership(const std::string& name) const;
 };
 
@@ -48,6 +48,7 @@
 
 #ifdef WIN32
 #define MSG_DONTWAIT        0
+#define WSAEAGAIN           WSAEWOULDBLOCK
 #else
 typedef u_int SOCKET;
 #include "errno.h"
@@ -55,6 +56,7 @@ typedef u_int SOCKET;
 #define WSAEINVAL           EINVAL
 #define WSAEALREADY         EALREADY
 #define WSAEWOULDBLOCK      EWOULDBLOCK
+#define WSAEAGAIN           EAGAIN
 #define WSAEMSGSIZE         EMSGSIZE
 #define WSAEINTR            EINTR
 #define WSAEINPROGRESS      EINPROGRESS
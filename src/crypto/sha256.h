@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
 
 /** A hasher class for SHA-256. */
 class CSHA256
@@ -25,4 +26,19 @@ public:
     CSHA256& Reset();
 };
 
+/** Autodetect the best available SHA256 implementation and switch to it.
+ *  Call once at startup, before other threads hash anything.
+ *  Returns the name of the implementation.
+ */
+std::string SHA256AutoDetect();
+
+/** Compute multiple double-SHA256's of 64-byte blobs.
+ *  output:  pointer to a blocks*32 byte output buffer
+ *  input:   pointer to a blocks*64 byte input buffer
+ *  blocks:  the number of hashes to compute.
+ *  output may be the same buffer as input (each level of a Merkle tree is
+ *  half the size of the one below it).
+ */
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
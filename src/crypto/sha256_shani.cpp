@@ -0,0 +1,285 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// SHA-256 on the Intel SHA extensions. The state is kept as the ABEF/CDGH
+// register pair that sha256rnds2 works on; each QuadRound does four rounds.
+
+#include "crypto/sha256_x86.h"
+
+#ifdef USE_X86_SHA256
+
+#include <immintrin.h>
+
+#define SHANI_INLINE inline __attribute__((always_inline, target("sse4.1,sha")))
+#define SHANI_FUNCTION __attribute__((target("sse4.1,sha")))
+
+namespace
+{
+using sha256_tables::K;
+using sha256_tables::KPadding64;
+
+SHANI_INLINE void QuadRound(__m128i& s0, __m128i& s1, __m128i kw)
+{
+    s1 = _mm_sha256rnds2_epu32(s1, s0, kw);
+    s0 = _mm_sha256rnds2_epu32(s0, s1, _mm_shuffle_epi32(kw, 0x0e));
+}
+
+/** Rounds 4*i..4*i+3 on message words m. */
+SHANI_INLINE void QuadRound(__m128i& s0, __m128i& s1, __m128i m, int i)
+{
+    QuadRound(s0, s1, _mm_add_epi32(m, _mm_loadu_si128((const __m128i*)&K[4 * i])));
+}
+
+/** Rounds 4*i..4*i+3 of the padding block of a 64-byte message. */
+SHANI_INLINE void QuadRoundPadding(__m128i& s0, __m128i& s1, int i)
+{
+    QuadRound(s0, s1, _mm_loadu_si128((const __m128i*)&KPadding64[4 * i]));
+}
+
+/** First half of the message schedule step for m0, needs m1. */
+SHANI_INLINE void ShiftMessageA(__m128i& m0, __m128i m1)
+{
+    m0 = _mm_sha256msg1_epu32(m0, m1);
+}
+
+/** Next four message words into m2, from m0 (before ShiftMessageA) and m1. */
+SHANI_INLINE void ShiftMessageC(__m128i m0, __m128i m1, __m128i& m2)
+{
+    m2 = _mm_sha256msg2_epu32(_mm_add_epi32(m2, _mm_alignr_epi8(m1, m0, 4)), m1);
+}
+
+SHANI_INLINE void ShiftMessageB(__m128i& m0, __m128i m1, __m128i& m2)
+{
+    ShiftMessageC(m0, m1, m2);
+    ShiftMessageA(m0, m1);
+}
+
+/** s[0..3], s[4..7] to ABEF, CDGH. */
+SHANI_INLINE void Shuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0xB1);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0x1B);
+    s0 = _mm_alignr_epi8(t1, t2, 0x08);
+    s1 = _mm_blend_epi16(t2, t1, 0xF0);
+}
+
+/** ABEF, CDGH back to s[0..3], s[4..7]. */
+SHANI_INLINE void Unshuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0x1B);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0xB1);
+    s0 = _mm_blend_epi16(t1, t2, 0xF0);
+    s1 = _mm_alignr_epi8(t2, t1, 0x08);
+}
+
+/** Byte swap of each 32-bit word. */
+SHANI_INLINE __m128i ByteSwap(__m128i v)
+{
+    return _mm_shuffle_epi8(v, _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL));
+}
+
+SHANI_INLINE __m128i Load(const unsigned char* in)
+{
+    return ByteSwap(_mm_loadu_si128((const __m128i*)in));
+}
+
+SHANI_INLINE void Save(unsigned char* out, __m128i s)
+{
+    _mm_storeu_si128((__m128i*)out, ByteSwap(s));
+}
+
+/** The initial state, already in ABEF/CDGH order. */
+SHANI_INLINE void Initialize(__m128i& s0, __m128i& s1)
+{
+    s0 = _mm_set_epi32(0x6a09e667, 0xbb67ae85, 0x510e527f, 0x9b05688c);
+    s1 = _mm_set_epi32(0x3c6ef372, 0xa54ff53a, 0x1f83d9ab, 0x5be0cd19);
+}
+
+/** The 64 rounds over message words m0..m3, the first sixteen. */
+SHANI_INLINE void Rounds(__m128i& s0, __m128i& s1, __m128i m0, __m128i m1, __m128i m2, __m128i m3)
+{
+    QuadRound(s0, s1, m0, 0);
+    QuadRound(s0, s1, m1, 1);
+    ShiftMessageA(m0, m1);
+    QuadRound(s0, s1, m2, 2);
+    ShiftMessageA(m1, m2);
+    QuadRound(s0, s1, m3, 3);
+    ShiftMessageB(m2, m3, m0);
+    QuadRound(s0, s1, m0, 4);
+    ShiftMessageB(m3, m0, m1);
+    QuadRound(s0, s1, m1, 5);
+    ShiftMessageB(m0, m1, m2);
+    QuadRound(s0, s1, m2, 6);
+    ShiftMessageB(m1, m2, m3);
+    QuadRound(s0, s1, m3, 7);
+    ShiftMessageB(m2, m3, m0);
+    QuadRound(s0, s1, m0, 8);
+    ShiftMessageB(m3, m0, m1);
+    QuadRound(s0, s1, m1, 9);
+    ShiftMessageB(m0, m1, m2);
+    QuadRound(s0, s1, m2, 10);
+    ShiftMessageB(m1, m2, m3);
+    QuadRound(s0, s1, m3, 11);
+    ShiftMessageB(m2, m3, m0);
+    QuadRound(s0, s1, m0, 12);
+    ShiftMessageB(m3, m0, m1);
+    QuadRound(s0, s1, m1, 13);
+    ShiftMessageC(m0, m1, m2);
+    QuadRound(s0, s1, m2, 14);
+    ShiftMessageC(m1, m2, m3);
+    QuadRound(s0, s1, m3, 15);
+}
+
+/** Two independent Rounds interleaved, so the rounds of one hide the latency of the other. */
+SHANI_INLINE void Rounds2(__m128i& s0, __m128i& s1, __m128i m0, __m128i m1, __m128i m2, __m128i m3,
+                          __m128i& t0, __m128i& t1, __m128i n0, __m128i n1, __m128i n2, __m128i n3)
+{
+    QuadRound(s0, s1, m0, 0);
+    QuadRound(t0, t1, n0, 0);
+    QuadRound(s0, s1, m1, 1);
+    QuadRound(t0, t1, n1, 1);
+    ShiftMessageA(m0, m1);
+    ShiftMessageA(n0, n1);
+    QuadRound(s0, s1, m2, 2);
+    QuadRound(t0, t1, n2, 2);
+    ShiftMessageA(m1, m2);
+    ShiftMessageA(n1, n2);
+    QuadRound(s0, s1, m3, 3);
+    QuadRound(t0, t1, n3, 3);
+    ShiftMessageB(m2, m3, m0);
+    ShiftMessageB(n2, n3, n0);
+    QuadRound(s0, s1, m0, 4);
+    QuadRound(t0, t1, n0, 4);
+    ShiftMessageB(m3, m0, m1);
+    ShiftMessageB(n3, n0, n1);
+    QuadRound(s0, s1, m1, 5);
+    QuadRound(t0, t1, n1, 5);
+    ShiftMessageB(m0, m1, m2);
+    ShiftMessageB(n0, n1, n2);
+    QuadRound(s0, s1, m2, 6);
+    QuadRound(t0, t1, n2, 6);
+    ShiftMessageB(m1, m2, m3);
+    ShiftMessageB(n1, n2, n3);
+    QuadRound(s0, s1, m3, 7);
+    QuadRound(t0, t1, n3, 7);
+    ShiftMessageB(m2, m3, m0);
+    ShiftMessageB(n2, n3, n0);
+    QuadRound(s0, s1, m0, 8);
+    QuadRound(t0, t1, n0, 8);
+    ShiftMessageB(m3, m0, m1);
+    ShiftMessageB(n3, n0, n1);
+    QuadRound(s0, s1, m1, 9);
+    QuadRound(t0, t1, n1, 9);
+    ShiftMessageB(m0, m1, m2);
+    ShiftMessageB(n0, n1, n2);
+    QuadRound(s0, s1, m2, 10);
+    QuadRound(t0, t1, n2, 10);
+    ShiftMessageB(m1, m2, m3);
+    ShiftMessageB(n1, n2, n3);
+    QuadRound(s0, s1, m3, 11);
+    QuadRound(t0, t1, n3, 11);
+    ShiftMessageB(m2, m3, m0);
+    ShiftMessageB(n2, n3, n0);
+    QuadRound(s0, s1, m0, 12);
+    QuadRound(t0, t1, n0, 12);
+    ShiftMessageB(m3, m0, m1);
+    ShiftMessageB(n3, n0, n1);
+    QuadRound(s0, s1, m1, 13);
+    QuadRound(t0, t1, n1, 13);
+    ShiftMessageC(m0, m1, m2);
+    ShiftMessageC(n0, n1, n2);
+    QuadRound(s0, s1, m2, 14);
+    QuadRound(t0, t1, n2, 14);
+    ShiftMessageC(m1, m2, m3);
+    ShiftMessageC(n1, n2, n3);
+    QuadRound(s0, s1, m3, 15);
+    QuadRound(t0, t1, n3, 15);
+}
+
+/** The rounds of the padding block after a 64-byte message, two states at once. */
+SHANI_INLINE void RoundsPadding2(__m128i& s0, __m128i& s1, __m128i& t0, __m128i& t1)
+{
+    for (int i = 0; i < 16; ++i) {
+        QuadRoundPadding(s0, s1, i);
+        QuadRoundPadding(t0, t1, i);
+    }
+}
+} // namespace
+
+namespace sha256_shani
+{
+SHANI_FUNCTION void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    __m128i s0 = _mm_loadu_si128((const __m128i*)s);
+    __m128i s1 = _mm_loadu_si128((const __m128i*)(s + 4));
+    Shuffle(s0, s1);
+
+    while (blocks--) {
+        const __m128i so0 = s0, so1 = s1;
+        Rounds(s0, s1, Load(chunk), Load(chunk + 16), Load(chunk + 32), Load(chunk + 48));
+        s0 = _mm_add_epi32(s0, so0);
+        s1 = _mm_add_epi32(s1, so1);
+        chunk += 64;
+    }
+
+    Unshuffle(s0, s1);
+    _mm_storeu_si128((__m128i*)s, s0);
+    _mm_storeu_si128((__m128i*)(s + 4), s1);
+}
+} // namespace sha256_shani
+
+namespace sha256d64_shani
+{
+SHANI_FUNCTION void Transform_2way(unsigned char* out, const unsigned char* in)
+{
+    __m128i as0, as1, bs0, bs1, ai0, ai1, bi0, bi1;
+
+    // Transform 1: the messages.
+    Initialize(as0, as1);
+    Initialize(bs0, bs1);
+    Rounds2(as0, as1, Load(in), Load(in + 16), Load(in + 32), Load(in + 48),
+            bs0, bs1, Load(in + 64), Load(in + 80), Load(in + 96), Load(in + 112));
+    Initialize(ai0, ai1);
+    as0 = _mm_add_epi32(as0, ai0);
+    as1 = _mm_add_epi32(as1, ai1);
+    bs0 = _mm_add_epi32(bs0, ai0);
+    bs1 = _mm_add_epi32(bs1, ai1);
+
+    // Transform 2: their padding, whose schedule is precomputed.
+    ai0 = as0;
+    ai1 = as1;
+    bi0 = bs0;
+    bi1 = bs1;
+    RoundsPadding2(as0, as1, bs0, bs1);
+    as0 = _mm_add_epi32(as0, ai0);
+    as1 = _mm_add_epi32(as1, ai1);
+    bs0 = _mm_add_epi32(bs0, bi0);
+    bs1 = _mm_add_epi32(bs1, bi1);
+
+    // Transform 3: the 32-byte first hashes, padded. The state words are the
+    // message words, no byte swapping needed.
+    Unshuffle(as0, as1);
+    Unshuffle(bs0, bs1);
+    const __m128i pad0 = _mm_set_epi32(0, 0, 0, 0x80000000);
+    const __m128i pad1 = _mm_set_epi32(0x100, 0, 0, 0);
+    const __m128i am0 = as0, am1 = as1, bm0 = bs0, bm1 = bs1;
+    Initialize(as0, as1);
+    Initialize(bs0, bs1);
+    Rounds2(as0, as1, am0, am1, pad0, pad1, bs0, bs1, bm0, bm1, pad0, pad1);
+    Initialize(ai0, ai1);
+    as0 = _mm_add_epi32(as0, ai0);
+    as1 = _mm_add_epi32(as1, ai1);
+    bs0 = _mm_add_epi32(bs0, ai0);
+    bs1 = _mm_add_epi32(bs1, ai1);
+
+    Unshuffle(as0, as1);
+    Unshuffle(bs0, bs1);
+    Save(out, as0);
+    Save(out + 16, as1);
+    Save(out + 32, bs0);
+    Save(out + 48, bs1);
+}
+} // namespace sha256d64_shani
+
+#endif // USE_X86_SHA256
@@ -0,0 +1,165 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Four double-SHA256's of 64-byte messages at once, one per 32-bit lane of
+// an SSE register.
+
+#include "crypto/sha256_x86.h"
+
+#ifdef USE_X86_SHA256
+
+#include "crypto/common.h"
+
+#include <immintrin.h>
+
+#define SSE41_INLINE inline __attribute__((always_inline, target("sse4.1")))
+#define SSE41_FUNCTION __attribute__((target("sse4.1")))
+
+namespace
+{
+using sha256_tables::K;
+using sha256_tables::KPadding64;
+
+SSE41_INLINE __m128i Const(uint32_t x) { return _mm_set1_epi32(x); }
+
+SSE41_INLINE __m128i Add(__m128i x, __m128i y) { return _mm_add_epi32(x, y); }
+SSE41_INLINE __m128i Add(__m128i x, __m128i y, __m128i z) { return Add(Add(x, y), z); }
+SSE41_INLINE __m128i Add(__m128i w, __m128i x, __m128i y, __m128i z) { return Add(Add(w, x), Add(y, z)); }
+SSE41_INLINE __m128i Add(__m128i v, __m128i w, __m128i x, __m128i y, __m128i z) { return Add(Add(v, w, x), Add(y, z)); }
+SSE41_INLINE __m128i Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+SSE41_INLINE __m128i Xor(__m128i x, __m128i y, __m128i z) { return Xor(Xor(x, y), z); }
+SSE41_INLINE __m128i Or(__m128i x, __m128i y) { return _mm_or_si128(x, y); }
+SSE41_INLINE __m128i And(__m128i x, __m128i y) { return _mm_and_si128(x, y); }
+SSE41_INLINE __m128i ShR(__m128i x, int n) { return _mm_srli_epi32(x, n); }
+SSE41_INLINE __m128i ShL(__m128i x, int n) { return _mm_slli_epi32(x, n); }
+
+SSE41_INLINE __m128i Ch(__m128i x, __m128i y, __m128i z) { return Xor(z, And(x, Xor(y, z))); }
+SSE41_INLINE __m128i Maj(__m128i x, __m128i y, __m128i z) { return Or(And(x, y), And(z, Or(x, y))); }
+SSE41_INLINE __m128i Sigma0(__m128i x) { return Xor(Or(ShR(x, 2), ShL(x, 30)), Or(ShR(x, 13), ShL(x, 19)), Or(ShR(x, 22), ShL(x, 10))); }
+SSE41_INLINE __m128i Sigma1(__m128i x) { return Xor(Or(ShR(x, 6), ShL(x, 26)), Or(ShR(x, 11), ShL(x, 21)), Or(ShR(x, 25), ShL(x, 7))); }
+SSE41_INLINE __m128i sigma0(__m128i x) { return Xor(Or(ShR(x, 7), ShL(x, 25)), Or(ShR(x, 18), ShL(x, 14)), ShR(x, 3)); }
+SSE41_INLINE __m128i sigma1(__m128i x) { return Xor(Or(ShR(x, 17), ShL(x, 15)), Or(ShR(x, 19), ShL(x, 13)), ShR(x, 10)); }
+
+/** Word i of each of the four 64-byte messages. */
+SSE41_INLINE __m128i Read4(const unsigned char* in, int i)
+{
+    return _mm_set_epi32(ReadBE32(in + 192 + 4 * i), ReadBE32(in + 128 + 4 * i), ReadBE32(in + 64 + 4 * i), ReadBE32(in + 4 * i));
+}
+
+/** Word i of each of the four 32-byte hashes. */
+SSE41_INLINE void Write4(unsigned char* out, int i, __m128i v)
+{
+    WriteBE32(out + 4 * i, _mm_extract_epi32(v, 0));
+    WriteBE32(out + 32 + 4 * i, _mm_extract_epi32(v, 1));
+    WriteBE32(out + 64 + 4 * i, _mm_extract_epi32(v, 2));
+    WriteBE32(out + 96 + 4 * i, _mm_extract_epi32(v, 3));
+}
+
+SSE41_INLINE void Initialize(__m128i s[8])
+{
+    s[0] = Const(0x6a09e667ul);
+    s[1] = Const(0xbb67ae85ul);
+    s[2] = Const(0x3c6ef372ul);
+    s[3] = Const(0xa54ff53aul);
+    s[4] = Const(0x510e527ful);
+    s[5] = Const(0x9b05688cul);
+    s[6] = Const(0x1f83d9abul);
+    s[7] = Const(0x5be0cd19ul);
+}
+
+/** One round; the caller rotates the roles of a..h. */
+SSE41_INLINE void Round(__m128i a, __m128i b, __m128i c, __m128i& d, __m128i e, __m128i f, __m128i g, __m128i& h, __m128i kw)
+{
+    __m128i t1 = Add(h, Sigma1(e), Ch(e, f, g), kw);
+    __m128i t2 = Add(Sigma0(a), Maj(a, b, c));
+    d = Add(d, t1);
+    h = Add(t1, t2);
+}
+
+/** Eight rounds starting at round i, with kw giving K + W for each. */
+#define SSE41_ROUNDS8(i, kw)                              \
+    do {                                                  \
+        Round(a, b, c, d, e, f, g, h, kw((i) + 0));       \
+        Round(h, a, b, c, d, e, f, g, kw((i) + 1));       \
+        Round(g, h, a, b, c, d, e, f, kw((i) + 2));       \
+        Round(f, g, h, a, b, c, d, e, kw((i) + 3));       \
+        Round(e, f, g, h, a, b, c, d, kw((i) + 4));       \
+        Round(d, e, f, g, h, a, b, c, kw((i) + 5));       \
+        Round(c, d, e, f, g, h, a, b, kw((i) + 6));       \
+        Round(b, c, d, e, f, g, h, a, kw((i) + 7));       \
+    } while (0)
+
+/** Add the 64 rounds over the message words w to the state s. */
+SSE41_FUNCTION void Transform(__m128i s[8], __m128i w[16])
+{
+    __m128i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+
+#define KW(r) ((r) < 16 ? Add(w[(r)], Const(K[(r)])) : Add(w[(r) & 15] = Add(sigma1(w[((r) - 2) & 15]), w[((r) - 7) & 15], sigma0(w[((r) - 15) & 15]), w[(r) & 15]), Const(K[(r)])))
+    for (int i = 0; i < 64; i += 8)
+        SSE41_ROUNDS8(i, KW);
+#undef KW
+
+    s[0] = Add(s[0], a);
+    s[1] = Add(s[1], b);
+    s[2] = Add(s[2], c);
+    s[3] = Add(s[3], d);
+    s[4] = Add(s[4], e);
+    s[5] = Add(s[5], f);
+    s[6] = Add(s[6], g);
+    s[7] = Add(s[7], h);
+}
+
+/** Add the 64 rounds of the padding block after a 64-byte message to the state s. */
+SSE41_FUNCTION void TransformPadding(__m128i s[8])
+{
+    __m128i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+
+#define KW(r) Const(KPadding64[(r)])
+    for (int i = 0; i < 64; i += 8)
+        SSE41_ROUNDS8(i, KW);
+#undef KW
+
+    s[0] = Add(s[0], a);
+    s[1] = Add(s[1], b);
+    s[2] = Add(s[2], c);
+    s[3] = Add(s[3], d);
+    s[4] = Add(s[4], e);
+    s[5] = Add(s[5], f);
+    s[6] = Add(s[6], g);
+    s[7] = Add(s[7], h);
+}
+#undef SSE41_ROUNDS8
+} // namespace
+
+namespace sha256d64_sse41
+{
+SSE41_FUNCTION void Transform_4way(unsigned char* out, const unsigned char* in)
+{
+    __m128i s[8], w[16];
+
+    // Transform 1: the messages.
+    for (int i = 0; i < 16; ++i)
+        w[i] = Read4(in, i);
+    Initialize(s);
+    Transform(s, w);
+
+    // Transform 2: their padding.
+    TransformPadding(s);
+
+    // Transform 3: the 32-byte first hashes, padded.
+    for (int i = 0; i < 8; ++i)
+        w[i] = s[i];
+    w[8] = Const(0x80000000ul);
+    for (int i = 9; i < 15; ++i)
+        w[i] = Const(0);
+    w[15] = Const(0x100);
+    Initialize(s);
+    Transform(s, w);
+
+    for (int i = 0; i < 8; ++i)
+        Write4(out, i, s[i]);
+}
+} // namespace sha256d64_sse41
+
+#endif // USE_X86_SHA256
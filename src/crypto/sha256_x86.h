@@ -0,0 +1,52 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_SHA256_X86_H
+#define BITCOIN_CRYPTO_SHA256_X86_H
+
+// Internal to the crypto library: the x86 SHA-256 transforms that
+// SHA256AutoDetect() switches to when the CPU supports them. Each is built
+// with a per-function target attribute, so no special compiler flags are
+// needed and the binary still runs on CPUs without the extensions.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define USE_X86_SHA256
+#endif
+
+namespace sha256_tables
+{
+/** Round constants. */
+extern const uint32_t K[64];
+/** Round constants plus the message schedule of the block that pads a
+ *  64-byte message. That block is the same for every input, so the
+ *  double-SHA256 transforms skip its message expansion. */
+extern const uint32_t KPadding64[64];
+} // namespace sha256_tables
+
+#ifdef USE_X86_SHA256
+namespace sha256_shani
+{
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
+} // namespace sha256_shani
+
+namespace sha256d64_shani
+{
+void Transform_2way(unsigned char* out, const unsigned char* in);
+} // namespace sha256d64_shani
+
+namespace sha256d64_sse41
+{
+void Transform_4way(unsigned char* out, const unsigned char* in);
+} // namespace sha256d64_sse41
+
+namespace sha256d64_avx2
+{
+void Transform_8way(unsigned char* out, const unsigned char* in);
+} // namespace sha256d64_avx2
+#endif
+
+#endif // BITCOIN_CRYPTO_SHA256_X86_H
@@ -34,6 +34,7 @@ CGovernanceObject::CGovernanceObject()
   fExpired(false),
   fUnparsable(false),
   mapCurrentMNVotes(),
+  vecVoteTally((MAX_SUPPORTED_VOTE_SIGNAL + 1) * (VOTE_OUTCOME_ABSTAIN + 1), 0),
   mapOrphanVotes(),
   fileVotes()
 {
@@ -62,6 +63,7 @@ CGovernanceObject::CGovernanceObject(uint256 nHashParentIn, int nRevisionIn, int
   fExpired(false),
   fUnparsable(false),
   mapCurrentMNVotes(),
+  vecVoteTally((MAX_SUPPORTED_VOTE_SIGNAL + 1) * (VOTE_OUTCOME_ABSTAIN + 1), 0),
   mapOrphanVotes(),
   fileVotes()
 {
@@ -90,6 +92,7 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other)
   fExpired(other.fExpired),
   fUnparsable(other.fUnparsable),
   mapCurrentMNVotes(other.mapCurrentMNVotes),
+  vecVoteTally(other.vecVoteTally),
   mapOrphanVotes(other.mapOrphanVotes),
   fileVotes(other.fileVotes)
 {}
@@ -138,6 +141,7 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
     vote_instance_m_it it2 = recVote.mapInstances.find(int(eSignal));
     if(it2 == recVote.mapInstances.end()) {
         it2 = recVote.mapInstances.insert(vote_instance_m_t::value_type(int(eSignal), vote_instance_t())).first;
+        UpdateVoteTally(eSignal, it2->second.eOutcome, 1);
     }
     vote_instance_t& voteInstance = it2->second;
     int64_t nNow = GetTime();
@@ -168,7 +172,9 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         governance.AddInvalidVote(vote);
         return false;
     }
+    UpdateVoteTally(eSignal, voteInstance.eOutcome, -1);
     voteInstance = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate);
+    UpdateVoteTally(eSignal, voteInstance.eOutcome, 1);
     fileVotes.AddVote(vote);
     mnodeman.AddGovernanceVote(vote.GetVinMasternode(), vote.GetParentHash());
     fDirtyCache = true;
@@ -188,6 +194,7 @@ void CGovernanceObject::RebuildVoteMap()
         }
     }
     mapCurrentMNVotes = mapMNVotesNew;
+    RebuildVoteTally();
 }
 
 void CGovernanceObject::ClearMasternodeVotes()
@@ -207,6 +214,7 @@ void CGovernanceObject::ClearMasternodeVotes()
         }
 
         if(fRemove) {
+            UpdateVoteTally(it->second, -1);
             mapCurrentMNVotes.erase(it++);
         }
         else {
@@ -582,7 +590,49 @@ bool CGovernanceObject::IsCollateralValid(std::string& strError)
     return true;
 }
 
+int CGovernanceObject::GetVoteTallyIndex(int nSignal, int nOutcome)
+{
+    if(nSignal < 0 || nSignal > MAX_SUPPORTED_VOTE_SIGNAL) return -1;
+    if(nOutcome < 0 || nOutcome > VOTE_OUTCOME_ABSTAIN) return -1;
+    return nSignal * (VOTE_OUTCOME_ABSTAIN + 1) + nOutcome;
+}
+
+void CGovernanceObject::UpdateVoteTally(int nSignal, int nOutcome, int nDelta)
+{
+    int nIndex = GetVoteTallyIndex(nSignal, nOutcome);
+    if(nIndex >= 0) {
+        vecVoteTally[nIndex] += nDelta;
+    }
+}
+
+void CGovernanceObject::UpdateVoteTally(const vote_rec_t& recVote, int nDelta)
+{
+    for(vote_instance_m_cit it = recVote.mapInstances.begin(); it != recVote.mapInstances.end(); ++it) {
+        UpdateVoteTally(it->first, it->second.eOutcome, nDelta);
+    }
+}
+
+void CGovernanceObject::RebuildVoteTally()
+{
+    vecVoteTally.assign(vecVoteTally.size(), 0);
+    for(vote_m_cit it = mapCurrentMNVotes.begin(); it != mapCurrentMNVotes.end(); ++it) {
+        UpdateVoteTally(it->second, 1);
+    }
+}
+
 int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
+{
+    int nIndex = GetVoteTallyIndex(eVoteSignalIn, eVoteOutcomeIn);
+    if(nIndex < 0) {
+        return CountMatchingVotesFull(eVoteSignalIn, eVoteOutcomeIn);
+    }
+#ifdef DEBUG
+    assert(vecVoteTally[nIndex] == CountMatchingVotesFull(eVoteSignalIn, eVoteOutcomeIn));
+#endif
+    return vecVoteTally[nIndex];
+}
+
+int CGovernanceObject::CountMatchingVotesFull(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
 {
     int nCount = 0;
     for(vote_m_cit it = mapCurrentMNVotes.begin(); it != mapCurrentMNVotes.end(); ++it) {
@@ -599,6 +649,19 @@ int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote
     return nCount;
 }
 
+bool CGovernanceObject::IsVoteTallyConsistent() const
+{
+    for(int nSignal = 0; nSignal <= MAX_SUPPORTED_VOTE_SIGNAL; ++nSignal) {
+        for(int nOutcome = 0; nOutcome <= VOTE_OUTCOME_ABSTAIN; ++nOutcome) {
+            if(vecVoteTally[GetVoteTallyIndex(nSignal, nOutcome)] !=
+               CountMatchingVotesFull(vote_signal_enum_t(nSignal), vote_outcome_enum_t(nOutcome))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 /**
 *   Get specific vote counts for each outcome (funding, validity, etc)
 */
@@ -180,6 +180,9 @@ private:
 
     vote_m_t mapCurrentMNVotes;
 
+    /// Number of vote instances in mapCurrentMNVotes for each signal and outcome, see GetVoteTallyIndex()
+    std::vector<int> vecVoteTally;
+
     /// Limited map of votes orphaned by MN
     vote_mcache_t mapOrphanVotes;
 
@@ -291,6 +294,12 @@ public:
 
     bool GetCurrentMNVotes(const CTxIn& mnCollateralOutpoint, vote_rec_t& voteRecord);
 
+    ///for test
+    bool ProcessVoteForTest(const CGovernanceVote& vote, CGovernanceException& exception) { return ProcessVote(NULL, vote, exception); }
+    void ClearMasternodeVotesForTest() { ClearMasternodeVotes(); }
+    /// True if every tallied count matches a walk of mapCurrentMNVotes
+    bool IsVoteTallyConsistent() const;
+
     // FUNCTIONS FOR DEALING WITH DATA STRING
 
     std::string GetDataAsHex();
@@ -317,6 +326,9 @@ public:
             // Only include these for the disk file format
             LogPrint("gobject", "CGovernanceObject::SerializationOp Reading/writing votes from/to disk\n");
             READWRITE(mapCurrentMNVotes);
+            if(ser_action.ForRead()) {
+                RebuildVoteTally();
+            }
             READWRITE(fileVotes);
             LogPrint("gobject", "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", GetHash().ToString(), fileVotes.GetVoteCount());
         }
@@ -344,6 +356,20 @@ private:
     /// Called when MN's which have voted on this object have been removed
     void ClearMasternodeVotes();
 
+    /// Position of (signal, outcome) in vecVoteTally, -1 if that pair isn't tallied
+    static int GetVoteTallyIndex(int nSignal, int nOutcome);
+
+    void UpdateVoteTally(int nSignal, int nOutcome, int nDelta);
+
+    /// Add nDelta to the tally of every vote instance in recVote
+    void UpdateVoteTally(const vote_rec_t& recVote, int nDelta);
+
+    /// Recount vecVoteTally from mapCurrentMNVotes
+    void RebuildVoteTally();
+
+    /// Count matching votes by walking mapCurrentMNVotes
+    int CountMatchingVotesFull(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const;
+
     void CheckOrphanVotes();
 
 };
@@ -78,8 +78,8 @@ public:
 	{
 		CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
 		ss << *pblock;
-		assert(ss.size() == 140);
-		write((uchar *)&ss[0], 140).finalize(hash);
+		assert(ss.size() == INPUT_LEN);
+		helloHash((const uint8_t *)&ss[0], INPUT_LEN, hash);
 		
 		//view_data_u8("PoW 2", hash, OUTPUT_LEN);
 	}
@@ -96,7 +96,6 @@ LogPrintf("serialized:\t%s\n", HexStr(in).c_str());
 	void finalize(uchar hash[OUTPUT_SIZE])
 	{
 		//in = "hashcat";
-	    initOneWayFunction();	
       	uint32_t tmpLen = (uint32_t)in.size();
        	helloHash((const uint8_t * )in.data(), tmpLen,hash);
 	}
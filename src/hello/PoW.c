@@ -7,80 +7,60 @@
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <pthread.h>
 #ifndef MAC_OSX
 #include <omp.h>
 #endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 
 #include "my_time.h"
 #include "common.h"
 #include "my_rand48_r.h"
 #include "oneWayFunction.h"
-
-// #define SSE_VERSION
+#include "kernels.h"
 
 /* 
  * Step 1: Initialize working memory.
 */
 void initWorkMemory(uint8_t *input, uint32_t inputLen, uint8_t *Maddr, const uint32_t K) {
-	uint32_t i, j;
-	uint8_t a[OUTPUT_LEN], b[OUTPUT_LEN];
+	uint32_t i;
+	uint8_t a[OUTPUT_LEN];
 
 	funcInfor[0].func(input, inputLen, a);
 
 	uint64_t randSeed[4] = {0, 0, 0, 0};
-#ifndef SSE_VERSION
 	struct my_rand48_data randBuffer[4];
-#else
-	struct vrand48_data randBuffer[2];
-#endif
 
+	const helloKernels *kernels = helloActiveKernels;
 	const uint32_t iterNum = WORK_MEMORY_SIZE >> 5;
-	for (i = 0; i < iterNum; ++i) {
-		if (i % K) {
-#ifndef SSE_VERSION
-			uint64_t num = 0;
-			for (j = 0; j < 4; ++j) {
-				my_rand64_r(&randBuffer[j], &num);
-				memcpy(b + (j << 3), (uint8_t *)&num, 8*sizeof(uint8_t));
-			}
-#else
-			vrand64(b, randBuffer);
-#endif
-			
-			uint8_t shift_num;
-			uint8_t result[OUTPUT_LEN];
-			reduce_bit((uint8_t *)&i, 4, (uint8_t *)&shift_num, 8);
-			rrs(b, OUTPUT_LEN, result, shift_num);
-
-			memcpy(Maddr + (i << 5), result, OUTPUT_LEN*sizeof(uint8_t));
-			for (j = 0; j < 32; ++j) {
-				a[j] ^= result[j];
-			}
-		} else {
-			uint8_t t = 0, shift_num = 0;
-			reduce_bit(a, 32, (uint8_t *)&t, 8);
-			t = (t & 0x0f) ^ (t >> 4);
-			reduce_bit((uint8_t *)&i, 4, (uint8_t *)&shift_num, 8);
-			
-			uint8_t a_rrs[INPUT_LEN];
-			rrs(a, OUTPUT_LEN, a_rrs, shift_num);
-			funcInfor[t].func(a_rrs, 32, a);
-			
-			reduce_bit(a,      8, (uint8_t *)&randSeed[0], 48);
-			reduce_bit(a +  8, 8, (uint8_t *)&randSeed[1], 48);
-			reduce_bit(a + 16, 8, (uint8_t *)&randSeed[2], 48);
-			reduce_bit(a + 24, 8, (uint8_t *)&randSeed[3], 48);
-#ifndef SSE_VERSION
-			my_seed48_r(randSeed[0], &randBuffer[0]);
-			my_seed48_r(randSeed[1], &randBuffer[1]);
-			my_seed48_r(randSeed[2], &randBuffer[2]);
-			my_seed48_r(randSeed[3], &randBuffer[3]);
-#else
-			vseed48(randSeed    , &randBuffer[0]);
-			vseed48(randSeed + 2, &randBuffer[1]);
-#endif
-			memcpy(Maddr + (i << 5), a, 32*sizeof(uint8_t));
-		}
+	for (i = 0; i < iterNum; i += K) {
+		// Every K-th row reseeds the four LCG streams from a one-way function.
+		uint8_t t = 0, shift_num = 0;
+		reduce_bit(a, 32, (uint8_t *)&t, 8);
+		t = (t & 0x0f) ^ (t >> 4);
+		shift_num = reduce_u32_8(i);
+		
+		uint8_t a_rrs[INPUT_LEN];
+		kernels->rrs32(a, a_rrs, shift_num);
+		funcInfor[t].func32(a_rrs, a);
+		
+		reduce_bit(a,      8, (uint8_t *)&randSeed[0], 48);
+		reduce_bit(a +  8, 8, (uint8_t *)&randSeed[1], 48);
+		reduce_bit(a + 16, 8, (uint8_t *)&randSeed[2], 48);
+		reduce_bit(a + 24, 8, (uint8_t *)&randSeed[3], 48);
+		my_seed48_r(randSeed[0], &randBuffer[0]);
+		my_seed48_r(randSeed[1], &randBuffer[1]);
+		my_seed48_r(randSeed[2], &randBuffer[2]);
+		my_seed48_r(randSeed[3], &randBuffer[3]);
+		memcpy(Maddr + (i << 5), a, 32*sizeof(uint8_t));
+
+		// The rows up to the next reseed come straight from the streams.
+		uint32_t count = iterNum - i - 1;
+		if (count > K - 1)
+			count = K - 1;
+		kernels->fillRows(randBuffer, Maddr, i + 1, count, a);
 	}
 }
 
@@ -91,8 +71,9 @@ void modifyWorkMemory(uint8_t *Maddr, const uint32_t L, const uint32_t C,
 		uint8_t *result) {
 	uint32_t i, j;
 	uint8_t a[OUTPUT_LEN], b[64];
+	const helloKernels *kernels = helloActiveKernels;
 	
-	funcInfor[0].func(Maddr + WORK_MEMORY_SIZE - 32, 32, a);
+	funcInfor[0].func32(Maddr + WORK_MEMORY_SIZE - 32, a);
 	memcpy(result, a, OUTPUT_LEN*sizeof(uint8_t));
 	
 	uint64_t r = 0;
@@ -112,9 +93,7 @@ void modifyWorkMemory(uint8_t *Maddr, const uint32_t L, const uint32_t C,
 			my_rand48_r(&randBuffer, &randNum);
 			base = randNum + r;
 			
-			uint64_t offset = 0;
-			reduce_bit((uint8_t *)&r, 8, (uint8_t *)&offset, 8);
-			offset = (offset << 8) + 1;
+			uint64_t offset = ((uint64_t)reduce_u64_8(r) << 8) + 1;
 			
 			uint64_t addr1 = (base + WORK_MEMORY_SIZE - offset) % WORK_MEMORY_SIZE;
 			uint64_t addr2 = (base + offset) % WORK_MEMORY_SIZE;
@@ -130,19 +109,16 @@ void modifyWorkMemory(uint8_t *Maddr, const uint32_t L, const uint32_t C,
 			r = r + s + t1 + t2;
 		}
 		
-		uint8_t t = 0;
-		reduce_bit((uint8_t *)&r, 8, (uint8_t *)&t, 8);
+		uint8_t t = reduce_u64_8(r);
 		t = (t & 0x0f) ^ (t >> 4);
 		
 		reduce_bit(b, 64, a, 256);
 		
-		uint8_t shift_num = 0;
-		uint64_t ir = r + i;
-		reduce_bit((uint8_t *)&ir, 8, (uint8_t *)&shift_num, 8);
+		uint8_t shift_num = reduce_u64_8(r + i);
 
 		uint8_t a_rrs[INPUT_LEN];
-		rrs(a, OUTPUT_LEN, a_rrs, shift_num);
-		funcInfor[t].func(a_rrs, 32, a);
+		kernels->rrs32(a, a_rrs, shift_num);
+		funcInfor[t].func32(a_rrs, a);
 		
 		for (j = 0; j < OUTPUT_LEN; ++j) {
 			result[j] ^= a[j];
@@ -154,12 +130,12 @@ void modifyWorkMemory(uint8_t *Maddr, const uint32_t L, const uint32_t C,
  * Step 3: Calculate the final result.
 */
 void calculateFinalResult(uint8_t *Maddr, uint8_t *c, const uint32_t D, uint8_t *result) {
-	uint32_t i = 0, j = 0, k = 0;
+	uint32_t i = 0;
+	const helloKernels *kernels = helloActiveKernels;
 	memcpy(result, c, OUTPUT_LEN*sizeof(uint8_t));
 	
 	const uint32_t num = (WORK_MEMORY_SIZE >> 5) - 1;
 	
-	uint32_t it = 0;
 	uint8_t result_rrs[OUTPUT_LEN];
 	while(1) {
 		uint8_t t = 0, shift_num = 0;
@@ -170,28 +146,24 @@ void calculateFinalResult(uint8_t *Maddr, uint8_t *c, const uint32_t D, uint8_t
 		reduce_bit(result, 32, (uint8_t *)&d, D);
 		++d;
 		
-		for (j = 0; j < d; ++j) {
-			uint32_t index = i << 5;
-			for (k = 0; k < 32; ++k) {
-				result[k] ^= Maddr[index + k];
-			}
-			++i;
-
-			if (i == num) {
-				it = i + t;
-				reduce_bit((uint8_t *)&it, 4, (uint8_t *)&shift_num, 8);
-
-				rrs(result, OUTPUT_LEN, result_rrs, shift_num);
-				funcInfor[0].func(result_rrs, 32, result);
-				
-				return;
-			}
+		if (num - i <= d) {
+			// The last rows: fold them in and finish with function 0.
+			kernels->xorRows(result, Maddr + (i << 5), num - i);
+			i = num;
+			shift_num = reduce_u32_8(i + t);
+
+			kernels->rrs32(result, result_rrs, shift_num);
+			funcInfor[0].func32(result_rrs, result);
+			
+			return;
 		}
-		it = t + i;
-		reduce_bit((uint8_t *)&it, 4, (uint8_t *)&shift_num, 8);
+		kernels->xorRows(result, Maddr + (i << 5), d);
+		i += d;
 
-		rrs(result, OUTPUT_LEN, result_rrs, shift_num);
-		funcInfor[t].func(result_rrs, 32, result);
+		shift_num = reduce_u32_8(t + i);
+
+		kernels->rrs32(result, result_rrs, shift_num);
+		funcInfor[t].func32(result_rrs, result);
 	}
 }
                                                                                                                                                                                                                                                                                                        
@@ -353,31 +325,246 @@ void powNistTest(const char *outFileName) {
 }
 
 
-void helloHash(const uint8_t *mess, uint32_t messLen, uint8_t output[OUTPUT_LEN]) {
+/*
+ * The work memory is placed in its own 2 MiB aligned region so that the
+ * kernel can back it with a single transparent huge page.
+*/
+#define HELLO_ARENA_ALIGN	(2 * 1024 * 1024)
+
+static pthread_once_t helloInitOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t helloThreadKey;
+
+static void helloThreadContextFree(void *ctx) {
+	helloFreeContext((helloContext *)ctx);
+}
+
+static void helloInitTables(void) {
+	initOneWayFunction();
+	helloSelectImpl(helloBestImpl());
+	pthread_key_create(&helloThreadKey, helloThreadContextFree);
+}
+
+void helloInit(void) {
+	pthread_once(&helloInitOnce, helloInitTables);
+}
+
+static uint8_t *helloAllocArena(size_t size) {
+	void *mem = NULL;
+	size = (size + HELLO_ARENA_ALIGN - 1) & ~((size_t)HELLO_ARENA_ALIGN - 1);
+#ifdef _WIN32
+	mem = _aligned_malloc(size, HELLO_ARENA_ALIGN);
+#else
+	if (0 != posix_memalign(&mem, HELLO_ARENA_ALIGN, size))
+		mem = NULL;
+#endif
+	assert(NULL != mem);
+#ifdef MADV_HUGEPAGE
+	madvise(mem, size, MADV_HUGEPAGE);
+#endif
+	// Every row is written by initWorkMemory before it is read, so the
+	// arena needs no clearing between hashes. Touch it once here so the
+	// page faults are paid at creation instead of inside the first hash.
+	memset(mem, 0, size);
+	return (uint8_t *)mem;
+}
+
+static void helloFreeArena(uint8_t *mem) {
+#ifdef _WIN32
+	_aligned_free(mem);
+#else
+	free(mem);
+#endif
+}
+
+helloContext *helloCreateContext(void) {
+	helloContext *ctx = (helloContext *)malloc(sizeof(helloContext));
+	assert(NULL != ctx);
+
+	ctx->Maddr = helloAllocArena(WORK_MEMORY_SIZE);
+	ctx->batchMaddr = NULL;
+	return ctx;
+}
+
+void helloFreeContext(helloContext *ctx) {
+	if (NULL == ctx)
+		return;
+	helloFreeArena(ctx->Maddr);
+	if (NULL != ctx->batchMaddr)
+		helloFreeArena(ctx->batchMaddr);
+	free(ctx);
+}
+
+helloContext *helloGetThreadContext(void) {
+	helloInit();
+	helloContext *ctx = (helloContext *)pthread_getspecific(helloThreadKey);
+	if (NULL == ctx) {
+		ctx = helloCreateContext();
+		pthread_setspecific(helloThreadKey, ctx);
+	}
+	return ctx;
+}
+
+void helloHashWithContext(helloContext *ctx, const uint8_t *mess, uint32_t messLen, uint8_t output[OUTPUT_LEN]) {
     if(messLen != INPUT_LEN)
     {
 	//won't get in
 	printf("helloHash:Invalid message length %d\n", messLen);
 	return;
     }
-    int64_t j;
-    uint32_t inputLen =messLen; 
+    helloInit();
+
     uint8_t input[INPUT_LEN];
-    memset(input, 0, INPUT_LEN*sizeof(uint8_t));
-    memcpy(input, mess, inputLen*sizeof(char));      //operation: input
+    memcpy(input, mess, messLen*sizeof(char));      //operation: input
 
-    uint8_t *Maddr = (uint8_t *)malloc(WORK_MEMORY_SIZE*sizeof(uint8_t));  //1024*1024*1
-    assert(NULL != Maddr);
-    memset(Maddr, 0, WORK_MEMORY_SIZE*sizeof(uint8_t));
+    powFunction(input, messLen, ctx->Maddr, output);
+}
 
-    //printf("Test message: %s\n", mess);
-    powFunction(input, inputLen,Maddr, output);
-    //view_data_u8("PoW", output, OUTPUT_LEN);        //output
-    
-    if (NULL != Maddr) {
-        free(Maddr);
-        Maddr = NULL;
-    }
+void helloHash(const uint8_t *mess, uint32_t messLen, uint8_t output[OUTPUT_LEN]) {
+    helloHashWithContext(helloGetThreadContext(), mess, messLen, output);
+}
+
+/*
+ * Step 2 for HELLO_BATCH_LANES independent work memories. The lanes advance
+ * in lockstep so that the random accesses of one lane overlap with the
+ * others instead of stalling the whole hash.
+*/
+static void modifyWorkMemoryBatch(uint8_t *Maddr[HELLO_BATCH_LANES], const uint32_t L, const uint32_t C,
+		uint8_t result[HELLO_BATCH_LANES][OUTPUT_LEN]) {
+	uint32_t i, j, n;
+	uint8_t a[HELLO_BATCH_LANES][OUTPUT_LEN], b[HELLO_BATCH_LANES][64];
+	uint64_t r[HELLO_BATCH_LANES];
+	struct my_rand48_data randBuffer[HELLO_BATCH_LANES];
+	const helloKernels *kernels = helloActiveKernels;
+
+	for (n = 0; n < HELLO_BATCH_LANES; ++n) {
+		funcInfor[0].func32(Maddr[n] + WORK_MEMORY_SIZE - 32, a[n]);
+		memcpy(result[n], a[n], OUTPUT_LEN*sizeof(uint8_t));
+
+		r[n] = 0;
+		reduce_bit(a[n], 32, (uint8_t *)&r[n], 64);
+	}
+
+	const uint32_t iterNum = L << 6;
+	for (i = 0; i < C; ++i) {
+		for (n = 0; n < HELLO_BATCH_LANES; ++n) {
+			uint64_t randSeed = 0;
+			reduce_bit(a[n], 32, (uint8_t *)&randSeed, 48);
+			my_seed48_r(randSeed, &randBuffer[n]);
+		}
+
+		for (j = 0; j < iterNum; ++j) {
+			for (n = 0; n < HELLO_BATCH_LANES; ++n) {
+				uint64_t randNum = 0;
+				my_rand48_r(&randBuffer[n], &randNum);
+				uint64_t base = randNum + r[n];
+				uint64_t offset = ((uint64_t)reduce_u64_8(r[n]) << 8) + 1;
+
+				uint64_t addr1 = (base + WORK_MEMORY_SIZE - offset) % WORK_MEMORY_SIZE;
+				uint64_t addr2 = (base + offset) % WORK_MEMORY_SIZE;
+
+				uint8_t *M = Maddr[n];
+				uint8_t t1 = M[addr1], t2 = M[addr2], s = a[n][j & 0x1f];
+
+				M[addr1] = t2 ^ s;
+				M[addr2] = t1 ^ s;
+				b[n][j & 0x3f] = t1 ^ t2;
+
+				r[n] = r[n] + s + t1 + t2;
+			}
+		}
+
+		for (n = 0; n < HELLO_BATCH_LANES; ++n) {
+			uint8_t t = reduce_u64_8(r[n]);
+			t = (t & 0x0f) ^ (t >> 4);
+
+			reduce_bit(b[n], 64, a[n], 256);
+
+			uint8_t a_rrs[OUTPUT_LEN];
+			kernels->rrs32(a[n], a_rrs, reduce_u64_8(r[n] + i));
+			funcInfor[t].func32(a_rrs, a[n]);
+
+			for (j = 0; j < OUTPUT_LEN; ++j) {
+				result[n][j] ^= a[n][j];
+			}
+		}
+	}
+}
+
+/* Add k to the 256-bit little-endian nonce at the end of a header. */
+static void helloAddNonce(uint8_t header[INPUT_LEN], uint32_t k) {
+	uint8_t *nonce = header + INPUT_LEN - 32;
+	uint64_t carry = k;
+	for (uint32_t i = 0; i < 32 && carry; ++i) {
+		carry += nonce[i];
+		nonce[i] = (uint8_t)carry;
+		carry >>= 8;
+	}
+}
+
+/* Hash the nonces [first, first + count) of `header`, at most HELLO_BATCH_LANES. */
+static void helloHashLanes(helloContext *ctx, const uint8_t header[INPUT_LEN], uint32_t first, uint32_t count,
+		uint8_t *output) {
+	uint32_t n;
+	uint8_t input[HELLO_BATCH_LANES][INPUT_LEN];
+
+	for (n = 0; n < count; ++n) {
+		memcpy(input[n], header, INPUT_LEN*sizeof(uint8_t));
+		helloAddNonce(input[n], first + n);
+	}
+
+	if (count < HELLO_BATCH_LANES) {
+		for (n = 0; n < count; ++n)
+			powFunction(input[n], INPUT_LEN, ctx->Maddr, output + n * OUTPUT_LEN);
+		return;
+	}
+
+	if (NULL == ctx->batchMaddr)
+		ctx->batchMaddr = helloAllocArena(HELLO_BATCH_LANES * WORK_MEMORY_SIZE);
+
+	uint8_t *Maddr[HELLO_BATCH_LANES];
+	uint8_t c[HELLO_BATCH_LANES][OUTPUT_LEN];
+	for (n = 0; n < HELLO_BATCH_LANES; ++n) {
+		Maddr[n] = ctx->batchMaddr + n * WORK_MEMORY_SIZE;
+		initWorkMemory(input[n], INPUT_LEN, Maddr[n], 128);
+	}
+	modifyWorkMemoryBatch(Maddr, 4, WORK_MEMORY_SIZE >> 11, c);
+	for (n = 0; n < HELLO_BATCH_LANES; ++n)
+		calculateFinalResult(Maddr[n], c[n], 8, output + n * OUTPUT_LEN);
+}
+
+void helloHashBatch(helloContext *ctx, const uint8_t header[INPUT_LEN], uint32_t count, uint8_t *output) {
+	helloInit();
+	for (uint32_t done = 0; done < count; done += HELLO_BATCH_LANES) {
+		uint32_t lanes = count - done < HELLO_BATCH_LANES ? count - done : HELLO_BATCH_LANES;
+		helloHashLanes(ctx, header, done, lanes, output + done * OUTPUT_LEN);
+	}
+}
+
+static int helloHashMeetsTarget(const uint8_t hash[OUTPUT_LEN], const uint8_t target[OUTPUT_LEN]) {
+	for (int i = OUTPUT_LEN - 1; i >= 0; --i) {
+		if (hash[i] != target[i])
+			return hash[i] < target[i];
+	}
+	return 1;
+}
+
+int helloScanNonces(helloContext *ctx, const uint8_t header[INPUT_LEN], uint32_t count,
+		const uint8_t target[OUTPUT_LEN], uint32_t *nonceOffset, uint8_t hash[OUTPUT_LEN]) {
+	uint8_t output[HELLO_BATCH_LANES * OUTPUT_LEN];
+
+	helloInit();
+	for (uint32_t done = 0; done < count; done += HELLO_BATCH_LANES) {
+		uint32_t lanes = count - done < HELLO_BATCH_LANES ? count - done : HELLO_BATCH_LANES;
+		helloHashLanes(ctx, header, done, lanes, output);
+		for (uint32_t n = 0; n < lanes; ++n) {
+			if (helloHashMeetsTarget(output + n * OUTPUT_LEN, target)) {
+				*nonceOffset = done + n;
+				memcpy(hash, output + n * OUTPUT_LEN, OUTPUT_LEN*sizeof(uint8_t));
+				return 1;
+			}
+		}
+	}
+	return 0;
 }
 
 int my_rand64_r (struct my_rand48_data *buffer, uint64_t *result)
@@ -9,6 +9,9 @@
 
 #define WORK_MEMORY_SIZE (1024*1024)
 
+/* Number of independent work memories hashed in lockstep by helloHashBatch. */
+#define HELLO_BATCH_LANES 4
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -34,18 +37,59 @@ extern "C" {
 	void testPowFunction(uint8_t *mess, uint32_t messLen, const int64_t iterNum);
 	void powNistTest(const char *outFileName);
 
+	/*
+	 * Proof of work.
+	*/
+	void powFunction(uint8_t *input, uint32_t inputLen, uint8_t *Maddr, uint8_t *output);
+
+	/*
+	 * One-time initialization of the tables used by the one-way functions.
+	 * Safe to call from any thread, any number of times.
+	*/
+	void helloInit(void);
+
+	/*
+	 * Scratch context owning the work memory of the PoW, so that repeated
+	 * hashes do not allocate and page-fault a fresh buffer every time.
+	 * A context must only be used by one thread at a time.
+	*/
+	typedef struct {
+		uint8_t *Maddr;
+		uint8_t *batchMaddr;	/* HELLO_BATCH_LANES work memories, allocated on first batch */
+	} helloContext;
+
+	helloContext *helloCreateContext(void);
+	void helloFreeContext(helloContext *ctx);
+
+	/*
+	 * Context owned by the calling thread, created on first use and
+	 * released when the thread exits.
+	*/
+	helloContext *helloGetThreadContext(void);
+
 	/*
      * hash function
     */
+	void helloHashWithContext(helloContext *ctx, const uint8_t *mess, uint32_t messLen, uint8_t output[OUTPUT_LEN]);
     void helloHash(const uint8_t *mess, uint32_t messLen, uint8_t output[OUTPUT_LEN]);
+
+	/*
+	 * Hash `count` headers that only differ in their nonce: the first one is
+	 * `header` itself, the k-th has k added to its 256-bit little-endian
+	 * nonce (the last 32 bytes). Writes count * OUTPUT_LEN bytes to `output`.
+	*/
+	void helloHashBatch(helloContext *ctx, const uint8_t header[INPUT_LEN], uint32_t count, uint8_t *output);
+
+	/*
+	 * Search the same nonces as helloHashBatch for a hash that is not above
+	 * `target`, both read as 256-bit little-endian numbers. On success
+	 * returns 1 and stores the nonce offset and the hash.
+	*/
+	int helloScanNonces(helloContext *ctx, const uint8_t header[INPUT_LEN], uint32_t count,
+			const uint8_t target[OUTPUT_LEN], uint32_t *nonceOffset, uint8_t hash[OUTPUT_LEN]);
 	
 #ifdef __cplusplus
 }
 #endif	
 
-/* 
- * Proof of work.
-*/
-void powFunction(uint8_t *input, uint32_t inputLen, uint8_t *Maddr, uint8_t *output);
-
 #endif // ULORD_HELLO_POW_H
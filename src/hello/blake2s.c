@@ -195,6 +195,32 @@ static void blake2s_compress(BLAKE2S_CTX *S,
     } while (len);
 }
 
+/*
+ * BLAKE2s-256 of exactly 32 bytes: a single final block, without the
+ * parameter block setup, the buffering and the cleanse of the generic path.
+ */
+void BLAKE2s_256_32(const unsigned char *in, unsigned char *md)
+{
+    BLAKE2S_CTX c;
+    int i;
+
+    for (i = 0; i < 8; ++i)
+        c.h[i] = blake2s_IV[i];
+    /* digest_length, key_length 0, fanout 1, depth 1 as BLAKE2s_Init sets */
+    c.h[0] ^= 0x01010000U | BLAKE2S_DIGEST_LENGTH;
+    c.t[0] = c.t[1] = 0;
+    c.f[0] = c.f[1] = 0;
+    blake2s_set_lastblock(&c);
+    memcpy(c.buf, in, 32);
+    memset(c.buf + 32, 0, sizeof(c.buf) - 32);
+    c.buflen = 32;
+    blake2s_compress(&c, c.buf, 32);
+
+    for (i = 0; i < 8; ++i) {
+        store32(md + sizeof(c.h[i]) * i, c.h[i]);
+    }
+}
+
 /* Absorb the input data into the hash state.  Always returns 1. */
 int BLAKE2s_Update(BLAKE2S_CTX *c, const void *data, size_t datalen)
 {
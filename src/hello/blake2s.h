@@ -56,5 +56,6 @@ typedef struct blake2s_ctx_st BLAKE2S_CTX;
 int BLAKE2s_Init(BLAKE2S_CTX *c);
 int BLAKE2s_Update(BLAKE2S_CTX *c, const void *data, size_t datalen);
 int BLAKE2s_Final(unsigned char *md, BLAKE2S_CTX *c);
+void BLAKE2s_256_32(const unsigned char *in, unsigned char *md);
 
 #endif
@@ -9,6 +9,24 @@
 #include <openssl/aes.h>
 
 #include "common.h"
+#include "single_block.h"
+
+// $output = AES($key = md5($hash), $hash), where $hash = sha256($input)
+static void aes128_encrypt_digest(const uint8_t *sha256Digest, uint8_t *output) {
+	uint8_t md5Digest[MD5_DIGEST_LENGTH];
+	md5_single_block(sha256Digest, SHA256_DIGEST_LENGTH, md5Digest);
+	
+	AES_KEY akey;
+	if(AES_set_encrypt_key(md5Digest, 128, &akey) < 0) {
+		fprintf(stderr, "AES_set_encrypt_key failed in crypt!\n");
+		abort();
+	}
+	uint8_t result[SHA256_DIGEST_LENGTH];
+	AES_encrypt(sha256Digest, result, &akey);
+	AES_encrypt(sha256Digest + AES_BLOCK_SIZE, result + AES_BLOCK_SIZE, &akey);
+
+	memcpy(output, result, OUTPUT_LEN*sizeof(uint8_t));
+}
 
 /*
  * 功能：单向函数 AES128
@@ -29,22 +47,13 @@ void crypto_aes128(uint8_t *input, uint32_t inputLen, uint8_t *output) {
 	SHA256_Init(&sha256_ctx);
 	SHA256_Update(&sha256_ctx, input, inputLen);
 	SHA256_Final(sha256Digest, &sha256_ctx);
-	
-	uint8_t md5Digest[MD5_DIGEST_LENGTH];
-	
-	MD5_CTX md5_ctx;
-	MD5_Init(&md5_ctx);
-	MD5_Update(&md5_ctx, sha256Digest, SHA256_DIGEST_LENGTH);
-	MD5_Final(md5Digest, &md5_ctx);
-	
-	AES_KEY akey;
-	if(AES_set_encrypt_key(md5Digest, 128, &akey) < 0) {
-		fprintf(stderr, "AES_set_encrypt_key failed in crypt!\n");
-		abort();
-	}
-	uint8_t result[SHA256_DIGEST_LENGTH];
-	AES_encrypt(sha256Digest, result, &akey);
-	AES_encrypt(sha256Digest + AES_BLOCK_SIZE, result + AES_BLOCK_SIZE, &akey);
 
-	memcpy(output, result, OUTPUT_LEN*sizeof(uint8_t));
+	aes128_encrypt_digest(sha256Digest, output);
+}
+
+void crypto_aes128_32(uint8_t *input, uint8_t *output) {
+	uint8_t sha256Digest[SHA256_DIGEST_LENGTH];
+	sha256_single_block(input, 32, sha256Digest);
+
+	aes128_encrypt_digest(sha256Digest, output);
 }
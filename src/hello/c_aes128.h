@@ -14,6 +14,9 @@ extern "C" {
 	*/
 	void crypto_aes128(uint8_t *input, uint32_t inputLen, uint8_t *output);
 
+	/* Same result as crypto_aes128 for inputLen == 32 */
+	void crypto_aes128_32(uint8_t *input, uint8_t *output);
+
 #ifdef __cplusplus
 }
 #endif
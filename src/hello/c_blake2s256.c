@@ -16,3 +16,10 @@ void crypto_blake2s256(uint8_t *input, uint32_t inputLen, uint8_t *output) {
 
 	memcpy(output, result, OUTPUT_LEN*sizeof(uint8_t));
 }
+
+void crypto_blake2s256_32(uint8_t *input, uint8_t *output) {
+	uint8_t result[BLAKE2S_OUTBYTES];
+
+	BLAKE2s_256_32(input, result);
+	memcpy(output, result, OUTPUT_LEN*sizeof(uint8_t));
+}
@@ -9,6 +9,9 @@ extern "C" {
 
 	void crypto_camellia128(uint8_t *input, uint32_t inputLen, uint8_t *output);
 
+	/* Same result as crypto_camellia128 for inputLen == 32 */
+	void crypto_camellia128_32(uint8_t *input, uint8_t *output);
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,8 +7,19 @@
 #include <openssl/sha.h>
 
 #include "common.h"
+#include "single_block.h"
 #include "jtr_crc32.h"
 
+// $output = crc32 of each word of $hash, where $hash = sha256($input)
+static void crc32_digest(uint8_t *sha256Digest, uint8_t *output) {
+	CRC32_t crc;
+	for (uint32_t i = 0; i < SHA256_DIGEST_LENGTH; i += 4) {
+		CRC32_Init(&crc);
+		CRC32_Update(&crc, &sha256Digest[i], 4);
+		CRC32_Final(&output[i], crc);
+	}
+}
+
 /*
  * 功能：单向函数 crc32
  * 输入：1. input ：输入消息
@@ -26,10 +37,12 @@ void crypto_crc32(uint8_t *input, uint32_t inputLen, uint8_t *output) {
 	SHA256_Update(&ctx, input, inputLen);
 	SHA256_Final(sha256Digest, &ctx);
 
-	CRC32_t crc;
-	for (uint32_t i = 0; i < SHA256_DIGEST_LENGTH; i += 4) {
-		CRC32_Init(&crc);
-		CRC32_Update(&crc, &sha256Digest[i], 4);
-		CRC32_Final(&output[i], crc);
-	}
+	crc32_digest(sha256Digest, output);
+}
+
+void crypto_crc32_32(uint8_t *input, uint8_t *output) {
+	uint8_t sha256Digest[SHA256_DIGEST_LENGTH];
+	sha256_single_block(input, 32, sha256Digest);
+
+	crc32_digest(sha256Digest, output);
 }
\ No newline at end of file
@@ -15,6 +15,9 @@ extern "C" {
 	void CRC32_Table_Init();
 	void crypto_crc32(uint8_t *input, uint32_t inputLen, uint8_t *output);
 
+	/* Same result as crypto_crc32 for inputLen == 32 */
+	void crypto_crc32_32(uint8_t *input, uint8_t *output);
+
 #ifdef __cplusplus
 }
 #endif
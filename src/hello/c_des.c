@@ -9,9 +9,27 @@
 #include <openssl/des.h>
 
 #include "common.h"
+#include "single_block.h"
 
 #define DES_BLOCK_SIZE 8
 
+// $output = DES($key = md5($hash), $hash), where $hash = sha256($input)
+static void des_encrypt_digest(const uint8_t *sha256Digest, uint8_t *output) {
+	uint8_t md5Digest[MD5_DIGEST_LENGTH];
+	md5_single_block(sha256Digest, SHA256_DIGEST_LENGTH, md5Digest);
+	
+	uint8_t result[OUTPUT_LEN];
+	
+	DES_key_schedule akey;
+	DES_set_key_unchecked((const_DES_cblock *)md5Digest, &akey);
+	DES_ecb_encrypt((const_DES_cblock *)sha256Digest, (const_DES_cblock *)result, &akey, DES_ENCRYPT);
+	DES_ecb_encrypt((const_DES_cblock *)(sha256Digest+DES_BLOCK_SIZE), (const_DES_cblock *)(result+DES_BLOCK_SIZE), &akey, DES_ENCRYPT);
+	DES_ecb_encrypt((const_DES_cblock *)(sha256Digest+2*DES_BLOCK_SIZE), (const_DES_cblock *)(result+2*DES_BLOCK_SIZE), &akey, DES_ENCRYPT);
+	DES_ecb_encrypt((const_DES_cblock *)(sha256Digest+3*DES_BLOCK_SIZE), (const_DES_cblock *)(result+3*DES_BLOCK_SIZE), &akey, DES_ENCRYPT);
+
+	memcpy(output, result, OUTPUT_LEN*sizeof(uint8_t));
+}
+
 /*
  * 功能：单向函数 des
  * 输入：1. input ：输入消息
@@ -34,21 +52,12 @@ void crypto_des(uint8_t *input, uint32_t inputLen, uint8_t *output) {
 	SHA256_Update(&ctx, input, inputLen);
 	SHA256_Final(sha256Digest, &ctx);
 
-	uint8_t md5Digest[MD5_DIGEST_LENGTH];
-	
-	MD5_CTX md5_ctx;
-	MD5_Init(&md5_ctx);
-	MD5_Update(&md5_ctx, sha256Digest, SHA256_DIGEST_LENGTH);
-	MD5_Final(md5Digest, &md5_ctx);
-	
-	uint8_t result[OUTPUT_LEN];
-	
-	DES_key_schedule akey;
-	DES_set_key_unchecked((const_DES_cblock *)md5Digest, &akey);
-	DES_ecb_encrypt((const_DES_cblock *)sha256Digest, (const_DES_cblock *)result, &akey, DES_ENCRYPT);
-	DES_ecb_encrypt((const_DES_cblock *)(sha256Digest+DES_BLOCK_SIZE), (const_DES_cblock *)(result+DES_BLOCK_SIZE), &akey, DES_ENCRYPT);
-	DES_ecb_encrypt((const_DES_cblock *)(sha256Digest+2*DES_BLOCK_SIZE), (const_DES_cblock *)(result+2*DES_BLOCK_SIZE), &akey, DES_ENCRYPT);
-	DES_ecb_encrypt((const_DES_cblock *)(sha256Digest+3*DES_BLOCK_SIZE), (const_DES_cblock *)(result+3*DES_BLOCK_SIZE), &akey, DES_ENCRYPT);
+	des_encrypt_digest(sha256Digest, output);
+}
 
-	memcpy(output, result, OUTPUT_LEN*sizeof(uint8_t));
+void crypto_des_32(uint8_t *input, uint8_t *output) {
+	uint8_t sha256Digest[SHA256_DIGEST_LENGTH];
+	sha256_single_block(input, 32, sha256Digest);
+
+	des_encrypt_digest(sha256Digest, output);
 }
@@ -10,6 +10,15 @@
 #include <openssl/opensslv.h>
 
 #include "common.h"
+#include "single_block.h"
+
+// $output = sha256($hmac), where $hmac = HMAC_MD5($key = $input, $input)
+static void sha256_hmac_digest(const uint8_t *hmacMd5Digest, uint8_t *output) {
+	uint8_t sha256Digest[SHA256_DIGEST_LENGTH];
+	sha256_single_block(hmacMd5Digest, MD5_DIGEST_LENGTH, sha256Digest);
+
+	memcpy(output, sha256Digest, OUTPUT_LEN*sizeof(uint8_t));
+}
 
 /*
  * 功能：单向函数 HMAC MD5
@@ -39,12 +48,12 @@ void crypto_hmac_md5(uint8_t *input, uint32_t inputLen, uint8_t *output) {
     HMAC_CTX_cleanup(&ctx);
 #endif
 	
-	uint8_t sha256Digest[SHA256_DIGEST_LENGTH];
+	sha256_hmac_digest(hmacMd5Digest, output);
+}
 
-	SHA256_CTX sha256_ctx;
-	SHA256_Init(&sha256_ctx);
-	SHA256_Update(&sha256_ctx, hmacMd5Digest, MD5_DIGEST_LENGTH);
-	SHA256_Final(sha256Digest, &sha256_ctx);
-	
-	memcpy(output, sha256Digest, OUTPUT_LEN*sizeof(uint8_t));
+void crypto_hmac_md5_32(uint8_t *input, uint8_t *output) {
+	uint8_t hmacMd5Digest[MD5_DIGEST_LENGTH];
+	hmac_md5_short(input, 32, input, 32, hmacMd5Digest);
+
+	sha256_hmac_digest(hmacMd5Digest, output);
 }
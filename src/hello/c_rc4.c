@@ -10,6 +10,20 @@
 #include <openssl/rc4.h>
 
 #include "common.h"
+#include "single_block.h"
+
+// $output = RC4($key = md5($hash), $hash), where $hash = sha256($input)
+static void rc4_encrypt_digest(const uint8_t *sha256Digest, uint8_t *output) {
+	uint8_t md5Digest[MD5_DIGEST_LENGTH];
+	md5_single_block(sha256Digest, SHA256_DIGEST_LENGTH, md5Digest);
+	
+	RC4_KEY akey;
+	RC4_set_key(&akey, MD5_DIGEST_LENGTH, md5Digest);
+	uint8_t result[SHA256_DIGEST_LENGTH];
+	RC4(&akey, SHA256_DIGEST_LENGTH, sha256Digest, result);
+
+	memcpy(output, result, OUTPUT_LEN*sizeof(uint8_t));
+}
 
 /*
  * 功能：单向函数 RC4
@@ -29,18 +43,13 @@ void crypto_rc4(uint8_t *input, uint32_t inputLen, uint8_t *output) {
 	SHA256_Init(&sha256_ctx);
 	SHA256_Update(&sha256_ctx, input, inputLen);
 	SHA256_Final(sha256Digest, &sha256_ctx);
-	
-	uint8_t md5Digest[MD5_DIGEST_LENGTH];
-	
-	MD5_CTX md5_ctx;
-	MD5_Init(&md5_ctx);
-	MD5_Update(&md5_ctx, sha256Digest, SHA256_DIGEST_LENGTH);
-	MD5_Final(md5Digest, &md5_ctx);
-	
-	RC4_KEY akey;
-	RC4_set_key(&akey, MD5_DIGEST_LENGTH, md5Digest);
-	uint8_t result[SHA256_DIGEST_LENGTH];
-	RC4(&akey, SHA256_DIGEST_LENGTH, sha256Digest, result);
 
-	memcpy(output, result, OUTPUT_LEN*sizeof(uint8_t));
+	rc4_encrypt_digest(sha256Digest, output);
+}
+
+void crypto_rc4_32(uint8_t *input, uint8_t *output) {
+	uint8_t sha256Digest[SHA256_DIGEST_LENGTH];
+	sha256_single_block(input, 32, sha256Digest);
+
+	rc4_encrypt_digest(sha256Digest, output);
 }
@@ -5,26 +5,39 @@
 #include <openssl/ripemd.h>
 
 #include "common.h"
+#include "single_block.h"
 
-/*
- * 功能：单向函数 RIPE-MD160
- * 输入：1. input ：输入消息
- *		 2. output：输出结果
-*/
-void crypto_ripemd160(uint8_t *input, uint32_t inputLen, uint8_t *output) {
-	uint8_t result[(RIPEMD160_DIGEST_LENGTH) << 1];
-
+static void ripemd160_ctx(const uint8_t *input, uint32_t inputLen, uint8_t *output) {
 	RIPEMD160_CTX ctx;
 	RIPEMD160_Init(&ctx);
 	RIPEMD160_Update(&ctx, input, inputLen);
-	RIPEMD160_Final(result, &ctx);
+	RIPEMD160_Final(output, &ctx);
+}
+
+// $output = reduce_bit(ripemd160($input) . ripemd160(~$input)), hashing with the given function
+static void ripemd160_twice(uint8_t *input, uint32_t inputLen,
+		void (*hash)(const uint8_t *, uint32_t, uint8_t *), uint8_t *output) {
+	uint8_t result[(RIPEMD160_DIGEST_LENGTH) << 1];
+
+	hash(input, inputLen, result);
 
 	uint8_t inputStr[INPUT_LEN];
 	for(uint32_t i = 0; i < inputLen; ++i)
 		inputStr[i] = ~(input[i]);
-	RIPEMD160_Init(&ctx);
-	RIPEMD160_Update(&ctx, inputStr, inputLen);
-	RIPEMD160_Final(result + RIPEMD160_DIGEST_LENGTH, &ctx);
-	
+	hash(inputStr, inputLen, result + RIPEMD160_DIGEST_LENGTH);
+
 	reduce_bit(result, (RIPEMD160_DIGEST_LENGTH) << 1, output, 256);
 }
+
+/*
+ * 功能：单向函数 RIPE-MD160
+ * 输入：1. input ：输入消息
+ *		 2. output：输出结果
+*/
+void crypto_ripemd160(uint8_t *input, uint32_t inputLen, uint8_t *output) {
+	ripemd160_twice(input, inputLen, ripemd160_ctx, output);
+}
+
+void crypto_ripemd160_32(uint8_t *input, uint8_t *output) {
+	ripemd160_twice(input, 32, ripemd160_single_block, output);
+}
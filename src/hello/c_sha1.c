@@ -5,27 +5,39 @@
 #include <openssl/sha.h>
 
 #include "common.h"
+#include "single_block.h"
 
-/*
- * 功能：单向函数 SHA1
- * 输入：1. input ：输入消息
- *		 2. output：输出结果
-*/
-void crypto_sha1(uint8_t *input, uint32_t inputLen, uint8_t *output) {
-	uint32_t i;
-	uint8_t result[(SHA_DIGEST_LENGTH) << 1];
-
+static void sha1_ctx(const uint8_t *input, uint32_t inputLen, uint8_t *output) {
 	SHA_CTX ctx;
 	SHA1_Init(&ctx);
 	SHA1_Update(&ctx, input, inputLen);
-	SHA1_Final(result, &ctx);
+	SHA1_Final(output, &ctx);
+}
+
+// $output = reduce_bit(sha1($input) . sha1(~$input)), hashing with the given function
+static void sha1_twice(uint8_t *input, uint32_t inputLen,
+		void (*hash)(const uint8_t *, uint32_t, uint8_t *), uint8_t *output) {
+	uint8_t result[(SHA_DIGEST_LENGTH) << 1];
+
+	hash(input, inputLen, result);
 
 	uint8_t inputStr[INPUT_LEN];
-	for(i = 0; i < inputLen; ++i)
+	for(uint32_t i = 0; i < inputLen; ++i)
 		inputStr[i] = ~(input[i]);
-	SHA1_Init(&ctx);
-	SHA1_Update(&ctx, inputStr, inputLen);
-	SHA1_Final(result + SHA_DIGEST_LENGTH, &ctx);
+	hash(inputStr, inputLen, result + SHA_DIGEST_LENGTH);
 
 	reduce_bit(result, (SHA_DIGEST_LENGTH) << 1, output, 256);
 }
+
+/*
+ * 功能：单向函数 SHA1
+ * 输入：1. input ：输入消息
+ *		 2. output：输出结果
+*/
+void crypto_sha1(uint8_t *input, uint32_t inputLen, uint8_t *output) {
+	sha1_twice(input, inputLen, sha1_ctx, output);
+}
+
+void crypto_sha1_32(uint8_t *input, uint8_t *output) {
+	sha1_twice(input, 32, sha1_single_block, output);
+}
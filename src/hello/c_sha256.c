@@ -5,6 +5,7 @@
 #include <openssl/sha.h>
 
 #include "common.h"
+#include "single_block.h"
 
 /*
  * 功能：单向函数 SHA256
@@ -20,4 +21,8 @@ void crypto_sha256(uint8_t *input, uint32_t inputLen, uint8_t *output) {
 	SHA256_Final(result, &ctx);
 	
 	memcpy(output, result, OUTPUT_LEN*sizeof(uint8_t));
+}
+
+void crypto_sha256_32(uint8_t *input, uint8_t *output) {
+	sha256_single_block(input, 32, output);
 }
\ No newline at end of file
@@ -97,3 +97,10 @@ int sha3_final(KECCAK1600_CTX *ctx, unsigned char *md)
 
     return 1;
 }
+
+void crypto_sha3_256_32(uint8_t *input, uint8_t *output) {
+	unsigned char result[OUTPUT_LEN];
+
+	SHA3_256_32(input, result);
+	memcpy(output, result, OUTPUT_LEN*sizeof(uint8_t));
+}
@@ -5,6 +5,7 @@
 #include <openssl/sha.h>
 
 #include "common.h"
+#include "single_block.h"
 
 /*
  * 功能：单向函数 SHA512
@@ -19,5 +20,12 @@ void crypto_sha512(uint8_t *input, uint32_t inputLen, uint8_t *output) {
 	SHA512_Update(&ctx, input, inputLen);
 	SHA512_Final(result, &ctx);
 	
+	reduce_bit(result, SHA512_DIGEST_LENGTH, output, 256);
+}
+
+void crypto_sha512_32(uint8_t *input, uint8_t *output) {
+	uint8_t result[SHA512_DIGEST_LENGTH];
+
+	sha512_single_block(input, 32, result);
 	reduce_bit(result, SHA512_DIGEST_LENGTH, output, 256);
 }
\ No newline at end of file
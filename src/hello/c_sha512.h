@@ -14,6 +14,9 @@ extern "C" {
 	*/
 	extern void crypto_sha512(uint8_t *input, uint32_t inputLen, uint8_t *output);
 
+	/* Same result as crypto_sha512 for inputLen == 32 */
+	extern void crypto_sha512_32(uint8_t *input, uint8_t *output);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,10 +28,12 @@ void view_data_u32(const char *mess,
 
 void reduce_bit(uint8_t *input, uint32_t inputLen, 
         uint8_t *output, uint32_t bits) {                                                                                                                                                                         
-    uint32_t i, outputLen = (bits) >> 3;
+    uint32_t i, j, outputLen = (bits) >> 3;
     memcpy(output, input, outputLen * sizeof(uint8_t));
-    for (i = outputLen; i < inputLen; ++i) {
-        output[i % outputLen] ^= input[i % inputLen];
+    for (i = outputLen, j = 0; i < inputLen; ++i) {
+        output[j] ^= input[i];
+        if (++j == outputLen)
+            j = 0;
     }
 }
 void rrs(uint8_t *input, uint32_t inputLen, 
@@ -35,16 +35,28 @@ static inline void reduce_bit_2(uint8_t *input, uint32_t inputLen,
 	}
 }
 
-void reduce_bit(uint8_t *input, uint32_t inputLen, 
-		uint8_t *output, uint32_t bits);
+// reduce_bit(&x, sizeof(x), &out, 8) for a single integer: XOR of its bytes
+static inline uint8_t reduce_u32_8(uint32_t x) {
+	x ^= x >> 16;
+	x ^= x >> 8;
+	return (uint8_t)x;
+}
 
-void rrs(uint8_t *input, uint32_t inputLen, 
-		uint8_t *output, uint32_t bits);
+static inline uint8_t reduce_u64_8(uint64_t x) {
+	x ^= x >> 32;
+	return reduce_u32_8((uint32_t)x);
+}
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+	void reduce_bit(uint8_t *input, uint32_t inputLen, 
+			uint8_t *output, uint32_t bits);
+
+	void rrs(uint8_t *input, uint32_t inputLen, 
+			uint8_t *output, uint32_t bits);
+
 	void view_data_u8(const char *mess, uint8_t *data, uint32_t len);
 	void view_data_u32(const char *mess, uint32_t *data, uint32_t len);
 
@@ -1120,6 +1120,35 @@ void SHA3_squeeze(uint64_t A[5][5], unsigned char *out, size_t len, size_t r)
             KeccakF1600(A);
     }
 }
+
+/*
+ * SHA3-256 of exactly 32 bytes. Message and padding fit in the first
+ * block, so the lanes are set directly and a single permutation runs
+ * instead of the buffered absorb/squeeze of sha3_update/sha3_final.
+ */
+void SHA3_256_32(const unsigned char *inp, unsigned char *out)
+{
+    uint64_t A[5][5];
+    uint64_t *A_flat = (uint64_t *)A;
+    size_t i;
+
+    memset(A, 0, sizeof(A));
+    for (i = 0; i < 4; i++) {
+        uint64_t Ai = (uint64_t)inp[0]       | (uint64_t)inp[1] << 8  |
+                      (uint64_t)inp[2] << 16 | (uint64_t)inp[3] << 24 |
+                      (uint64_t)inp[4] << 32 | (uint64_t)inp[5] << 40 |
+                      (uint64_t)inp[6] << 48 | (uint64_t)inp[7] << 56;
+        inp += 8;
+
+        A_flat[i] = BitInterleave(Ai);
+    }
+    /* SHA3 padding: 0x06 after the message, 0x80 in the last byte of the
+     * (1600-512)/8 = 136 byte block, i.e. lane 16 */
+    A_flat[4] = BitInterleave(0x06);
+    A_flat[16] = BitInterleave((uint64_t)0x80 << 56);
+    KeccakF1600(A);
+    SHA3_squeeze(A, out, 32, (1600 - 512) / 8);
+}
 #endif
 
 #ifdef SELFTEST
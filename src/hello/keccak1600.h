@@ -9,6 +9,7 @@ extern "C" {
 
 	extern size_t SHA3_absorb(uint64_t A[5][5], const unsigned char *inp, size_t len, size_t r);
 	extern void SHA3_squeeze(uint64_t A[5][5], unsigned char *out, size_t len, size_t r);
+	extern void SHA3_256_32(const unsigned char *inp, unsigned char *out);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,293 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+#include "kernels.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HELLO_X86_KERNELS
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+static inline uint64_t load_be64(const uint8_t *p) {
+	return ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) |
+		((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) |
+		((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) |
+		((uint64_t)p[6] <<  8) | ((uint64_t)p[7]);
+}
+
+static inline void store_be64(uint8_t *p, uint64_t x) {
+	p[0] = (uint8_t)(x >> 56); p[1] = (uint8_t)(x >> 48);
+	p[2] = (uint8_t)(x >> 40); p[3] = (uint8_t)(x >> 32);
+	p[4] = (uint8_t)(x >> 24); p[5] = (uint8_t)(x >> 16);
+	p[6] = (uint8_t)(x >>  8); p[7] = (uint8_t)(x);
+}
+
+/*
+ * Scalar reference.
+ *
+ * rrs() rotates its input, read as one big-endian bit string, right by
+ * `bits`. For 32 bytes that is a rotation of four big-endian words.
+*/
+static void rrs32Scalar(const uint8_t input[OUTPUT_LEN], uint8_t output[OUTPUT_LEN], uint32_t bits) {
+	uint64_t w[4], o[4];
+	uint32_t j, q = (bits >> 6) & 3, r = bits & 63;
+
+	for (j = 0; j < 4; ++j)
+		w[j] = load_be64(input + (j << 3));
+	for (j = 0; j < 4; ++j) {
+		uint64_t cur = w[(j - q) & 3], prev = w[(j - q - 1) & 3];
+		o[j] = r ? (cur >> r) | (prev << (64 - r)) : cur;
+	}
+	for (j = 0; j < 4; ++j)
+		store_be64(output + (j << 3), o[j]);
+}
+
+static void fillRowsScalar(struct my_rand48_data randBuffer[4], uint8_t *Maddr,
+		uint32_t i, uint32_t count, uint8_t a[OUTPUT_LEN]) {
+	uint32_t j;
+	const uint32_t end = i + count;
+	uint8_t b[OUTPUT_LEN], result[OUTPUT_LEN];
+
+	for (; i < end; ++i) {
+		for (j = 0; j < 4; ++j) {
+			uint64_t num = 0;
+			my_rand64_r(&randBuffer[j], &num);
+			memcpy(b + (j << 3), (uint8_t *)&num, 8*sizeof(uint8_t));
+		}
+		rrs32Scalar(b, result, reduce_u32_8(i));
+
+		memcpy(Maddr + (i << 5), result, OUTPUT_LEN*sizeof(uint8_t));
+		for (j = 0; j < OUTPUT_LEN; ++j)
+			a[j] ^= result[j];
+	}
+}
+
+static void xorRowsScalar(uint8_t result[OUTPUT_LEN], const uint8_t *rows, uint32_t count) {
+	uint32_t i, k;
+	for (i = 0; i < count; ++i, rows += OUTPUT_LEN)
+		for (k = 0; k < OUTPUT_LEN; ++k)
+			result[k] ^= rows[k];
+}
+
+#ifdef HELLO_X86_KERNELS
+
+/*
+ * SSE2: two LCG streams per register. SSE2 has no byte shuffle, so the
+ * rotation stays on the scalar word path.
+*/
+__attribute__((target("sse2")))
+static inline __m128i mullo64_sse2(__m128i x, __m128i m) {
+	__m128i lo = _mm_mul_epu32(x, m);
+	__m128i hi = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(x, 32), m),
+			_mm_mul_epu32(x, _mm_srli_epi64(m, 32)));
+	return _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+}
+
+__attribute__((target("sse2")))
+static void fillRowsSSE2(struct my_rand48_data randBuffer[4], uint8_t *Maddr,
+		uint32_t i, uint32_t count, uint8_t a[OUTPUT_LEN]) {
+	const uint32_t end = i + count;
+	const __m128i mask48 = _mm_set1_epi64x(0xffffffffffffLL);
+	__m128i x0 = _mm_set_epi64x((long long)randBuffer[1].__x, (long long)randBuffer[0].__x);
+	__m128i x1 = _mm_set_epi64x((long long)randBuffer[3].__x, (long long)randBuffer[2].__x);
+	const __m128i m0 = _mm_set_epi64x((long long)randBuffer[1].__a, (long long)randBuffer[0].__a);
+	const __m128i m1 = _mm_set_epi64x((long long)randBuffer[3].__a, (long long)randBuffer[2].__a);
+	const __m128i c0 = _mm_set_epi64x(randBuffer[1].__c, randBuffer[0].__c);
+	const __m128i c1 = _mm_set_epi64x(randBuffer[3].__c, randBuffer[2].__c);
+	__m128i acc0 = _mm_loadu_si128((const __m128i *)a);
+	__m128i acc1 = _mm_loadu_si128((const __m128i *)(a + 16));
+	uint8_t b[OUTPUT_LEN];
+
+	for (; i < end; ++i) {
+		__m128i y0 = _mm_and_si128(_mm_add_epi64(mullo64_sse2(x0, m0), c0), mask48);
+		__m128i y1 = _mm_and_si128(_mm_add_epi64(mullo64_sse2(x1, m1), c1), mask48);
+		x0 = _mm_and_si128(_mm_add_epi64(mullo64_sse2(y0, m0), c0), mask48);
+		x1 = _mm_and_si128(_mm_add_epi64(mullo64_sse2(y1, m1), c1), mask48);
+		_mm_storeu_si128((__m128i *)b, _mm_xor_si128(y0, _mm_slli_epi64(x0, 16)));
+		_mm_storeu_si128((__m128i *)(b + 16), _mm_xor_si128(y1, _mm_slli_epi64(x1, 16)));
+
+		uint8_t *row = Maddr + (i << 5);
+		rrs32Scalar(b, row, reduce_u32_8(i));
+		acc0 = _mm_xor_si128(acc0, _mm_loadu_si128((const __m128i *)row));
+		acc1 = _mm_xor_si128(acc1, _mm_loadu_si128((const __m128i *)(row + 16)));
+	}
+
+	_mm_storeu_si128((__m128i *)a, acc0);
+	_mm_storeu_si128((__m128i *)(a + 16), acc1);
+
+	uint64_t x[4];
+	_mm_storeu_si128((__m128i *)x, x0);
+	_mm_storeu_si128((__m128i *)(x + 2), x1);
+	for (uint32_t j = 0; j < 4; ++j)
+		randBuffer[j].__x = x[j];
+}
+
+__attribute__((target("sse2")))
+static void xorRowsSSE2(uint8_t result[OUTPUT_LEN], const uint8_t *rows, uint32_t count) {
+	__m128i acc0 = _mm_loadu_si128((const __m128i *)result);
+	__m128i acc1 = _mm_loadu_si128((const __m128i *)(result + 16));
+	for (uint32_t i = 0; i < count; ++i, rows += OUTPUT_LEN) {
+		acc0 = _mm_xor_si128(acc0, _mm_loadu_si128((const __m128i *)rows));
+		acc1 = _mm_xor_si128(acc1, _mm_loadu_si128((const __m128i *)(rows + 16)));
+	}
+	_mm_storeu_si128((__m128i *)result, acc0);
+	_mm_storeu_si128((__m128i *)(result + 16), acc1);
+}
+
+/*
+ * AVX2: the four LCG streams share one register and the 256-bit rotation
+ * is done with a byte swap, a lane permutation and a funnel shift.
+*/
+
+/* Lane j of a rotation by q words takes word (j - q) & 3, as 32-bit indices. */
+static const int32_t rotWordIndex[4][8] = {
+	{0, 1, 2, 3, 4, 5, 6, 7},
+	{6, 7, 0, 1, 2, 3, 4, 5},
+	{4, 5, 6, 7, 0, 1, 2, 3},
+	{2, 3, 4, 5, 6, 7, 0, 1}
+};
+
+__attribute__((target("avx2")))
+static inline __m256i mullo64_avx2(__m256i x, __m256i m) {
+	__m256i lo = _mm256_mul_epu32(x, m);
+	__m256i hi = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), m),
+			_mm256_mul_epu32(x, _mm256_srli_epi64(m, 32)));
+	return _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i rot256be_avx2(__m256i v, uint32_t bits) {
+	const __m256i bswap = _mm256_setr_epi8(
+		7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+		7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+	const uint32_t q = (bits >> 6) & 3, r = bits & 63;
+
+	__m256i w = _mm256_shuffle_epi8(v, bswap);
+	__m256i cur = _mm256_permutevar8x32_epi32(w,
+			_mm256_loadu_si256((const __m256i *)rotWordIndex[q]));
+	__m256i prev = _mm256_permutevar8x32_epi32(w,
+			_mm256_loadu_si256((const __m256i *)rotWordIndex[(q + 1) & 3]));
+	// A shift count of 64 yields zero, which covers r == 0.
+	__m256i o = _mm256_or_si256(_mm256_srl_epi64(cur, _mm_cvtsi32_si128(r)),
+			_mm256_sll_epi64(prev, _mm_cvtsi32_si128(64 - r)));
+	return _mm256_shuffle_epi8(o, bswap);
+}
+
+__attribute__((target("avx2")))
+static void rrs32AVX2(const uint8_t input[OUTPUT_LEN], uint8_t output[OUTPUT_LEN], uint32_t bits) {
+	__m256i v = _mm256_loadu_si256((const __m256i *)input);
+	_mm256_storeu_si256((__m256i *)output, rot256be_avx2(v, bits));
+}
+
+__attribute__((target("avx2")))
+static void fillRowsAVX2(struct my_rand48_data randBuffer[4], uint8_t *Maddr,
+		uint32_t i, uint32_t count, uint8_t a[OUTPUT_LEN]) {
+	const uint32_t end = i + count;
+	const __m256i mask48 = _mm256_set1_epi64x(0xffffffffffffLL);
+	__m256i x = _mm256_setr_epi64x((long long)randBuffer[0].__x, (long long)randBuffer[1].__x,
+			(long long)randBuffer[2].__x, (long long)randBuffer[3].__x);
+	const __m256i m = _mm256_setr_epi64x((long long)randBuffer[0].__a, (long long)randBuffer[1].__a,
+			(long long)randBuffer[2].__a, (long long)randBuffer[3].__a);
+	const __m256i c = _mm256_setr_epi64x(randBuffer[0].__c, randBuffer[1].__c,
+			randBuffer[2].__c, randBuffer[3].__c);
+	__m256i acc = _mm256_loadu_si256((const __m256i *)a);
+
+	for (; i < end; ++i) {
+		__m256i y = _mm256_and_si256(_mm256_add_epi64(mullo64_avx2(x, m), c), mask48);
+		x = _mm256_and_si256(_mm256_add_epi64(mullo64_avx2(y, m), c), mask48);
+		__m256i row = rot256be_avx2(_mm256_xor_si256(y, _mm256_slli_epi64(x, 16)), reduce_u32_8(i));
+		_mm256_storeu_si256((__m256i *)(Maddr + (i << 5)), row);
+		acc = _mm256_xor_si256(acc, row);
+	}
+
+	_mm256_storeu_si256((__m256i *)a, acc);
+
+	uint64_t xs[4];
+	_mm256_storeu_si256((__m256i *)xs, x);
+	for (uint32_t j = 0; j < 4; ++j)
+		randBuffer[j].__x = xs[j];
+}
+
+__attribute__((target("avx2")))
+static void xorRowsAVX2(uint8_t result[OUTPUT_LEN], const uint8_t *rows, uint32_t count) {
+	__m256i acc = _mm256_loadu_si256((const __m256i *)result);
+	for (uint32_t i = 0; i < count; ++i, rows += OUTPUT_LEN)
+		acc = _mm256_xor_si256(acc, _mm256_loadu_si256((const __m256i *)rows));
+	_mm256_storeu_si256((__m256i *)result, acc);
+}
+
+static int cpuHasSSE2(void) {
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return 0;
+	return (edx >> 26) & 1;
+}
+
+static int cpuHasAVX2(void) {
+	unsigned int eax, ebx, ecx, edx, xcr0, xcr0hi;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return 0;
+	// OSXSAVE and AVX, then check the OS saves the YMM state.
+	if (!((ecx >> 27) & 1) || !((ecx >> 28) & 1))
+		return 0;
+	__asm__ __volatile__("xgetbv" : "=a"(xcr0), "=d"(xcr0hi) : "c"(0));
+	if ((xcr0 & 6) != 6)
+		return 0;
+	if (__get_cpuid_max(0, NULL) < 7)
+		return 0;
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	return (ebx >> 5) & 1;
+}
+
+#endif // HELLO_X86_KERNELS
+
+static const helloKernels kernelTable[HELLO_IMPL_NUM] = {
+	{ "scalar", fillRowsScalar, rrs32Scalar, xorRowsScalar },
+#ifdef HELLO_X86_KERNELS
+	{ "sse2",   fillRowsSSE2,   rrs32Scalar, xorRowsSSE2 },
+	{ "avx2",   fillRowsAVX2,   rrs32AVX2,   xorRowsAVX2 },
+#else
+	{ "sse2",   fillRowsScalar, rrs32Scalar, xorRowsScalar },
+	{ "avx2",   fillRowsScalar, rrs32Scalar, xorRowsScalar },
+#endif
+};
+
+const helloKernels *helloActiveKernels = &kernelTable[HELLO_IMPL_SCALAR];
+
+int helloImplSupported(helloImpl impl) {
+	switch (impl) {
+	case HELLO_IMPL_SCALAR:
+		return 1;
+#ifdef HELLO_X86_KERNELS
+	case HELLO_IMPL_SSE2:
+		return cpuHasSSE2();
+	case HELLO_IMPL_AVX2:
+		return cpuHasAVX2();
+#endif
+	default:
+		return 0;
+	}
+}
+
+helloImpl helloBestImpl(void) {
+	if (helloImplSupported(HELLO_IMPL_AVX2))
+		return HELLO_IMPL_AVX2;
+	if (helloImplSupported(HELLO_IMPL_SSE2))
+		return HELLO_IMPL_SSE2;
+	return HELLO_IMPL_SCALAR;
+}
+
+int helloSelectImpl(helloImpl impl) {
+	if (!helloImplSupported(impl))
+		return 0;
+	helloActiveKernels = &kernelTable[impl];
+	return 1;
+}
+
+const helloKernels *helloGetKernels(helloImpl impl) {
+	if (!helloImplSupported(impl))
+		return NULL;
+	return &kernelTable[impl];
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+#ifndef ULORD_HELLO_KERNELS_H
+#define ULORD_HELLO_KERNELS_H
+
+#include <stdint.h>
+
+#include "common.h"
+#include "my_rand48_r.h"
+
+/*
+ * Vectorized building blocks of the PoW. Every implementation is bit-exact
+ * with the scalar reference; the fastest one supported by the CPU is picked
+ * at runtime by helloInit().
+*/
+typedef enum {
+	HELLO_IMPL_SCALAR = 0,
+	HELLO_IMPL_SSE2,
+	HELLO_IMPL_AVX2,
+	HELLO_IMPL_NUM
+} helloImpl;
+
+typedef struct {
+	const char *name;
+
+	/*
+	 * Fill `count` rows of the work memory starting at row `i` from the four
+	 * LCG streams in `randBuffer`, folding every row into `a`.
+	*/
+	void (*fillRows)(struct my_rand48_data randBuffer[4], uint8_t *Maddr,
+			uint32_t i, uint32_t count, uint8_t a[OUTPUT_LEN]);
+
+	/*
+	 * rrs() specialized for 32 byte inputs.
+	*/
+	void (*rrs32)(const uint8_t input[OUTPUT_LEN], uint8_t output[OUTPUT_LEN], uint32_t bits);
+
+	/*
+	 * XOR `count` consecutive 32 byte rows into `result`.
+	*/
+	void (*xorRows)(uint8_t result[OUTPUT_LEN], const uint8_t *rows, uint32_t count);
+} helloKernels;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	extern const helloKernels *helloActiveKernels;
+
+	int helloImplSupported(helloImpl impl);
+	helloImpl helloBestImpl(void);
+
+	/*
+	 * Switch the kernels used by the PoW. Returns 0 if `impl` is not
+	 * supported on this CPU. Meant for tests and benchmarks only, it must not
+	 * be called while other threads are hashing.
+	*/
+	int helloSelectImpl(helloImpl impl);
+	const helloKernels *helloGetKernels(helloImpl impl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ULORD_HELLO_KERNELS_H
@@ -33,23 +33,32 @@
 #include "c_haval5_256.h"
 #include "c_skein512_256.h"
 
+// Functions without a specialised 32 byte path are wrapped for the func32 column
+#define ONE_WAY_FUNCTION_32(name) \
+	static void name##_32(uint8_t *input, uint8_t *output) { name(input, 32, output); }
+
+ONE_WAY_FUNCTION_32(crypto_whirlpool)
+ONE_WAY_FUNCTION_32(crypto_gost)
+ONE_WAY_FUNCTION_32(crypto_haval5_256)
+ONE_WAY_FUNCTION_32(crypto_skein512_256)
+
 OneWayFunctionInfor funcInfor[FUNCTION_NUM] = {
-	"SHA3-256", 			crypto_sha3_256,
-	"SHA1", 				crypto_sha1,
-	"SHA256", 				crypto_sha256,
-	"SHA512", 				crypto_sha512,
-	"Whirlpool", 			crypto_whirlpool,
-	"RIPEMD-160", 			crypto_ripemd160,
-	"BLAKE2s(256bits)", 	crypto_blake2s256,
-	"AES(128bits)", 		crypto_aes128,
-	"DES", 					crypto_des,
-	"RC4", 					crypto_rc4,
-	"Camellia(128bits)", 	crypto_camellia128,
-	"CRC32", 				crypto_crc32,
-	"HMAC(MD5)", 			crypto_hmac_md5,
-	"GOST R 34.11-94", 		crypto_gost, 
-	"HAVAL-256/5", 			crypto_haval5_256,
-	"Skein-512(256bits)", 	crypto_skein512_256
+	"SHA3-256", 			crypto_sha3_256, crypto_sha3_256_32,
+	"SHA1", 				crypto_sha1, crypto_sha1_32,
+	"SHA256", 				crypto_sha256, crypto_sha256_32,
+	"SHA512", 				crypto_sha512, crypto_sha512_32,
+	"Whirlpool", 			crypto_whirlpool, crypto_whirlpool_32,
+	"RIPEMD-160", 			crypto_ripemd160, crypto_ripemd160_32,
+	"BLAKE2s(256bits)", 	crypto_blake2s256, crypto_blake2s256_32,
+	"AES(128bits)", 		crypto_aes128, crypto_aes128_32,
+	"DES", 					crypto_des, crypto_des_32,
+	"RC4", 					crypto_rc4, crypto_rc4_32,
+	"Camellia(128bits)", 	crypto_camellia128, crypto_camellia128_32,
+	"CRC32", 				crypto_crc32, crypto_crc32_32,
+	"HMAC(MD5)", 			crypto_hmac_md5, crypto_hmac_md5_32,
+	"GOST R 34.11-94", 		crypto_gost, crypto_gost_32,
+	"HAVAL-256/5", 			crypto_haval5_256, crypto_haval5_256_32,
+	"Skein-512(256bits)", 	crypto_skein512_256, crypto_skein512_256_32
 };
 
 void initOneWayFunction() {
@@ -5,10 +5,13 @@
 #include <stdint.h>
 
 typedef void (*OneWayFunction)(uint8_t *, uint32_t, uint8_t *);
+// Fixed 32 byte input variant, used by the PoW for every hash after the first
+typedef void (*OneWayFunction32)(uint8_t *, uint8_t *);
 
 typedef struct {
 	const char *funcName;
 	OneWayFunction func;
+	OneWayFunction32 func32;
 } OneWayFunctionInfor;
 
 #define FUNCTION_NUM	16
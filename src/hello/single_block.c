@@ -0,0 +1,171 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+#include "single_block.h"
+
+#include <assert.h>
+#include <string.h>
+#include <openssl/md5.h>
+#include <openssl/ripemd.h>
+#include <openssl/sha.h>
+
+/* Copy the message into a zeroed block and append the 0x80 terminator. */
+static void pad_block(uint8_t *block, uint32_t blockLen, const uint8_t *input, uint32_t inputLen) {
+	memset(block, 0, blockLen);
+	memcpy(block, input, inputLen);
+	block[inputLen] = 0x80;
+}
+
+/* Bit length of the message in the last 8 bytes of the block */
+static void put_len_be(uint8_t *end, uint64_t bytes) {
+	uint64_t bits = bytes << 3;
+	int i;
+	for (i = 1; i <= 8; ++i, bits >>= 8)
+		end[-i] = (uint8_t)bits;
+}
+
+static void put_len_le(uint8_t *end, uint64_t bytes) {
+	uint64_t bits = bytes << 3;
+	int i;
+	for (i = 8; i >= 1; --i, bits >>= 8)
+		end[-i] = (uint8_t)bits;
+}
+
+/*
+ * Stores of the chaining state. Spelled as byte shifts gcc vectorises the
+ * unrolled loops badly enough to cost more than the compression saves, so
+ * use a plain (swapped) word store where the byte order is known.
+*/
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static void store32_be(uint8_t *p, uint32_t v) {
+	v = __builtin_bswap32(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+static void store32_le(uint8_t *p, uint32_t v) {
+	memcpy(p, &v, sizeof(v));
+}
+#else
+static void store32_be(uint8_t *p, uint32_t v) {
+	p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16); p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v;
+}
+
+static void store32_le(uint8_t *p, uint32_t v) {
+	p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+#endif
+
+static void store64_be(uint8_t *p, uint64_t v) {
+	store32_be(p, (uint32_t)(v >> 32));
+	store32_be(p + 4, (uint32_t)v);
+}
+
+void md5_single_block(const uint8_t *input, uint32_t inputLen, uint8_t output[16]) {
+	uint8_t block[MD5_CBLOCK];
+	MD5_CTX ctx;
+
+	assert(inputLen <= SINGLE_BLOCK_MAX_LEN);
+	pad_block(block, sizeof(block), input, inputLen);
+	put_len_le(block + sizeof(block), inputLen);
+	MD5_Init(&ctx);
+	MD5_Transform(&ctx, block);
+	store32_le(output, ctx.A);
+	store32_le(output + 4, ctx.B);
+	store32_le(output + 8, ctx.C);
+	store32_le(output + 12, ctx.D);
+}
+
+void sha1_single_block(const uint8_t *input, uint32_t inputLen, uint8_t output[20]) {
+	uint8_t block[SHA_CBLOCK];
+	SHA_CTX ctx;
+
+	assert(inputLen <= SINGLE_BLOCK_MAX_LEN);
+	pad_block(block, sizeof(block), input, inputLen);
+	put_len_be(block + sizeof(block), inputLen);
+	SHA1_Init(&ctx);
+	SHA1_Transform(&ctx, block);
+	store32_be(output, ctx.h0);
+	store32_be(output + 4, ctx.h1);
+	store32_be(output + 8, ctx.h2);
+	store32_be(output + 12, ctx.h3);
+	store32_be(output + 16, ctx.h4);
+}
+
+void sha256_single_block(const uint8_t *input, uint32_t inputLen, uint8_t output[32]) {
+	uint8_t block[SHA256_CBLOCK];
+	SHA256_CTX ctx;
+	int i;
+
+	assert(inputLen <= SINGLE_BLOCK_MAX_LEN);
+	pad_block(block, sizeof(block), input, inputLen);
+	put_len_be(block + sizeof(block), inputLen);
+	SHA256_Init(&ctx);
+	SHA256_Transform(&ctx, block);
+	for (i = 0; i < 8; ++i)
+		store32_be(output + 4 * i, ctx.h[i]);
+}
+
+void sha512_single_block(const uint8_t *input, uint32_t inputLen, uint8_t output[64]) {
+	/* The length field is 128 bits, the upper half is always zero here */
+	uint8_t block[SHA512_CBLOCK];
+	SHA512_CTX ctx;
+	int i;
+
+	assert(inputLen <= SINGLE_BLOCK_MAX_LEN_64);
+	pad_block(block, sizeof(block), input, inputLen);
+	put_len_be(block + sizeof(block), inputLen);
+	SHA512_Init(&ctx);
+	SHA512_Transform(&ctx, block);
+	for (i = 0; i < 8; ++i)
+		store64_be(output + 8 * i, ctx.h[i]);
+}
+
+void ripemd160_single_block(const uint8_t *input, uint32_t inputLen, uint8_t output[20]) {
+	uint8_t block[RIPEMD160_CBLOCK];
+	RIPEMD160_CTX ctx;
+
+	assert(inputLen <= SINGLE_BLOCK_MAX_LEN);
+	pad_block(block, sizeof(block), input, inputLen);
+	put_len_le(block + sizeof(block), inputLen);
+	RIPEMD160_Init(&ctx);
+	RIPEMD160_Transform(&ctx, block);
+	store32_le(output, ctx.A);
+	store32_le(output + 4, ctx.B);
+	store32_le(output + 8, ctx.C);
+	store32_le(output + 12, ctx.D);
+	store32_le(output + 16, ctx.E);
+}
+
+void hmac_md5_short(const uint8_t *key, uint32_t keyLen,
+		const uint8_t *input, uint32_t inputLen, uint8_t output[16]) {
+	uint8_t pad[MD5_CBLOCK], block[MD5_CBLOCK];
+	MD5_CTX ctx;
+	uint32_t i;
+
+	assert(keyLen <= MD5_CBLOCK && inputLen <= SINGLE_BLOCK_MAX_LEN);
+
+	/* inner: md5((key ^ ipad) || input) */
+	memset(pad, 0x36, sizeof(pad));
+	for (i = 0; i < keyLen; ++i)
+		pad[i] ^= key[i];
+	pad_block(block, sizeof(block), input, inputLen);
+	put_len_le(block + sizeof(block), MD5_CBLOCK + inputLen);
+	MD5_Init(&ctx);
+	MD5_Transform(&ctx, pad);
+	MD5_Transform(&ctx, block);
+	store32_le(output, ctx.A);
+	store32_le(output + 4, ctx.B);
+	store32_le(output + 8, ctx.C);
+	store32_le(output + 12, ctx.D);
+
+	/* outer: md5((key ^ opad) || inner) */
+	for (i = 0; i < sizeof(pad); ++i)
+		pad[i] ^= 0x36 ^ 0x5c;
+	pad_block(block, sizeof(block), output, MD5_DIGEST_LENGTH);
+	put_len_le(block + sizeof(block), MD5_CBLOCK + MD5_DIGEST_LENGTH);
+	MD5_Init(&ctx);
+	MD5_Transform(&ctx, pad);
+	MD5_Transform(&ctx, block);
+	store32_le(output, ctx.A);
+	store32_le(output + 4, ctx.B);
+	store32_le(output + 8, ctx.C);
+	store32_le(output + 12, ctx.D);
+}
@@ -0,0 +1,37 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+#ifndef ULORD_HELLO_SINGLE_BLOCK_H
+#define ULORD_HELLO_SINGLE_BLOCK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/*
+	 * Digests of messages short enough that they and their padding fit in
+	 * one block: the padded block is built on the stack and compressed
+	 * once, skipping the buffering of the Init/Update/Final interfaces.
+	 * The one-way functions only ever hash 16 or 32 byte values.
+	*/
+	#define SINGLE_BLOCK_MAX_LEN	55	/* md5, sha1, sha256, ripemd160 */
+	#define SINGLE_BLOCK_MAX_LEN_64	111	/* sha512 */
+
+	void md5_single_block(const uint8_t *input, uint32_t inputLen, uint8_t output[16]);
+	void sha1_single_block(const uint8_t *input, uint32_t inputLen, uint8_t output[20]);
+	void sha256_single_block(const uint8_t *input, uint32_t inputLen, uint8_t output[32]);
+	void sha512_single_block(const uint8_t *input, uint32_t inputLen, uint8_t output[64]);
+	void ripemd160_single_block(const uint8_t *input, uint32_t inputLen, uint8_t output[20]);
+
+	/*
+	 * HMAC-MD5 with a key of at most 64 bytes over a message of at most 55
+	 * bytes: two compressions for the inner hash, two for the outer one.
+	*/
+	void hmac_md5_short(const uint8_t *key, uint32_t keyLen,
+			const uint8_t *input, uint32_t inputLen, uint8_t output[16]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ULORD_HELLO_SINGLE_BLOCK_H
@@ -24,6 +24,7 @@
 #include <event2/http.h>
 #include <event2/thread.h>
 #include <event2/buffer.h>
+#include <event2/bufferevent.h>
 #include <event2/util.h>
 #include <event2/keyvalq_struct.h>
 
@@ -552,6 +553,9 @@ HTTPRequest::HTTPRequest(struct evhttp_request* req) : req(req),
 }
 HTTPRequest::~HTTPRequest()
 {
+    if (chunked && !replySent) {
+        WriteReplyEnd();
+    }
     if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
@@ -617,6 +621,132 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = 0; // transferred back to main thread
 }
 
+/**
+ * State of a chunked reply shared with the event thread. The connection can
+ * close before the reply is finished, after which evhttp has freed the
+ * request and the remaining chunks must be dropped. The bytes not yet sent
+ * to the client are counted so the producer can wait for them to drain.
+ */
+struct HTTPChunkedReply
+{
+    struct evhttp_request* req;
+    struct evbuffer* output;
+    struct evbuffer_cb_entry* outputCb;
+    boost::mutex cs;
+    boost::condition_variable cond;
+    bool fClosed;
+    size_t nQueued;   // handed to the event thread, not yet to the connection
+    size_t nBuffered; // in the connection's output buffer
+
+    HTTPChunkedReply(struct evhttp_request* req) :
+        req(req), output(NULL), outputCb(NULL), fClosed(false), nQueued(0), nBuffered(0) {}
+};
+
+static void http_chunked_close_cb(struct evhttp_connection*, void* arg)
+{
+    HTTPChunkedReply* reply = (HTTPChunkedReply*)arg;
+    boost::lock_guard<boost::mutex> lock(reply->cs);
+    reply->fClosed = true;
+    reply->cond.notify_all();
+}
+
+static void http_chunked_output_cb(struct evbuffer* buf, const struct evbuffer_cb_info*, void* arg)
+{
+    HTTPChunkedReply* reply = (HTTPChunkedReply*)arg;
+    boost::lock_guard<boost::mutex> lock(reply->cs);
+    reply->nBuffered = evbuffer_get_length(buf);
+    reply->cond.notify_all();
+}
+
+static bool http_chunked_closed(HTTPChunkedReply* reply)
+{
+    boost::lock_guard<boost::mutex> lock(reply->cs);
+    return reply->fClosed;
+}
+
+static void http_chunked_start(boost::shared_ptr<HTTPChunkedReply> reply, int nStatus)
+{
+    struct evhttp_connection* con = evhttp_request_get_connection(reply->req);
+    evhttp_connection_set_closecb(con, http_chunked_close_cb, reply.get());
+    reply->output = bufferevent_get_output(evhttp_connection_get_bufferevent(con));
+    reply->outputCb = evbuffer_add_cb(reply->output, http_chunked_output_cb, reply.get());
+    evhttp_send_reply_start(reply->req, nStatus, NULL);
+}
+
+static void http_chunked_send(boost::shared_ptr<HTTPChunkedReply> reply, struct evbuffer* evb)
+{
+    size_t nSize = evbuffer_get_length(evb);
+    if (!http_chunked_closed(reply.get()))
+        evhttp_send_reply_chunk(reply->req, evb);
+    evbuffer_free(evb);
+    boost::lock_guard<boost::mutex> lock(reply->cs);
+    reply->nQueued -= nSize;
+    reply->cond.notify_all();
+}
+
+static void http_chunked_end(boost::shared_ptr<HTTPChunkedReply> reply)
+{
+    // Once closed, evhttp has freed the connection along with its callbacks
+    if (http_chunked_closed(reply.get()))
+        return;
+    // The connection may outlive the reply, so stop pointing it at us
+    evbuffer_remove_cb_entry(reply->output, reply->outputCb);
+    evhttp_connection_set_closecb(evhttp_request_get_connection(reply->req), NULL, NULL);
+    evhttp_send_reply_end(reply->req);
+}
+
+void HTTPRequest::WriteReplyStart(int nStatus)
+{
+    assert(!replySent && !chunked && req);
+    chunked.reset(new HTTPChunkedReply(req));
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, boost::bind(http_chunked_start, chunked, nStatus));
+    ev->trigger(0);
+}
+
+void HTTPRequest::WriteReplyChunk(const std::string& strChunk)
+{
+    assert(!replySent && chunked);
+    {
+        boost::lock_guard<boost::mutex> lock(chunked->cs);
+        if (chunked->fClosed)
+            return;
+        chunked->nQueued += strChunk.size();
+    }
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, strChunk.data(), strChunk.size());
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, boost::bind(http_chunked_send, chunked, evb));
+    ev->trigger(0);
+}
+
+void HTTPRequest::WriteReplyEnd()
+{
+    assert(!replySent && chunked);
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, boost::bind(http_chunked_end, chunked));
+    ev->trigger(0);
+    replySent = true;
+    req = 0; // transferred back to main thread
+}
+
+bool HTTPRequest::IsReplyClosed()
+{
+    if (!chunked)
+        return false;
+    return http_chunked_closed(chunked.get());
+}
+
+bool HTTPRequest::WaitReplyDrained(size_t nMaxPending, int64_t nTimeout)
+{
+    assert(!replySent && chunked);
+    boost::system_time deadline = boost::get_system_time() + boost::posix_time::seconds(nTimeout);
+    boost::unique_lock<boost::mutex> lock(chunked->cs);
+    while (!chunked->fClosed && chunked->nQueued + chunked->nBuffered > nMaxPending) {
+        if (!chunked->cond.timed_wait(lock, deadline))
+            return chunked->fClosed || chunked->nQueued + chunked->nBuffered <= nMaxPending;
+    }
+    return true;
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
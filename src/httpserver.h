@@ -9,6 +9,7 @@
 #include <stdint.h>
 #include <boost/thread.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/function.hpp>
 
 static const int DEFAULT_HTTP_THREADS=4;
@@ -49,6 +50,8 @@ void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
  */
 struct event_base* EventBase();
 
+struct HTTPChunkedReply;
+
 /** In-flight HTTP request.
  * Thin C++ wrapper around evhttp_request.
  */
@@ -57,6 +60,7 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    boost::shared_ptr<HTTPChunkedReply> chunked;
 
 public:
     HTTPRequest(struct evhttp_request* req);
@@ -112,6 +116,26 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a reply whose body is sent with chunked transfer encoding as it
+     * is produced. Follow with WriteReplyChunk calls and finish with
+     * WriteReplyEnd, which gives the request back to the main thread like
+     * WriteReply.
+     */
+    void WriteReplyStart(int nStatus);
+    void WriteReplyChunk(const std::string& strChunk);
+    void WriteReplyEnd();
+
+    /** Whether the client went away during a chunked reply */
+    bool IsReplyClosed();
+
+    /**
+     * Wait until no more than nMaxPending bytes of a chunked reply are
+     * waiting to be sent, or the client went away. Returns false if that
+     * takes longer than nTimeout seconds.
+     */
+    bool WaitReplyDrained(size_t nMaxPending, int64_t nTimeout);
 };
 
 /** Event handler closure.
@@ -12,6 +12,7 @@
 #include "init.h"
 #include "claimtrie.h"  // added opt
 #include "crypto/common.h"
+#include "crypto/sha256.h"
 #include "addrman.h"
 #include "amount.h"
 #include "chain.h"
@@ -31,6 +32,7 @@
 #include "script/standard.h"
 #include "script/sigcache.h"
 #include "scheduler.h"
+#include "socketevents.h"
 #include "txdb.h"
 #include "txmempool.h"
 #include "torcontrol.h"
@@ -70,6 +72,7 @@
 #endif
 
 #include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/split.hpp>
@@ -317,6 +320,7 @@ void Shutdown()
     globalVerifyHandle.reset();
     ECC_Stop();
     LogPrintf("%s: done\n", __func__);
+    StopLogWriter();
 }
 
 /**
@@ -387,6 +391,8 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to operate in a blocks only mode (default: %u)"), DEFAULT_BLOCKSONLY));
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), DEFAULT_CHECKBLOCKS));
     strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), DEFAULT_CHECKLEVEL));
+    strUsage += HelpMessageOpt("-claimtriecache=<n>", strprintf(_("Keep about <n> MiB of claim trie nodes in memory and read the rest from disk when needed (0 = load the whole trie at startup, default: %u)"), DEFAULT_CLAIMTRIE_CACHE));
+    strUsage += HelpMessageOpt("-claimtriehistory=<n>", strprintf(_("Keep enough claim trie history to build name proofs for blocks up to <n> deep (default: %u)"), DEFAULT_CLAIMTRIE_HISTORY));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), BITCOIN_CONF_FILENAME));
     if (mode == HMM_BITCOIND)
     {
@@ -434,6 +440,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXRECEIVEBUFFER));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXSENDBUFFER));
+    strUsage += HelpMessageOpt("-msgworkers=<n>", strprintf(_("Number of threads that check masternode pings, governance votes, InstantSend votes and sporks, 0 to check them on the message handler thread (default: %d, maximum: %d)"), DEFAULT_MSG_WORKERS, MAX_MSG_WORKERS));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), DEFAULT_PERMIT_BAREMULTISIG));
@@ -444,6 +451,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), DEFAULT_PROXYRANDOMIZE));
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("How to wait for socket events, one of: %s (default: %s)"), boost::algorithm::join(GetSocketEventsBackends(), ", "), DEFAULT_SOCKET_EVENTS));
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
@@ -511,7 +519,9 @@ std::string HelpMessage(HelpMessageMode mode)
     {
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
+        strUsage += HelpMessageOpt("-checkclaimtrie", strprintf("Check the hashes of the whole claim trie at startup, including the nodes -claimtriecache leaves on disk (default: %u)", DEFAULT_CHECK_CLAIMTRIE));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
+        strUsage += HelpMessageOpt("-trustedblockstorage", strprintf("Check indexed blocks read from disk against their stored checksum instead of recomputing their proof of work (default: %u)", DEFAULT_TRUSTED_BLOCK_STORAGE));
 #ifdef ENABLE_WALLET
         strUsage += HelpMessageOpt("-dblogsize=<n>", strprintf("Flush wallet database activity from memory to disk log every <n> megabytes (default: %u)", DEFAULT_WALLET_DBLOGSIZE));
 #endif
@@ -539,16 +549,21 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-gen", strprintf(_("Generate coins (default: %u)"), DEFAULT_GENERATE));
     strUsage += HelpMessageOpt("-genproclimit=<n>", strprintf(_("Set the number of threads for coin generation if enabled (-1 = all cores, default: %d)"), DEFAULT_GENERATE_THREADS));
     strUsage += HelpMessageOpt("-help-debug", _("Show all debugging options (usage: --help -help-debug)"));
+    strUsage += HelpMessageOpt("-logflushinterval=<n>", strprintf(_("Write debug.log from a background thread at most every <n> milliseconds, 0 to write synchronously (default: %u)"), DEFAULT_LOG_FLUSH_INTERVAL));
     strUsage += HelpMessageOpt("-logips", strprintf(_("Include IP addresses in debug output (default: %u)"), DEFAULT_LOGIPS));
     strUsage += HelpMessageOpt("-logtimestamps", strprintf(_("Prepend debug output with timestamp (default: %u)"), DEFAULT_LOGTIMESTAMPS));
     if (showDebug)
     {
         strUsage += HelpMessageOpt("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS));
         strUsage += HelpMessageOpt("-logthreadnames", strprintf("Add thread names to debug messages (default: %u)", DEFAULT_LOGTHREADNAMES));
+        strUsage += HelpMessageOpt("-logbuffersize=<n>", strprintf("Queue at most <n> KiB of debug output for the background log writer (default: %u)", DEFAULT_LOG_BUFFER_SIZE));
+        strUsage += HelpMessageOpt("-logdroponoverflow", strprintf("Drop debug messages instead of waiting when the log queue is full (default: %u)", DEFAULT_LOG_DROP_ON_OVERFLOW));
         strUsage += HelpMessageOpt("-mocktime=<n>", "Replace actual time with <n> seconds since epoch (default: 0)");
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default: %u)", DEFAULT_LIMITFREERELAY));
         strUsage += HelpMessageOpt("-relaypriority", strprintf("Require high priority for relaying free or low-fee transactions (default: %u)", DEFAULT_RELAYPRIORITY));
         strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-maxmnsigcachesize=<n>", strprintf("Limit size of the masternode message signature cache to <n> MiB (default: %u)", DEFAULT_MAX_MN_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-blockhashcachesize=<n>", strprintf("Number of block header hashes to keep in memory, 0 to disable (default: %u)", DEFAULT_BLOCK_HASH_CACHE_SIZE));
     }
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(_("Fees (in %s/kB) smaller than this are considered zero fee for relaying, mining and transaction creation (default: %s)"),
         CURRENCY_UNIT, FormatMoney(DEFAULT_MIN_RELAY_TX_FEE)));
@@ -981,8 +996,15 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     int nUserMaxConnections = GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     nMaxConnections = std::max(nUserMaxConnections, 0);
 
+    std::string strSocketEvents = GetArg("-socketevents", DEFAULT_SOCKET_EVENTS);
+    boost::scoped_ptr<CSocketEvents> socketEvents(CreateSocketEvents(strSocketEvents));
+    if (!socketEvents)
+        return InitError(strprintf(_("Unsupported -socketevents mode: '%s'"), strSocketEvents));
+
     // Trim requested connection counts, to fit into system limitations
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+    fSocketEventsUnlimited = socketEvents->IsWatchable(FD_SETSIZE);
+    if (!fSocketEventsUnlimited)
+        nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
     int nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -1022,6 +1044,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     }
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    fTrustedBlockStorage = GetBoolArg("-trustedblockstorage", DEFAULT_TRUSTED_BLOCK_STORAGE);
+    SetBlockHashCacheSize(std::max((int64_t)0, GetArg("-blockhashcachesize", DEFAULT_BLOCK_HASH_CACHE_SIZE)));
 
     // mempool limits
     int64_t nMempoolSizeMax = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
@@ -1165,6 +1189,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
 
+    // Select the SHA256 transforms for this CPU before any other thread hashes
+    std::string strSHA256Impl = SHA256AutoDetect();
+
     // Sanity check
     if (!InitSanityCheck())
         return InitError(_("Initialization sanity check failed. Ulord Core is shutting down."));
@@ -1195,8 +1222,12 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (GetBoolArg("-shrinkdebugfile", !fDebug))
         ShrinkDebugFile();
 
-    if (fPrintToDebugLog)
+    if (fPrintToDebugLog) {
         OpenDebugLog();
+        StartLogWriter(GetArg("-logflushinterval", DEFAULT_LOG_FLUSH_INTERVAL),
+                       std::max<int64_t>(GetArg("-logbuffersize", DEFAULT_LOG_BUFFER_SIZE), 1) * 1024,
+                       !GetBoolArg("-logdroponoverflow", DEFAULT_LOG_DROP_ON_OVERFLOW));
+    }
 
 #ifdef ENABLE_WALLET
     LogPrintf("Using BerkeleyDB version %s\n", DbEnv::version(0, 0, 0));
@@ -1206,6 +1237,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Default data directory %s\n", GetDefaultDataDir().string());
     LogPrintf("Using data directory %s\n", strDataDir);
     LogPrintf("Using config file %s\n", GetConfigFile().string());
+    LogPrintf("Using the '%s' SHA256 implementation\n", strSHA256Impl);
     LogPrintf("Using at most %i connections (%i file descriptors available)\n", nMaxConnections, nFD);
     std::ostringstream strErrors;
 
@@ -1213,6 +1245,11 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadHeaderCheck);
+        nClaimTrieHashThreads = nScriptCheckThreads;
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadClaimTrieHash);
     }
 
     if (mapArgs.count("-sporkkey")) // spork priv key
@@ -1481,6 +1518,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
 				pclaimTrie = new CClaimTrie(false, fReindex); // claim
+                pclaimTrie->setHistoryDepth(GetArg("-claimtriehistory", DEFAULT_CLAIMTRIE_HISTORY));
+                pclaimTrie->setCacheSize(std::max(GetArg("-claimtriecache", DEFAULT_CLAIMTRIE_CACHE), (int64_t)0) << 20);
 
                 if (fReindex) {
                     pblocktree->WriteReindexing(true);
@@ -1510,7 +1549,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     strLoadError = _("You need to rebuild the database using -reindex to change -txindex");
                     break;
                 }
-                if (!pclaimTrie->ReadFromDisk(true)) 
+                if (!pclaimTrie->ReadFromDisk(true, GetBoolArg("-checkclaimtrie", DEFAULT_CHECK_CLAIMTRIE)))
                 {   
                     strLoadError = _("Error loading the claim trie from disk");
                     break;
@@ -57,6 +57,13 @@ void CInstantSend::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataSt
         CTxLockVote vote;
         vRecv >> vote;
 
+        // Votes may arrive on a message worker: check the signature before
+        // taking cs_main so that IsValid() in ProcessTxLockVote finds it
+        // verified in privSendSigner's cache.
+        if(mnodeman.Has(CTxIn(vote.GetMasternodeOutpoint()))) {
+            vote.CheckSignature();
+        }
+
         LOCK2(cs_main, cs_instantsend);
 
         uint256 nVoteHash = vote.GetHash();
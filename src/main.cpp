@@ -18,6 +18,7 @@
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
 #include "hash.h"
+#include "leveldb/util/crc32c.h"
 #include "init.h"
 #include "merkleblock.h"
 #include "net.h"
@@ -89,6 +90,7 @@ bool fRequireStandard = true;
 unsigned int nBytesPerSigOp = DEFAULT_BYTES_PER_SIGOP;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
+bool fTrustedBlockStorage = DEFAULT_TRUSTED_BLOCK_STORAGE;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
 bool fAlerts = DEFAULT_ALERTS;
@@ -1710,7 +1712,40 @@ bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHea
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+/** Writer stream computing the CRC32C of an object's disk serialization. */
+class CChecksumWriter
+{
+private:
+    uint32_t nChecksum;
+
+public:
+    int nType;
+    int nVersion;
+
+    CChecksumWriter(int nTypeIn, int nVersionIn) : nChecksum(0), nType(nTypeIn), nVersion(nVersionIn) {}
+
+    CChecksumWriter& write(const char *pch, size_t size) {
+        nChecksum = leveldb::crc32c::Extend(nChecksum, pch, size);
+        return (*this);
+    }
+
+    uint32_t GetChecksum() const { return nChecksum; }
+
+    template<typename T>
+    CChecksumWriter& operator<<(const T& obj) {
+        ::Serialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
+static uint32_t GetBlockChecksum(const CBlock& block)
+{
+    CChecksumWriter ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+    return ss.GetChecksum();
+}
+
+static bool ReadBlockDataFromDisk(CBlock& block, const CDiskBlockPos& pos)
 {
     block.SetNull();
 
@@ -1726,6 +1761,13 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
     }
+    return true;
+}
+
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+{
+    if (!ReadBlockDataFromDisk(block, pos))
+        return false;
 
     // Check the header
 
@@ -1739,6 +1781,17 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
 
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
+    // The block passed CheckBlock before it was stored, so if the bytes are
+    // unchanged its hash still matches the index and its PoW is still valid.
+    if (fTrustedBlockStorage && pindex->fHaveDataChecksum) {
+        if (!ReadBlockDataFromDisk(block, pindex->GetBlockPos()))
+            return false;
+        if (GetBlockChecksum(block) != pindex->nDataChecksum)
+            return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): checksum doesn't match index for %s at %s",
+                    pindex->ToString(), pindex->GetBlockPos().ToString());
+        return true;
+    }
+
     if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), consensusParams))
         return false;
     if (block.GetHash() != pindex->GetBlockHash())
@@ -2587,6 +2640,99 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+/**
+ * Closure computing the hash of one header and checking it against the
+ * header's own nBits. Always succeeds so that every queued hash gets
+ * computed; the outcome is recorded in *pfValid.
+ */
+class CHeaderPoWCheck
+{
+private:
+    const CBlockHeader* pheader;
+    uint256* phash;
+    char* pfValid;
+
+public:
+    CHeaderPoWCheck() : pheader(NULL), phash(NULL), pfValid(NULL) {}
+    CHeaderPoWCheck(const CBlockHeader& header, uint256& hash, char& fValid) :
+        pheader(&header), phash(&hash), pfValid(&fValid) {}
+
+    bool operator()() {
+        *phash = pheader->GetHash();
+        *pfValid = CheckProofOfWork(*phash, pheader->nBits, Params().GetConsensus());
+        return true;
+    }
+
+    void swap(CHeaderPoWCheck& check) {
+        std::swap(pheader, check.pheader);
+        std::swap(phash, check.phash);
+        std::swap(pfValid, check.pfValid);
+    }
+};
+
+static CCheckQueue<CHeaderPoWCheck> headercheckqueue(16);
+
+void ThreadHeaderCheck() {
+    RenameThread("ulord-headerch");
+    headercheckqueue.Thread();
+}
+
+size_t CountHeadersToPrecheck(const std::vector<CBlockHeader>& headers)
+{
+    AssertLockHeld(cs_main);
+    if (headers.empty())
+        return 0;
+
+    BlockMap::iterator mi = mapBlockIndex.find(headers[0].hashPrevBlock);
+    if (mi == mapBlockIndex.end() || (mi->second->nStatus & BLOCK_FAILED_MASK))
+        return 0;
+
+    std::set<uint256> setParents;
+    int64_t nMaxTime = GetAdjustedTime() + 2 * 60 * 60;
+    for (size_t i = 0; i < headers.size(); i++) {
+        if (!setParents.insert(headers[i].hashPrevBlock).second || headers[i].GetBlockTime() > nMaxTime)
+            return i;
+    }
+    return headers.size();
+}
+
+size_t CheckHeadersProofOfWork(const std::vector<CBlockHeader>& headers, size_t nCount, std::vector<uint256>& vHashes, std::vector<char>& vPoWValid)
+{
+    assert(nCount <= headers.size());
+    vHashes.assign(headers.size(), uint256());
+    vPoWValid.assign(headers.size(), 0);
+
+    // A header's link to the one before it can only be checked once that one
+    // is hashed, so hash a round of one header per thread at a time and stop
+    // at the first header that breaks the chain or misses its target.
+    size_t nRound = std::max(nScriptCheckThreads, 1);
+    size_t nChecked = 0;
+    while (nChecked < nCount) {
+        size_t nEnd = std::min(nCount, nChecked + nRound);
+        std::vector<CHeaderPoWCheck> vChecks;
+        vChecks.reserve(nEnd - nChecked);
+        for (size_t i = nChecked; i < nEnd; i++)
+            vChecks.push_back(CHeaderPoWCheck(headers[i], vHashes[i], vPoWValid[i]));
+
+        if (!nScriptCheckThreads) {
+            BOOST_FOREACH(CHeaderPoWCheck& check, vChecks)
+                check();
+        } else {
+            CCheckQueueControl<CHeaderPoWCheck> control(&headercheckqueue);
+            control.Add(vChecks);
+            control.Wait();
+        }
+
+        for (; nChecked < nEnd; nChecked++) {
+            if (nChecked > 0 && headers[nChecked].hashPrevBlock != vHashes[nChecked - 1])
+                return nChecked;
+            if (!vPoWValid[nChecked])
+                return nChecked;
+        }
+    }
+    return nChecked;
+}
+
 //
 // Called periodically asynchronously; alerts if it smells like
 // we're being fed a bad chain (blocks being generated much
@@ -3936,10 +4082,10 @@ bool ReconsiderBlock(CValidationState& state, CBlockIndex *pindex) {
     return true;
 }
 
-CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
+CBlockIndex* AddToBlockIndex(const CBlockHeader& block, const uint256* phash = NULL)
 {
     // Check for duplicate
-    uint256 hash = block.GetHash();
+    uint256 hash = phash ? *phash : block.GetHash();
     BlockMap::iterator it = mapBlockIndex.find(hash);
     if (it != mapBlockIndex.end())
         return it->second;
@@ -3978,6 +4124,8 @@ bool ReceivedBlockTransactions(const CBlock &block, CValidationState& state, CBl
     pindexNew->nFile = pos.nFile;
     pindexNew->nDataPos = pos.nPos;
     pindexNew->nUndoPos = 0;
+    pindexNew->nDataChecksum = GetBlockChecksum(block);
+    pindexNew->fHaveDataChecksum = true;
     pindexNew->nStatus |= BLOCK_HAVE_DATA;
     pindexNew->RaiseValidity(BLOCK_VALID_TRANSACTIONS);
     setDirtyBlockIndex.insert(pindexNew);
@@ -4315,11 +4463,15 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIn
     return true;
 }
 
-static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex=NULL)
+/**
+ * phash, when set, is the hash of block as computed by
+ * CheckHeadersProofOfWork(), which also found its proof of work valid.
+ */
+static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex=NULL, const uint256* phash=NULL)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
-    uint256 hash = block.GetHash();
+    uint256 hash = phash ? *phash : block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = NULL;
 
@@ -4336,7 +4488,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return true;
         }
 
-        if (!CheckBlockHeader(block, state))
+        if (!CheckBlockHeader(block, state, phash == NULL))
             return false;
 
         // Get prev block index
@@ -4373,7 +4525,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return false;
     }
     if (pindex == NULL)
-        pindex = AddToBlockIndex(block);
+        pindex = AddToBlockIndex(block, &hash);
 
     if (ppindex)
         *ppindex = pindex;
@@ -4543,6 +4695,7 @@ void PruneOneBlockFile(const int fileNumber)
             pindex->nFile = 0;
             pindex->nDataPos = 0;
             pindex->nUndoPos = 0;
+            pindex->fHaveDataChecksum = false;
             setDirtyBlockIndex.insert(pindex);
 
             // Prune from mapBlocksUnlinked -- any block we prune would have
@@ -4902,39 +5055,13 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
 }
 
 bool GetProofForName(const CBlockIndex* pindexProof, const std::string& name, CClaimTrieProof& proof)
-{   
+{
     AssertLockHeld(cs_main);
     if (!chainActive.Contains(pindexProof))
-    {   
+    {
         return false;
     }
-    CCoinsViewCache coins(pcoinsTip);
-    CClaimTrieCache trieCache(pclaimTrie);
-    CBlockIndex* pindexState = chainActive.Tip();
-    CValidationState state;
-    for (CBlockIndex *pindex = chainActive.Tip(); pindex && pindex->pprev && pindexState != pindexProof; pindex=pindex->pprev)
-    {   
-        boost::this_thread::interruption_point();
-        CBlock block;
-        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
-        {   
-            return false;
-        }
-        if (pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage)
-        {   
-            bool fClean = true;
-            if (!DisconnectBlock(block, state, pindex, coins, trieCache, &fClean))                                                                                                                                                                                            
-            {   
-                return false;
-            }
-            pindexState = pindex->pprev;
-        }
-        if (ShutdownRequested())
-            return false;
-    }
-    assert(pindexState == pindexProof);
-    proof = trieCache.getProofForName(name);
-    return true;
+    return pclaimTrie->getProofForName(name, pindexProof->nHeight, proof);
 }
 
 void UnloadBlockIndex()
@@ -6439,6 +6566,19 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
 
+        // The Hello PoW is memory-hard, so hash the headers on the header
+        // check threads before taking cs_main for the serial checks. Hashing
+        // stops at the first header that does not connect to the one before
+        // it, so a junk message costs at most one header per thread.
+        size_t nPrecheck;
+        {
+            LOCK(cs_main);
+            nPrecheck = CountHeadersToPrecheck(headers);
+        }
+        std::vector<uint256> vHashes;
+        std::vector<char> vPoWValid;
+        CheckHeadersProofOfWork(headers, nPrecheck, vHashes, vPoWValid);
+
         LOCK(cs_main);
 
         if (nCount == 0) {
@@ -6455,7 +6595,8 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             lastCheckpoint_t = Checkpoints::ForceGetLastCheckpoint(chainparams_t.Checkpoints());
         }*/
 	    
-        BOOST_FOREACH(const CBlockHeader& header, headers) {
+        for (unsigned int n = 0; n < nCount; n++) {
+            const CBlockHeader& header = headers[n];
             CValidationState state;
 		
 	     /*if (pindexLast !=NULL && pindexLast->nHeight == lastCheckpoint_t.first && lastCheckpoint_t.first != 0){
@@ -6471,12 +6612,14 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                 Misbehaving(pfrom->GetId(), 20);
                 return error("non-continuous headers sequence");
             }
-            if (!AcceptBlockHeader(header, state, chainparams, &pindexLast)) {
+            // Headers that failed the PoW check go through the full check
+            // again so they are rejected exactly as before.
+            if (!AcceptBlockHeader(header, state, chainparams, &pindexLast, vPoWValid[n] ? &vHashes[n] : NULL)) {
                 int nDoS;
                 if (state.IsInvalid(nDoS)) {
                     if (nDoS > 0)
                         Misbehaving(pfrom->GetId(), nDoS);
-                    std::string strError = "invalid header received " + header.GetHash().ToString();
+                    std::string strError = "invalid header received " + (vPoWValid[n] ? vHashes[n] : header.GetHash()).ToString();
                     return error(strError.c_str());
                 }
             }
@@ -6838,6 +6981,73 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     return true;
 }
 
+/** ProcessMessage(), logging whatever it throws or fails with. */
+static bool ProcessMessageChecked(CNode* pfrom, const string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, unsigned int nMessageSize)
+{
+    bool fRet = false;
+    try
+    {
+        fRet = ProcessMessage(pfrom, strCommand, vRecv, nTimeReceived);
+        boost::this_thread::interruption_point();
+    }
+    catch (const std::ios_base::failure& e)
+    {
+        pfrom->PushMessage(NetMsgType::REJECT, strCommand, REJECT_MALFORMED, string("error parsing message"));
+        if (strstr(e.what(), "end of data"))
+        {
+            // Allow exceptions from under-length message on vRecv
+            LogPrintf("ProcessMessages(%s, %u bytes): Exception '%s' caught, normally caused by a message being shorter than its stated length\n", SanitizeString(strCommand), nMessageSize, e.what());
+        }
+        else if (strstr(e.what(), "size too large"))
+        {
+            // Allow exceptions from over-long size
+            LogPrintf("ProcessMessages(%s, %u bytes): Exception '%s' caught\n", SanitizeString(strCommand), nMessageSize, e.what());
+        }
+        else
+        {
+            PrintExceptionContinue(&e, "ProcessMessages()");
+        }
+    }
+    catch (const boost::thread_interrupted&) {
+        throw;
+    }
+    catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "ProcessMessages()");
+    } catch (...) {
+        PrintExceptionContinue(NULL, "ProcessMessages()");
+    }
+
+    if (!fRet)
+        LogPrintf("ProcessMessages(%s, %u bytes) FAILED peer=%d\n", SanitizeString(strCommand), nMessageSize, pfrom->id);
+    return fRet;
+}
+
+/**
+ * Messages ProcessMessages() may hand to a message worker thread. Their
+ * handlers take the locks they need themselves and spend most of their time
+ * checking masternode and spork signatures. A peer's later messages wait
+ * until the worker is done with it, so each peer's messages are still
+ * processed in order.
+ */
+static bool IsParallelMessage(const string& strCommand)
+{
+    return strCommand == NetMsgType::MNPING ||
+           strCommand == NetMsgType::MNGOVERNANCEOBJECTVOTE ||
+           strCommand == NetMsgType::TXLOCKVOTE ||
+           strCommand == NetMsgType::SPORK;
+}
+
+static void DeleteRecvStream(CDataStream* pvRecv)
+{
+    ReleaseRecvBuffer(*pvRecv);
+    delete pvRecv;
+}
+
+static void ProcessMessageOnWorker(CNode* pfrom, const string& strCommand, boost::shared_ptr<CDataStream> pvRecv, int64_t nTimeReceived, unsigned int nMessageSize)
+{
+    ProcessMessageChecked(pfrom, strCommand, *pvRecv, nTimeReceived, nMessageSize);
+}
+
 // requires LOCK(cs_vRecvMsg)
 bool ProcessMessages(CNode* pfrom)
 {
@@ -6863,6 +7073,10 @@ bool ProcessMessages(CNode* pfrom)
 
     std::deque<CNetMessage>::iterator it = pfrom->vRecvMsg.begin();
     while (!pfrom->fDisconnect && it != pfrom->vRecvMsg.end()) {
+        // Keep the peer's messages in order behind one on a message worker
+        if (pfrom->nMessagesInFlight > 0)
+            break;
+
         // Don't bother if send buffer is too full to respond anyway
         if (pfrom->nSendSize >= SendBufferSize())
             break;
@@ -6912,42 +7126,18 @@ bool ProcessMessages(CNode* pfrom)
             continue;
         }
 
-        // Process message
-        bool fRet = false;
-        try
-        {
-            fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
-            boost::this_thread::interruption_point();
-        }
-        catch (const std::ios_base::failure& e)
-        {
-            pfrom->PushMessage(NetMsgType::REJECT, strCommand, REJECT_MALFORMED, string("error parsing message"));
-            if (strstr(e.what(), "end of data"))
-            {
-                // Allow exceptions from under-length message on vRecv
-                LogPrintf("%s(%s, %u bytes): Exception '%s' caught, normally caused by a message being shorter than its stated length\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-            }
-            else if (strstr(e.what(), "size too large"))
-            {
-                // Allow exceptions from over-long size
-                LogPrintf("%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-            }
-            else
-            {
-                PrintExceptionContinue(&e, "ProcessMessages()");
-            }
-        }
-        catch (const boost::thread_interrupted&) {
-            throw;
-        }
-        catch (const std::exception& e) {
-            PrintExceptionContinue(&e, "ProcessMessages()");
-        } catch (...) {
-            PrintExceptionContinue(NULL, "ProcessMessages()");
+        // Masternode pings, governance votes, IX votes and sporks are
+        // checked on a message worker, which takes over the payload buffer.
+        if (pfrom->fSuccessfullyConnected && IsParallelMessage(strCommand)) {
+            boost::shared_ptr<CDataStream> pvRecv(new CDataStream(vRecv.GetType(), vRecv.GetVersion()), DeleteRecvStream);
+            std::swap(*pvRecv, vRecv);
+            if (QueueMessageWork(pfrom, boost::bind(&ProcessMessageOnWorker, pfrom, strCommand, pvRecv, msg.nTime, nMessageSize)))
+                break;
+            std::swap(*pvRecv, vRecv);
         }
 
-        if (!fRet)
-            LogPrintf("%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->id);
+        // Process message
+        ProcessMessageChecked(pfrom, strCommand, vRecv, msg.nTime, nMessageSize);
 
         break;
     }
@@ -129,6 +129,7 @@ static const bool DEFAULT_PERMIT_BAREMULTISIG = true;
 static const unsigned int DEFAULT_BYTES_PER_SIGOP = 20;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_TXINDEX = true;
+static const bool DEFAULT_TRUSTED_BLOCK_STORAGE = true;
 static const bool DEFAULT_ADDRESSINDEX = false;
 static const bool DEFAULT_TIMESTAMPINDEX = false;
 static const bool DEFAULT_SPENTINDEX = false;
@@ -165,6 +166,7 @@ extern bool fRequireStandard;
 extern unsigned int nBytesPerSigOp;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+extern bool fTrustedBlockStorage;
 extern size_t nCoinCacheUsage;
 extern CFeeRate minRelayTxFee;
 extern bool fAlerts;
@@ -250,6 +252,8 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the header proof of work checking thread */
+void ThreadHeaderCheck();
 
 /** Try to detect Partition (network isolation) attacks against us */
 void PartitionCheck(bool (*initialDownloadCheck)(), CCriticalSection& cs, const CBlockIndex *const &bestHeader, int64_t nPowTargetSpacing);
@@ -264,7 +268,7 @@ bool IsInitialBlockDownload();
  */
 std::string GetWarnings(const std::string& strFor);
 
-/** Get a cryptographic proof that a name maps to a value **/
+/** Get a cryptographic proof that a name maps to a value at a block within -claimtriehistory **/
 bool GetProofForName(const CBlockIndex* pindexProof, const std::string& name, CClaimTrieProof& proof);
 
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
@@ -766,6 +770,23 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
 /** Context-independent validity checks */
 bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool fCheckPOW = true);
+/**
+ * Number of leading headers of a headers message that can pass the checks
+ * which need no hash: the first one must connect to a known, valid block, a
+ * continuous chain never repeats a parent, and the timestamp must not be too
+ * far in the future. Requires cs_main.
+ */
+size_t CountHeadersToPrecheck(const std::vector<CBlockHeader>& headers);
+/**
+ * Hash up to nCount leading headers and check each against its own nBits,
+ * spread over the header check threads in rounds of one header per thread.
+ * Does not need cs_main. vHashes[i] receives the hash of headers[i] and
+ * vPoWValid[i] whether it meets its target; both stay zero for the headers
+ * that were not hashed. Returns the number of leading headers that each
+ * build on the one before and meet their target; hashing stops after the
+ * round in which the first other header was found.
+ */
+size_t CheckHeadersProofOfWork(const std::vector<CBlockHeader>& headers, size_t nCount, std::vector<uint256>& vHashes, std::vector<char>& vPoWValid);
 bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW = true, bool fCheckMerkleRoot = true);
 
 /** Context-dependent validity checks */
@@ -4,6 +4,7 @@
 
 #include "activemasternode.h"
 #include "addrman.h"
+#include "crypto/sha256.h"
 #include "privsend.h"
 #include "governance.h"
 #include "masternode-payments.h"
@@ -43,6 +44,8 @@ struct CompareScoreMN
     }
 };
 
+CMasternodeLookupHasher::CMasternodeLookupHasher() : salt(GetRandHash()) {}
+
 CMasternodeIndex::CMasternodeIndex()
     : nSize(0),
       mapIndex(),
@@ -169,6 +172,12 @@ CMasternodeMan::CMasternodeMan()
   fMasternodesRemoved(false),
   vecDirtyGovernanceObjectHashes(),
   nLastWatchdogVoteTime(0),
+  mapRankCache(),
+  nRankCacheUses(0),
+  mapOutpointPositions(),
+  mapPubKeyPositions(),
+  mapPayeePositions(),
+  setUnresolvedPayees(),
   mapSeenMasternodeBroadcast(),
   mapSeenMasternodePing(),
   nDsqCount(0)
@@ -193,7 +202,9 @@ bool CMasternodeMan::Add(CMasternode &mn)
             return true;
         }*/
         vMasternodes.push_back(mn);
+        IndexMasternode(vMasternodes.size() - 1);
         indexMasternodes.AddMasternodeVIN(mn.vin);
+        ClearRankCache();
         fMasternodesAdded = true;
         return true;
     }
@@ -274,6 +285,7 @@ void CMasternodeMan::CheckAndRemove()
 
         // Remove spent masternodes, prepare structures and make requests to reasure the state of inactive ones
         std::vector<CMasternode>::iterator it = vMasternodes.begin();
+        bool fRemoved = false;
         std::vector<std::pair<int, CMasternode> > vecMasternodeRanks;
         // ask for up to MNB_RECOVERY_MAX_ASK_ENTRIES masternode entries at a time
         int nAskForMnbRecovery = MNB_RECOVERY_MAX_ASK_ENTRIES;
@@ -291,6 +303,8 @@ void CMasternodeMan::CheckAndRemove()
                 // and finally remove it from the list
                 it->FlagGovernanceItemsAsDirty();
                 it = vMasternodes.erase(it);
+                ClearRankCache();
+                fRemoved = true;
                 fMasternodesRemoved = true;
             } else {
                 bool fAsk = pCurrentBlockIndex &&
@@ -329,6 +343,11 @@ void CMasternodeMan::CheckAndRemove()
             }
         }
 
+        // positions after the removed masternodes have shifted
+        if(fRemoved) {
+            RebuildLookupIndexes();
+        }
+
         // proces replies for MASTERNODE_NEW_START_REQUIRED masternodes
         LogPrint("masternode", "CMasternodeMan::CheckAndRemove -- mMnbRecoveryGoodReplies size=%d\n", (int)mMnbRecoveryGoodReplies.size());
         std::map<uint256, std::vector<CMasternodeBroadcast> >::iterator itMnbReplies = mMnbRecoveryGoodReplies.begin();
@@ -452,6 +471,8 @@ void CMasternodeMan::Clear()
 {
     LOCK(cs);
     vMasternodes.clear();
+    ClearRankCache();
+    RebuildLookupIndexes();
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
@@ -529,52 +550,97 @@ void CMasternodeMan::DsegUpdate(CNode* pnode)
     LogPrint("masternode", "CMasternodeMan::DsegUpdate -- asked %s for the list\n", pnode->addr.ToString());
 }
 
+void CMasternodeMan::IndexMasternode(size_t nPos)
+{
+    AssertLockHeld(cs);
+
+    // insert() keeps an existing entry, so the first masternode in the list wins
+    const CMasternode& mn = vMasternodes[nPos];
+    mapOutpointPositions.insert(std::make_pair(mn.vin.prevout, nPos));
+    mapPubKeyPositions.insert(std::make_pair(mn.pubKeyMasternode.GetHash(), nPos));
+    if(!IndexPayee(nPos)) {
+        setUnresolvedPayees.insert(nPos);
+    }
+}
+
+bool CMasternodeMan::IndexPayee(size_t nPos)
+{
+    const CMasternode& mn = vMasternodes[nPos];
+    if(!mn.payeeAddress.IsValid()) return false;
+
+    CScript payee = GetScriptForDestination(mn.payeeAddress.Get());
+    std::pair<hash_pos_m_t::iterator, bool> ret = mapPayeePositions.insert(std::make_pair(Hash(payee.begin(), payee.end()), nPos));
+    // payees get resolved out of list order, keep the first masternode
+    if(!ret.second && ret.first->second > nPos) {
+        ret.first->second = nPos;
+    }
+    return true;
+}
+
+void CMasternodeMan::IndexResolvedPayees()
+{
+    std::set<size_t>::iterator it = setUnresolvedPayees.begin();
+    while(it != setUnresolvedPayees.end()) {
+        if(IndexPayee(*it)) {
+            setUnresolvedPayees.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CMasternodeMan::RebuildLookupIndexes()
+{
+    AssertLockHeld(cs);
+
+    mapOutpointPositions.clear();
+    mapPubKeyPositions.clear();
+    mapPayeePositions.clear();
+    setUnresolvedPayees.clear();
+    for(size_t i = 0; i < vMasternodes.size(); ++i) {
+        IndexMasternode(i);
+    }
+}
+
 CMasternode* CMasternodeMan::Find(const CScript &payee)
 {
     LOCK(cs);
 
-    BOOST_FOREACH(CMasternode& mn, vMasternodes)
-    {
+    IndexResolvedPayees();
+
+    hash_pos_m_t::iterator it = mapPayeePositions.find(Hash(payee.begin(), payee.end()));
+    size_t nPos = it == mapPayeePositions.end() ? vMasternodes.size() : it->second;
+
+    // masternodes before it with an unknown payee might match too, look them up like a scan would
+    std::set<size_t>::iterator itUnresolved = setUnresolvedPayees.begin();
+    for(; itUnresolved != setUnresolvedPayees.end() && *itUnresolved < nPos; ++itUnresolved) {
+        CMasternode& mn = vMasternodes[*itUnresolved];
         if(GetScriptForDestination(mn.GetPayeeDestination()) == payee)
             return &mn;
     }
-    return NULL;
+
+    return nPos < vMasternodes.size() ? &vMasternodes[nPos] : NULL;
 }
 
 CMasternode* CMasternodeMan::Find(const CTxIn &vin)
 {
-    LOCK(cs);
-
-    BOOST_FOREACH(CMasternode& mn, vMasternodes)
-    {
-        if(mn.vin.prevout == vin.prevout)
-            return &mn;
-    }
-    return NULL;
+    return Find(vin.prevout);
 }
 
 CMasternode* CMasternodeMan::Find(const COutPoint& outpoint)
 {
-	LOCK(cs);
-	BOOST_FOREACH(CMasternode& mn, vMasternodes)
-	{
-		if(mn.vin.prevout == outpoint)
-			return &mn;
-	}
-	return NULL;
-}
+    LOCK(cs);
 
+    outpoint_pos_m_t::iterator it = mapOutpointPositions.find(outpoint);
+    return it == mapOutpointPositions.end() ? NULL : &vMasternodes[it->second];
+}
 
 CMasternode* CMasternodeMan::Find(const CPubKey &pubKeyMasternode)
 {
     LOCK(cs);
 
-    BOOST_FOREACH(CMasternode& mn, vMasternodes)
-    {
-        if(mn.pubKeyMasternode == pubKeyMasternode)
-            return &mn;
-    }
-    return NULL;
+    hash_pos_m_t::iterator it = mapPubKeyPositions.find(pubKeyMasternode.GetHash());
+    return it == mapPubKeyPositions.end() ? NULL : &vMasternodes[it->second];
 }
 
 bool CMasternodeMan::Get(const CPubKey& pubKeyMasternode, CMasternode& masternode)
@@ -785,36 +851,114 @@ CMasternode* CMasternodeMan::FindRandomNotInVec(const std::vector<CTxIn> &vecToE
     return NULL;
 }
 
-int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
+/**
+ * Same as CMasternode::CalculateScore(blockHash).GetCompact(false) for each of vecMasternodes.
+ * Hash(blockHash) is only computed once and the Hash(blockHash, aux) of every masternode is
+ * a double-SHA256 of 64 bytes, so they are all done in one SHA256D64 batch.
+ */
+static void CalculateScores(const std::vector<CMasternode*>& vecMasternodes, const uint256& blockHash, std::vector<int64_t>& vecScoresRet)
 {
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << blockHash;
+    arith_uint256 hash2 = UintToArith256(ss.GetHash());
+
+    std::vector<unsigned char> vchData(vecMasternodes.size() * 64);
+    for(size_t i = 0; i < vecMasternodes.size(); i++) {
+        const COutPoint& outpoint = vecMasternodes[i]->vin.prevout;
+        uint256 aux = ArithToUint256(UintToArith256(outpoint.hash) + outpoint.n);
+        memcpy(&vchData[i * 64], blockHash.begin(), 32);
+        memcpy(&vchData[i * 64 + 32], aux.begin(), 32);
+    }
+    if(!vecMasternodes.empty()) {
+        SHA256D64(&vchData[0], &vchData[0], vecMasternodes.size());
+    }
+
+    vecScoresRet.resize(vecMasternodes.size());
+    for(size_t i = 0; i < vecMasternodes.size(); i++) {
+        uint256 hash;
+        memcpy(hash.begin(), &vchData[i * 32], 32);
+        arith_uint256 hash3 = UintToArith256(hash);
+        arith_uint256 nScore = (hash3 > hash2 ? hash3 - hash2 : hash2 - hash3);
+        vecScoresRet[i] = nScore.GetCompact(false);
+    }
+}
+
+const CMasternodeMan::rank_cache_t& CMasternodeMan::GetRankCache(const uint256& blockHash)
+{
+    AssertLockHeld(cs);
+
+    std::map<uint256, rank_cache_t>::iterator it = mapRankCache.find(blockHash);
+    if(it != mapRankCache.end()) {
+        it->second.nLastUsed = ++nRankCacheUses;
+        return it->second;
+    }
+
+    if((int)mapRankCache.size() >= MAX_RANK_CACHE_SIZE) {
+        // drop the least recently used ranking
+        std::map<uint256, rank_cache_t>::iterator itOldest = mapRankCache.begin();
+        for(it = mapRankCache.begin(); it != mapRankCache.end(); ++it) {
+            if(it->second.nLastUsed < itOldest->second.nLastUsed) itOldest = it;
+        }
+        mapRankCache.erase(itOldest);
+    }
+
+    std::vector<CMasternode*> vecMasternodesAll;
+    vecMasternodesAll.reserve(vMasternodes.size());
+    BOOST_FOREACH(CMasternode& mn, vMasternodes) {
+        vecMasternodesAll.push_back(&mn);
+    }
+    std::vector<int64_t> vecScores;
+    CalculateScores(vecMasternodesAll, blockHash, vecScores);
+
     std::vector<std::pair<int64_t, CMasternode*> > vecMasternodeScores;
+    vecMasternodeScores.reserve(vecMasternodesAll.size());
+    for(size_t i = 0; i < vecMasternodesAll.size(); i++) {
+        vecMasternodeScores.push_back(std::make_pair(vecScores[i], vecMasternodesAll[i]));
+    }
+
+    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
+
+    rank_cache_t& cache = mapRankCache[blockHash];
+    cache.vecSorted.reserve(vecMasternodeScores.size());
+    BOOST_FOREACH (PAIRTYPE(int64_t, CMasternode*)& s, vecMasternodeScores) {
+        // keep the first (best scored) entry for an outpoint, like the old linear scan did
+        cache.mapPosition.insert(std::make_pair(s.second->vin.prevout, (int)cache.vecSorted.size()));
+        cache.vecSorted.push_back(s.second);
+    }
+    cache.nLastUsed = ++nRankCacheUses;
+
+    return cache;
+}
+
+// The rankings below filter the cached order of all masternodes. Scores don't depend on
+// masternode state, so the eligible ones keep their relative order and are ranked exactly
+// as if they had been scored and sorted on their own.
 
+int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
+{
     //make sure we know about this block
     uint256 blockHash = uint256();
     if(!GetBlockHash(blockHash, nBlockHeight)) return -1;
 
     LOCK(cs);
 
-    // scan for winner
-    BOOST_FOREACH(CMasternode& mn, vMasternodes) {
-        if(mn.nProtocolVersion < nMinProtocol) continue;
+    const rank_cache_t& cache = GetRankCache(blockHash);
+    std::map<COutPoint, int>::const_iterator it = cache.mapPosition.find(vin.prevout);
+    if(it == cache.mapPosition.end()) return -1;
+
+    // count the eligible masternodes up to and including this one
+    int nRank = 0;
+    for(int i = 0; i <= it->second; i++) {
+        CMasternode* pmn = cache.vecSorted[i];
+        if(pmn->nProtocolVersion < nMinProtocol) continue;
         if(fOnlyActive) {
-            if(!mn.IsEnabled()) continue;
+            if(!pmn->IsEnabled()) continue;
         }
         else {
-            if(!mn.IsValidForPayment()) continue;
+            if(!pmn->IsValidForPayment()) continue;
         }
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
-
-        vecMasternodeScores.push_back(std::make_pair(nScore, &mn));
-    }
-
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
-
-    int nRank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CMasternode*)& scorePair, vecMasternodeScores) {
         nRank++;
-        if(scorePair.second->vin.prevout == vin.prevout) return nRank;
+        if(i == it->second) return nRank;
     }
 
     return -1;
@@ -822,7 +966,6 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int nBlockHeight, int nM
 
 std::vector<std::pair<int, CMasternode> > CMasternodeMan::GetMasternodeRanks(int nBlockHeight, int nMinProtocol)
 {
-    std::vector<std::pair<int64_t, CMasternode*> > vecMasternodeScores;
     std::vector<std::pair<int, CMasternode> > vecMasternodeRanks;
 
     //make sure we know about this block
@@ -831,22 +974,13 @@ std::vector<std::pair<int, CMasternode> > CMasternodeMan::GetMasternodeRanks(int
 
     LOCK(cs);
 
-    // scan for winner
-    BOOST_FOREACH(CMasternode& mn, vMasternodes) {
-
-        if(mn.nProtocolVersion < nMinProtocol || !mn.IsEnabled()) continue;
-
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
-
-        vecMasternodeScores.push_back(std::make_pair(nScore, &mn));
-    }
-
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
+    const rank_cache_t& cache = GetRankCache(blockHash);
 
     int nRank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CMasternode*)& s, vecMasternodeScores) {
+    BOOST_FOREACH(CMasternode* pmn, cache.vecSorted) {
+        if(pmn->nProtocolVersion < nMinProtocol || !pmn->IsEnabled()) continue;
         nRank++;
-        vecMasternodeRanks.push_back(std::make_pair(nRank, *s.second));
+        vecMasternodeRanks.push_back(std::make_pair(nRank, *pmn));
     }
 
     return vecMasternodeRanks;
@@ -854,8 +988,6 @@ std::vector<std::pair<int, CMasternode> > CMasternodeMan::GetMasternodeRanks(int
 
 CMasternode* CMasternodeMan::GetMasternodeByRank(int nRank, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
 {
-    std::vector<std::pair<int64_t, CMasternode*> > vecMasternodeScores;
-
     LOCK(cs);
 
     uint256 blockHash;
@@ -864,24 +996,15 @@ CMasternode* CMasternodeMan::GetMasternodeByRank(int nRank, int nBlockHeight, in
         return NULL;
     }
 
-    // Fill scores
-    BOOST_FOREACH(CMasternode& mn, vMasternodes) {
-
-        if(mn.nProtocolVersion < nMinProtocol) continue;
-        if(fOnlyActive && !mn.IsEnabled()) continue;
-
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
-
-        vecMasternodeScores.push_back(std::make_pair(nScore, &mn));
-    }
-
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
+    const rank_cache_t& cache = GetRankCache(blockHash);
 
     int rank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CMasternode*)& s, vecMasternodeScores){
+    BOOST_FOREACH(CMasternode* pmn, cache.vecSorted) {
+        if(pmn->nProtocolVersion < nMinProtocol) continue;
+        if(fOnlyActive && !pmn->IsEnabled()) continue;
         rank++;
         if(rank == nRank) {
-            return s.second;
+            return pmn;
         }
     }
 
@@ -970,13 +1093,22 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
 
         uint256 nHash = mnp.GetHash();
 
-        pfrom->setAskFor.erase(nHash);
-
         LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s\n", mnp.vin.prevout.ToStringShort());
 
+        // Pings may arrive on a message worker: check the signature before
+        // taking cs_main so that CheckAndUpdate below finds it verified in
+        // privSendSigner's cache.
+        masternode_info_t infoMn = GetMasternodeInfo(mnp.vin);
+        if(infoMn.fInfoValid) {
+            int nDosIgnored = 0;
+            mnp.CheckSignature(infoMn.pubKeyMasternode, nDosIgnored);
+        }
+
         // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
         LOCK2(cs_main, cs);
 
+        pfrom->setAskFor.erase(nHash);
+
         if(mapSeenMasternodePing.count(nHash)) return; //seen
         mapSeenMasternodePing.insert(std::make_pair(nHash, mnp));
 
@@ -1518,7 +1650,12 @@ void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast mnb)
         }
     } else {
         CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
-        if(pmn->UpdateFromNewBroadcast(mnb)) {
+        CPubKey pubKeyMasternodeOld = pmn->pubKeyMasternode;
+        bool fUpdated = pmn->UpdateFromNewBroadcast(mnb);
+        if(pmn->pubKeyMasternode != pubKeyMasternodeOld) {
+            RebuildLookupIndexes();
+        }
+        if(fUpdated) {
             masternodeSync.AddedMasternodeList();
             mapSeenMasternodeBroadcast.erase(mnbOld.GetHash());
         }
@@ -1583,7 +1720,13 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
     CMasternode* pmn = Find(mnb.vin);
     if(pmn) {
         CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
-        if(!mnb.Update(pmn, nDos)) {
+        CPubKey pubKeyMasternodeOld = pmn->pubKeyMasternode;
+        bool fUpdated = mnb.Update(pmn, nDos);
+        if(pmn->pubKeyMasternode != pubKeyMasternodeOld) {
+            // the operator switched keys, the key index has to be redone
+            RebuildLookupIndexes();
+        }
+        if(!fUpdated) {
             LogPrint("masternode", "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- Update() failed, masternode=%s\n", mnb.vin.prevout.ToStringShort());
             return false;
         }
@@ -2020,11 +2163,6 @@ bool CMasternodeCenter::RequestLicense(CMasternode &mn)
     bool proxyConnectionFailed = false;
     SOCKET hSocket;
     if(ConnectSocket(service_, hSocket, DEFAULT_CONNECT_TIMEOUT, &proxyConnectionFailed)) {
-        if (!IsSelectableSocket(hSocket)) {
-            CloseSocket(hSocket);
-            return error("CMasternodeCenter::RequestLicense:Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)");
-        }
-
         int nBytes = send(hSocket, cbuf, buflength, 0);
         if(nBytes != buflength) {
             CloseSocket(hSocket);
@@ -2126,11 +2264,6 @@ bool CMasternodeCenter::RequestCenterKey()
     bool proxyConnectionFailed = false;
     SOCKET hSocket;
     if(ConnectSocket(service_, hSocket, DEFAULT_CONNECT_TIMEOUT, &proxyConnectionFailed)) {
-        if (!IsSelectableSocket(hSocket)) {
-            CloseSocket(hSocket);
-            return error("CMasternodeCenter::RequestCenterKey:Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)");
-        }
-
         int nBytes = send(hSocket, cbuf, buflength, 0);
         if(nBytes != buflength) {
             CloseSocket(hSocket);
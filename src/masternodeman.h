@@ -10,6 +10,7 @@
 
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
+#include <boost/unordered_map.hpp>
 
 
 using namespace std;
@@ -85,6 +86,26 @@ private:
 
 };
 
+/**
+ * Salted hasher for the CMasternodeMan lookup indexes, whose keys come from the network
+ */
+class CMasternodeLookupHasher
+{
+private:
+    uint256 salt;
+
+public:
+    CMasternodeLookupHasher();
+
+    size_t operator()(const COutPoint& outpoint) const {
+        return outpoint.hash.GetHash(salt) ^ outpoint.n;
+    }
+
+    size_t operator()(const uint256& hash) const {
+        return hash.GetHash(salt);
+    }
+};
+
 class CMasternodeMan
 {
 public:
@@ -158,8 +179,47 @@ private:
 
     int64_t nLastWatchdogVoteTime;
 
+    /// Number of block hashes to keep masternode rankings for
+    static const int MAX_RANK_CACHE_SIZE        = 64;
+
+    // Every masternode ordered by score for a block hash, best first, and the position of each
+    // collateral in that order. Entries point into vMasternodes and are dropped whenever it changes.
+    struct rank_cache_t {
+        std::vector<CMasternode*> vecSorted;
+        std::map<COutPoint, int> mapPosition;
+        int64_t nLastUsed;
+    };
+    std::map<uint256, rank_cache_t> mapRankCache;
+    int64_t nRankCacheUses;
+
+    typedef boost::unordered_map<COutPoint, size_t, CMasternodeLookupHasher> outpoint_pos_m_t;
+    typedef boost::unordered_map<uint256, size_t, CMasternodeLookupHasher> hash_pos_m_t;
+
+    // Positions in vMasternodes by collateral outpoint, by hash of the masternode key and by hash
+    // of the payee script, so Find() doesn't scan the list. Each points at the first masternode
+    // in the list with that key, like the scan did. Positions stay valid when the vector grows;
+    // the maps are rebuilt when masternodes are removed, change keys or are read from disk.
+    outpoint_pos_m_t mapOutpointPositions;
+    hash_pos_m_t mapPubKeyPositions;
+    hash_pos_m_t mapPayeePositions;
+    // Masternodes whose payee isn't known yet (collateral transaction not found)
+    std::set<size_t> setUnresolvedPayees;
+
     friend class CMasternodeSync;
 
+    /// Get (or build) the ranking for blockHash, cs must be held
+    const rank_cache_t& GetRankCache(const uint256& blockHash);
+    void ClearRankCache() { mapRankCache.clear(); }
+
+    /// Add vMasternodes[nPos] to the lookup indexes, cs must be held
+    void IndexMasternode(size_t nPos);
+    /// Add vMasternodes[nPos] to mapPayeePositions if its payee is known
+    bool IndexPayee(size_t nPos);
+    /// Index the payees that were resolved since the masternodes were added
+    void IndexResolvedPayees();
+    /// Recreate the lookup indexes from vMasternodes, cs must be held
+    void RebuildLookupIndexes();
+
 public:
     // Keep track of all broadcasts I've seen
     std::map<uint256, std::pair<int64_t, CMasternodeBroadcast> > mapSeenMasternodeBroadcast;
@@ -197,6 +257,10 @@ public:
         READWRITE(mapSeenMasternodeBroadcast);
         READWRITE(mapSeenMasternodePing);
         READWRITE(indexMasternodes);
+        if(ser_action.ForRead()) {
+            ClearRankCache();
+            RebuildLookupIndexes();
+        }
         if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
         }
@@ -214,6 +278,7 @@ public:
     ///for test
     void SetRegisteredCheckInterval(int time);
     bool PoSeBan(const COutPoint &outpoint);
+    size_t RankCacheSize() { LOCK(cs); return mapRankCache.size(); }
     /// Check all Masternodes
     void Check();
 
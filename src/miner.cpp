@@ -54,6 +54,42 @@ using namespace std;
 uint64_t nLastBlockTx = 0;
 uint64_t nLastBlockSize = 0;
 
+// Hash meter of the internal miner
+static CCriticalSection cs_hashmeter;
+static double dHashesPerSec = 0.0;
+static int64_t nHPSTimerStart = 0;
+static uint64_t nHashCounter = 0;
+
+static void UpdateHashesPerSec(uint64_t nHashesDone)
+{
+    LOCK(cs_hashmeter);
+    int64_t nNow = GetTimeMillis();
+    if (nHPSTimerStart == 0) {
+        nHPSTimerStart = nNow;
+        nHashCounter = 0;
+    }
+    nHashCounter += nHashesDone;
+    if (nNow - nHPSTimerStart > 4000) {
+        dHashesPerSec = 1000.0 * nHashCounter / (nNow - nHPSTimerStart);
+        nHPSTimerStart = nNow;
+        nHashCounter = 0;
+    }
+}
+
+static void ResetHashesPerSec()
+{
+    LOCK(cs_hashmeter);
+    dHashesPerSec = 0.0;
+    nHPSTimerStart = 0;
+    nHashCounter = 0;
+}
+
+double GetHashesPerSec()
+{
+    LOCK(cs_hashmeter);
+    return dHashesPerSec;
+}
+
 class ScoreCompare
 {
 public:
@@ -586,34 +622,41 @@ void static BitcoinMiner(const CChainParams& chainparams)
             //
             int64_t nStart = GetTime();
             arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
+            helloContext* helloCtx = helloGetThreadContext();
             while (true)
             {
+                // Hash the nonces up to the next multiple of 256 as one batch.
+                // The header is serialized once and only the nonce is patched.
+                CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
+                ssHeader << pblock->GetBlockHeader();
+                assert(ssHeader.size() == INPUT_LEN);
+                uint32_t nCount = 0x100 - (UintToArith256(pblock->nNonce).GetLow64() & 0xFF);
+                uint256 target = ArithToUint256(hashTarget);
                 uint256 hash;
-                while (true) 
-		        { 
-		            hash = pblock->GetHash();
-                    if (UintToArith256(hash) <= hashTarget)
-                    {
-                        // Found a solution
-                        SetThreadPriority(THREAD_PRIORITY_NORMAL);
-                        LogPrintf("UlordMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
-                        ProcessBlockFound(pblock, chainparams);
-                        SetThreadPriority(THREAD_PRIORITY_LOWEST);
-                        coinbaseScript->KeepScript();
-
-                        // In regression test mode, stop mining after a block is found. This
-                        // allows developers to controllably generate a block on demand.
-                        if (chainparams.MineBlocksOnDemand())
-                            throw boost::thread_interrupted();
+                uint32_t nOffset = 0;
+                bool fFound = helloScanNonces(helloCtx, (const uint8_t*)&ssHeader[0], nCount,
+                                              target.begin(), &nOffset, hash.begin());
+                UpdateHashesPerSec(fFound ? nOffset + 1 : nCount);
 
-                        break;
-                    }
-                    pblock->nNonce = ArithToUint256(UintToArith256(pblock->nNonce) + 1);
-                    if ((UintToArith256(pblock->nNonce) & 0xFF) == 0)
-		            {
-			            //LogPrintf("UlordMiner: %d   nExtraNonce: %d\n", pblock->nNonce, nExtraNonce);    
-		                break;
-                    }
+                if (fFound)
+                {
+                    // Found a solution
+                    pblock->nNonce = ArithToUint256(UintToArith256(pblock->nNonce) + nOffset);
+                    assert(hash == pblock->GetHash());
+                    SetThreadPriority(THREAD_PRIORITY_NORMAL);
+                    LogPrintf("UlordMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
+                    ProcessBlockFound(pblock, chainparams);
+                    SetThreadPriority(THREAD_PRIORITY_LOWEST);
+                    coinbaseScript->KeepScript();
+
+                    // In regression test mode, stop mining after a block is found. This
+                    // allows developers to controllably generate a block on demand.
+                    if (chainparams.MineBlocksOnDemand())
+                        throw boost::thread_interrupted();
+                }
+                else
+                {
+                    pblock->nNonce = ArithToUint256(UintToArith256(pblock->nNonce) + nCount);
                 }
 
                 // Check for stop or if block needs to be rebuilt
@@ -665,6 +708,7 @@ void GenerateBitcoins(bool fGenerate, int nThreads, const CChainParams& chainpar
         delete minerThreads;
         minerThreads = NULL;
     }
+    ResetHashesPerSec();
 
     if (nThreads == 0 || !fGenerate)
         return;
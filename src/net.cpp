@@ -18,6 +18,7 @@
 #include "hash.h"
 #include "primitives/transaction.h"
 #include "scheduler.h"
+#include "socketevents.h"
 #include "ui_interface.h"
 #include "wallet/wallet.h"
 #include "utilstrencodings.h"
@@ -40,6 +41,7 @@
 #endif
 
 #include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/thread.hpp>
 
 #include <math.h>
@@ -71,11 +73,15 @@ namespace {
     const int MAX_OUTBOUND_CONNECTIONS = 8;
     const int MAX_OUTBOUND_MASTERNODE_CONNECTIONS = 20;
 
+    const int MAX_ACCEPT_PER_LOOP = 64;
+
     struct ListenSocket {
         SOCKET socket;
         bool whitelisted;
+        int nSocketEvents;
+        int nSocketReady;
 
-        ListenSocket(SOCKET socket, bool whitelisted) : socket(socket), whitelisted(whitelisted) {}
+        ListenSocket(SOCKET socket, bool whitelisted) : socket(socket), whitelisted(whitelisted), nSocketEvents(-1), nSocketReady(0) {}
     };
 }
 
@@ -93,6 +99,7 @@ uint64_t nLocalHostNonce = 0;
 static std::vector<ListenSocket> vhListenSocket;
 CAddrMan addrman;
 int nMaxConnections = DEFAULT_MAX_PEER_CONNECTIONS;
+bool fSocketEventsUnlimited = false;
 bool fAddressesInitialized = false;
 std::string strSubVersion;
 
@@ -119,6 +126,17 @@ static CSemaphore *semOutbound = NULL;
 static CSemaphore *semMasternodeOutbound = NULL;
 boost::condition_variable messageHandlerCondition;
 
+// Payload buffers of finished messages, see GetRecvBuffer()
+static CCriticalSection cs_recvBufferPool;
+static std::vector<CSerializeData> vRecvBufferPool;
+static size_t nRecvBufferPoolBytes = 0;
+
+// Work for the message worker threads, see QueueMessageWork()
+static boost::mutex cs_messageWork;
+static boost::condition_variable condMessageWork;
+static std::deque<std::pair<CNode*, boost::function<void()> > > queueMessageWork;
+static int nMessageWorkers = 0;
+
 // Signals for message handling
 static CNodeSignals g_signals;
 CNodeSignals& GetNodeSignals() { return g_signals; }
@@ -421,7 +439,7 @@ CNode* ConnectNode(CAddress addrConnect, const char *pszDest, bool fConnectToMas
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed))
     {
-        if (!IsSelectableSocket(hSocket)) {
+        if (!fSocketEventsUnlimited && !IsSelectableSocket(hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return NULL;
@@ -709,6 +727,47 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
     return true;
 }
 
+void GetRecvBuffer(CDataStream& stream, size_t nSize)
+{
+    assert(stream.empty());
+    CSerializeData vch;
+    {
+        LOCK(cs_recvBufferPool);
+        // the smallest buffer that is big enough
+        size_t nBest = vRecvBufferPool.size();
+        for (size_t i = 0; i < vRecvBufferPool.size(); i++) {
+            size_t nCapacity = vRecvBufferPool[i].capacity();
+            if (nCapacity >= nSize && (nBest == vRecvBufferPool.size() || nCapacity < vRecvBufferPool[nBest].capacity()))
+                nBest = i;
+        }
+        if (nBest == vRecvBufferPool.size())
+            return;
+        nRecvBufferPoolBytes -= vRecvBufferPool[nBest].capacity();
+        vch.swap(vRecvBufferPool[nBest]);
+        vRecvBufferPool[nBest].swap(vRecvBufferPool.back());
+        vRecvBufferPool.pop_back();
+    }
+    stream.SwapBuffer(vch);
+}
+
+void ReleaseRecvBuffer(CDataStream& stream)
+{
+    CSerializeData vch;
+    stream.SwapBuffer(vch);
+    if (vch.capacity() == 0)
+        return;
+    vch.clear();
+
+    LOCK(cs_recvBufferPool);
+    if (vRecvBufferPool.size() < MAX_RECV_BUFFER_POOL_SIZE &&
+        nRecvBufferPoolBytes + vch.capacity() <= MAX_RECV_BUFFER_POOL_BYTES) {
+        nRecvBufferPoolBytes += vch.capacity();
+        vRecvBufferPool.push_back(CSerializeData());
+        vRecvBufferPool.back().swap(vch);
+    }
+    // otherwise vch is freed (and zeroed) as usual
+}
+
 int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
@@ -724,7 +783,8 @@ int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 
     // deserialize to CMessageHeader
     try {
-        hdrbuf >> hdr;
+        CStreamView hdrview(hdrbuf, hdrbuf + nHdrPos, vRecv.nType, vRecv.nVersion);
+        hdrview >> hdr;
     }
     catch (const std::exception&) {
         return -1;
@@ -734,6 +794,10 @@ int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
     if (hdr.nMessageSize > MAX_SIZE)
             return -1;
 
+    // reuse a buffer that fits the whole message, if there is one
+    if (hdr.nMessageSize > 0)
+        GetRecvBuffer(vRecv, hdr.nMessageSize);
+
     // switch state to reading message data
     in_data = true;
 
@@ -745,12 +809,14 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
     unsigned int nRemaining = hdr.nMessageSize - nDataPos;
     unsigned int nCopy = std::min(nRemaining, nBytes);
 
-    if (vRecv.size() < nDataPos + nCopy) {
-        // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
-    }
+    // Grow the buffer geometrically, but never past the total message size.
+    // Nothing happens if the buffer from the pool is big enough already.
+    size_t nNeeded = nDataPos + nCopy;
+    if (nNeeded > vRecv.capacity())
+        vRecv.reserve(std::min<size_t>(hdr.nMessageSize, std::max<size_t>(2 * vRecv.capacity(), nNeeded)));
 
-    memcpy(&vRecv[nDataPos], pch, nCopy);
+    // append without zero-filling first, unlike resize()
+    vRecv.write(pch, nCopy);
     nDataPos += nCopy;
 
     return nCopy;
@@ -964,7 +1030,11 @@ static bool AttemptToEvictConnection(bool fPreferNewConnection) {
     return true;
 }
 
-static void AcceptConnection(const ListenSocket& hListenSocket) {
+/**
+ * Accept one connection. Returns false if none was accepted, setting fFailed
+ * if accept() failed for another reason than no connection waiting.
+ */
+static bool AcceptConnection(const ListenSocket& hListenSocket, const CSocketEvents& socketEvents, bool& fFailed) {
     struct sockaddr_storage sockaddr;
     socklen_t len = sizeof(sockaddr);
     SOCKET hSocket = accept(hListenSocket.socket, (struct sockaddr*)&sockaddr, &len);
@@ -987,16 +1057,17 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
     if (hSocket == INVALID_SOCKET)
     {
         int nErr = WSAGetLastError();
-        if (nErr != WSAEWOULDBLOCK)
+        fFailed = nErr != WSAEWOULDBLOCK && nErr != WSAEAGAIN;
+        if (fFailed)
             LogPrintf("socket error accept failed: %s\n", NetworkErrorString(nErr));
-        return;
+        return false;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (!socketEvents.IsWatchable(hSocket))
     {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
-        return;
+        return true;
     }
 
     // According to the internet TCP_NODELAY is not carried into accepted sockets
@@ -1012,7 +1083,7 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
     {
         LogPrintf("connection from %s dropped (banned)\n", addr.ToString());
         CloseSocket(hSocket);
-        return;
+        return true;
     }
 
     if (nInbound >= nMaxInbound)
@@ -1021,7 +1092,7 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
             // No connection to evict, disconnect the new connection
             LogPrint("net", "failed to find an eviction candidate - connection dropped (full)\n");
             CloseSocket(hSocket);
-            return;
+            return true;
         }
     }
 
@@ -1034,13 +1105,115 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
+    return true;
+}
+
+/** Whether pnode's receive buffer has room for more data. Requires cs_vRecvMsg. */
+static bool CanReceive(CNode* pnode)
+{
+    return pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
+           pnode->GetTotalRecvSize() <= ReceiveFloodSize();
+}
+
+/** The events ThreadSocketHandler waits for on pnode's socket. */
+static int GetSocketEventsWanted(CNode* pnode, bool fEdgeTriggered)
+{
+    // Implement the following logic:
+    // * If there is data to send, select() for sending data. As this only
+    //   happens when optimistic write failed, we choose to first drain the
+    //   write buffer in this case before receiving more. This avoids
+    //   needlessly queueing received data, if the remote peer is not themselves
+    //   receiving data. This means properly utilizing TCP flow control signalling.
+    // * Otherwise, if there is no (complete) message in the receive buffer,
+    //   or there is space left in the buffer, select() for receiving data.
+    // * (if neither of the above applies, there is certainly one message
+    //   in the receiver buffer ready to be processed).
+    // Together, that means that at least one of the following is always possible,
+    // so we don't deadlock:
+    // * We send some data.
+    // * We wait for data to be received (and disconnect after timeout).
+    // * We process a message in the buffer (message handler thread).
+    //
+    // An edge-triggered backend stays registered for receiving, since it
+    // only reports new data once; the same rules are applied when servicing
+    // the socket instead. Write interest is only re-armed while vSendMsg is
+    // non-empty.
+    int nEvents = SOCKET_EVENT_ERR;
+    {
+        TRY_LOCK(pnode->cs_vSend, lockSend);
+        if (lockSend) {
+            if (!pnode->vSendMsg.empty())
+                nEvents |= SOCKET_EVENT_SEND;
+        } else if (fEdgeTriggered && pnode->nSocketEvents > 0) {
+            // keep what we had rather than wait on the lock
+            nEvents |= pnode->nSocketEvents & SOCKET_EVENT_SEND;
+        }
+    }
+    if (fEdgeTriggered)
+        return nEvents | SOCKET_EVENT_RECV;
+    if (nEvents & SOCKET_EVENT_SEND)
+        return nEvents;
+    {
+        TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+        if (lockRecv && CanReceive(pnode))
+            nEvents |= SOCKET_EVENT_RECV;
+    }
+    return nEvents;
+}
+
+/** Readiness of s reported by the last wait, plus what is still pending from before. */
+static int GetSocketReady(const std::map<SOCKET, int>& mapReady, SOCKET s, int nPending)
+{
+    std::map<SOCKET, int>::const_iterator it = mapReady.find(s);
+    return it == mapReady.end() ? nPending : (nPending | it->second);
+}
+
+static CCriticalSection cs_socketEventsStats;
+static CSocketEventsStats socketEventsStats;
+
+CSocketEventsStats GetSocketEventsStats()
+{
+    LOCK(cs_socketEventsStats);
+    return socketEventsStats;
 }
 
 void ThreadSocketHandler()
 {
+    std::string strSocketEvents = GetArg("-socketevents", DEFAULT_SOCKET_EVENTS);
+    boost::scoped_ptr<CSocketEvents> socketEvents(CreateSocketEvents(strSocketEvents));
+    if (!socketEvents) {
+        LogPrintf("ThreadSocketHandler -- socket events backend %s is not available, using select\n", strSocketEvents);
+        socketEvents.reset(CreateSocketEvents("select"));
+        fSocketEventsUnlimited = false;
+    }
+    const bool fEdgeTriggered = socketEvents->IsEdgeTriggered();
+    LogPrintf("ThreadSocketHandler -- using %s\n", socketEvents->GetName());
+
+    // nothing is registered with a new backend yet
+    BOOST_FOREACH(ListenSocket& hListenSocket, vhListenSocket) {
+        hListenSocket.nSocketEvents = -1;
+        hListenSocket.nSocketReady = 0;
+    }
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodes) {
+            pnode->nSocketEvents = -1;
+            pnode->nSocketReady = 0;
+        }
+    }
+    {
+        LOCK(cs_socketEventsStats);
+        socketEventsStats = CSocketEventsStats();
+        socketEventsStats.strBackend = socketEvents->GetName();
+    }
+
     unsigned int nPrevNodeCount = 0;
+    bool fMoreToRead = false;
+    std::vector<std::pair<SOCKET, int> > vReady;
     while (true)
     {
+        int64_t nLoopStart = GetTimeMicros();
+
         //
         // Disconnect nodes
         //
@@ -1111,25 +1284,11 @@ void ThreadSocketHandler()
         }
 
         //
-        // Find which sockets have data to receive
+        // Tell the backend which sockets to wait on
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
+        BOOST_FOREACH(ListenSocket& hListenSocket, vhListenSocket) {
+            socketEvents->Watch(hListenSocket.socket, SOCKET_EVENT_RECV, hListenSocket.nSocketEvents);
+            hListenSocket.nSocketEvents = SOCKET_EVENT_RECV;
         }
 
         {
@@ -1138,69 +1297,52 @@ void ThreadSocketHandler()
             {
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is no (complete) message in the receive buffer,
-                //   or there is space left in the buffer, select() for receiving data.
-                // * (if neither of the above applies, there is certainly one message
-                //   in the receiver buffer ready to be processed).
-                // Together, that means that at least one of the following is always possible,
-                // so we don't deadlock:
-                // * We send some data.
-                // * We wait for data to be received (and disconnect after timeout).
-                // * We process a message in the buffer (message handler thread).
-                {
-                    TRY_LOCK(pnode->cs_vSend, lockSend);
-                    if (lockSend && !pnode->vSendMsg.empty()) {
-                        FD_SET(pnode->hSocket, &fdsetSend);
-                        continue;
-                    }
-                }
-                {
-                    TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                    if (lockRecv && (
-                        pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
-                        pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
-                        FD_SET(pnode->hSocket, &fdsetRecv);
-                }
+                int nEvents = GetSocketEventsWanted(pnode, fEdgeTriggered);
+                socketEvents->Watch(pnode->hSocket, nEvents, pnode->nSocketEvents);
+                pnode->nSocketEvents = nEvents;
             }
         }
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        // With data left in a socket after the last recv() an edge-triggered
+        // backend won't report it again, so only poll.
+        int64_t nWaitStart = GetTimeMicros();
+        vReady.clear();
+        socketEvents->Wait(fMoreToRead ? 0 : 50, vReady); // 50ms: frequency to poll pnode->vSend
         boost::this_thread::interruption_point();
+        int64_t nWaitEnd = GetTimeMicros();
+        fMoreToRead = false;
 
-        if (nSelect == SOCKET_ERROR)
-        {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            MilliSleep(timeout.tv_usec/1000);
-        }
+        std::map<SOCKET, int> mapReady;
+        for (size_t i = 0; i < vReady.size(); i++)
+            mapReady[vReady[i].first] |= vReady[i].second;
 
         //
         // Accept new connections
         //
-        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+        BOOST_FOREACH(ListenSocket& hListenSocket, vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
-            {
-                AcceptConnection(hListenSocket);
+            if (hListenSocket.socket == INVALID_SOCKET)
+                continue;
+            int nReady = GetSocketReady(mapReady, hListenSocket.socket, fEdgeTriggered ? hListenSocket.nSocketReady : 0);
+            if (nReady == 0)
+                continue;
+            bool fFailed = false;
+            if (!fEdgeTriggered) {
+                AcceptConnection(hListenSocket, *socketEvents, fFailed);
+                continue;
             }
+            // an edge-triggered backend reports a listening socket once however many connections are waiting
+            int nAccepted = 0;
+            while (nAccepted < MAX_ACCEPT_PER_LOOP && AcceptConnection(hListenSocket, *socketEvents, fFailed))
+                nAccepted++;
+            if (nAccepted == MAX_ACCEPT_PER_LOOP) {
+                fMoreToRead = true;
+            } else if (!fFailed) {
+                nReady = 0;
+            }
+            // After another error, e.g. out of file descriptors, the waiting connections
+            // won't be reported again, so the socket stays ready and is retried next loop.
+            hListenSocket.nSocketReady = nReady;
         }
 
         //
@@ -1222,14 +1364,18 @@ void ThreadSocketHandler()
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError))
+            int nReady = GetSocketReady(mapReady, pnode->hSocket, fEdgeTriggered ? pnode->nSocketReady : 0);
+            if (nReady & (SOCKET_EVENT_RECV | SOCKET_EVENT_ERR))
             {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                if (lockRecv)
+                // an edge-triggered backend always reports received data, so
+                // apply the send-first and flood limits of GetSocketEventsWanted() here
+                if (lockRecv && (!fEdgeTriggered || (!(pnode->nSocketEvents & SOCKET_EVENT_SEND) && CanReceive(pnode))))
                 {
                     {
                         // typical socket buffer is 8K-64K
                         char pchBuf[0x10000];
+                        bool fDrained = true;
                         int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
                         if (nBytes > 0)
                         {
@@ -1238,6 +1384,7 @@ void ThreadSocketHandler()
                             pnode->nLastRecv = GetTime();
                             pnode->nRecvBytes += nBytes;
                             pnode->RecordBytesRecv(nBytes);
+                            fDrained = nBytes < (int)sizeof(pchBuf);
                         }
                         else if (nBytes == 0)
                         {
@@ -1257,6 +1404,10 @@ void ThreadSocketHandler()
                                 pnode->CloseSocketDisconnect();
                             }
                         }
+                        if (fDrained)
+                            nReady &= ~(SOCKET_EVENT_RECV | SOCKET_EVENT_ERR);
+                        else if (fEdgeTriggered)
+                            fMoreToRead = true;
                     }
                 }
             }
@@ -1266,12 +1417,17 @@ void ThreadSocketHandler()
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetSend))
+            if (nReady & SOCKET_EVENT_SEND)
             {
                 TRY_LOCK(pnode->cs_vSend, lockSend);
-                if (lockSend)
+                if (lockSend) {
+                    // stops when the socket is full, which an edge-triggered backend reports again
                     SocketSendData(pnode);
+                    nReady &= ~SOCKET_EVENT_SEND;
+                }
             }
+            if (fEdgeTriggered)
+                pnode->nSocketReady = nReady;
 
             //
             // Inactivity checking
@@ -1306,6 +1462,16 @@ void ThreadSocketHandler()
             BOOST_FOREACH(CNode* pnode, vNodesCopy)
                 pnode->Release();
         }
+
+        int64_t nBusy = (nWaitStart - nLoopStart) + (GetTimeMicros() - nWaitEnd);
+        {
+            LOCK(cs_socketEventsStats);
+            socketEventsStats.nLoops++;
+            socketEventsStats.nEvents += vReady.size();
+            socketEventsStats.nWaitMicros += nWaitEnd - nWaitStart;
+            socketEventsStats.nBusyMicros += nBusy;
+            socketEventsStats.nMaxBusyMicros = std::max(socketEventsStats.nMaxBusyMicros, nBusy);
+        }
     }
 }
 
@@ -1807,7 +1973,7 @@ void ThreadMessageHandler()
 
                     if (pnode->nSendSize < SendBufferSize())
                     {
-                        if (!pnode->vRecvGetData.empty() || (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete()))
+                        if (pnode->HasMessagesToProcess())
                         {
                             fSleep = false;
                         }
@@ -1836,6 +2002,71 @@ void ThreadMessageHandler()
     }
 }
 
+bool QueueMessageWork(CNode* pnode, const boost::function<void()>& fn)
+{
+    boost::unique_lock<boost::mutex> lock(cs_messageWork);
+    if (nMessageWorkers == 0)
+        return false;
+    pnode->AddRef();
+    pnode->nMessagesInFlight++;
+    queueMessageWork.push_back(std::make_pair(pnode, fn));
+    condMessageWork.notify_one();
+    return true;
+}
+
+void ThreadMessageWorker()
+{
+    while (true)
+    {
+        std::pair<CNode*, boost::function<void()> > work;
+        {
+            boost::unique_lock<boost::mutex> lock(cs_messageWork);
+            while (queueMessageWork.empty())
+                condMessageWork.wait(lock);
+            work = queueMessageWork.front();
+            queueMessageWork.pop_front();
+        }
+
+        CNode* pnode = work.first;
+        if (!pnode->fDisconnect)
+            work.second();
+        pnode->nMessagesInFlight--;
+        {
+            LOCK(cs_vNodes);
+            pnode->Release();
+        }
+
+        // the peer's next message can be processed now
+        messageHandlerCondition.notify_one();
+        boost::this_thread::interruption_point();
+    }
+}
+
+void StartMessageWorkers(boost::thread_group& threadGroup, int nWorkers)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs_messageWork);
+        nMessageWorkers = nWorkers;
+    }
+    for (int i = 0; i < nWorkers; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msgworker", &ThreadMessageWorker));
+}
+
+void StopMessageWorkers()
+{
+    std::deque<std::pair<CNode*, boost::function<void()> > > queueDropped;
+    {
+        boost::unique_lock<boost::mutex> lock(cs_messageWork);
+        nMessageWorkers = 0;
+        queueDropped.swap(queueMessageWork);
+    }
+    LOCK(cs_vNodes);
+    for (size_t i = 0; i < queueDropped.size(); i++) {
+        queueDropped[i].first->nMessagesInFlight--;
+        queueDropped[i].first->Release();
+    }
+}
+
 
 
 
@@ -1863,7 +2094,7 @@ bool BindListenPort(const CService &addrBind, string& strError, bool fWhiteliste
         LogPrintf("%s\n", strError);
         return false;
     }
-    if (!IsSelectableSocket(hListenSocket))
+    if (!fSocketEventsUnlimited && !IsSelectableSocket(hListenSocket))
     {
         strError = "Error: Couldn't create a listenable socket for incoming connections";
         LogPrintf("%s\n", strError);
@@ -2058,6 +2289,9 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
     // Process messages
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler));
 
+    // Process mnp, governance vote, IX vote and spork messages off the msghand thread
+    StartMessageWorkers(threadGroup, std::max(0, std::min((int)GetArg("-msgworkers", DEFAULT_MSG_WORKERS), MAX_MSG_WORKERS)));
+
     // Dump network addresses
     scheduler.scheduleEvery(&DumpData, DUMP_ADDRESSES_INTERVAL);
 }
@@ -2066,6 +2300,7 @@ bool StopNode()
 {
     LogPrintf("StopNode()\n");
     MapPort(false);
+    StopMessageWorkers();
     if (semOutbound)
         for (int i=0; i<MAX_OUTBOUND_CONNECTIONS; i++)
             semOutbound->post();
@@ -2468,6 +2703,9 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     nRefCount = 0;
     nSendSize = 0;
     nSendOffset = 0;
+    nSocketEvents = -1;
+    nSocketReady = 0;
+    nMessagesInFlight = 0;
     hashContinue = uint256();
     nStartingHeight = -1;
     filterInventoryKnown.reset();
@@ -17,6 +17,7 @@
 #include "uint256.h"
 #include "util.h"
 
+#include <atomic>
 #include <deque>
 #include <stdint.h>
 
@@ -26,6 +27,7 @@
 
 #include <boost/filesystem/path.hpp>
 #include <boost/foreach.hpp>
+#include <boost/function.hpp>
 #include <boost/signals2/signal.hpp>
 
 class CAddrMan;
@@ -72,6 +74,9 @@ static const bool DEFAULT_BLOCKSONLY = false;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** -msgworkers default: threads that process mnp, governance vote, IX vote and spork messages */
+static const int DEFAULT_MSG_WORKERS = 2;
+static const int MAX_MSG_WORKERS = 16;
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
@@ -95,6 +100,33 @@ bool BindListenPort(const CService &bindAddr, std::string& strError, bool fWhite
 void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler);
 bool StopNode();
 void SocketSendData(CNode *pnode);
+/**
+ * Run fn for pnode on a message worker thread. pnode is kept alive and its
+ * nMessagesInFlight raised until fn has returned. Returns false, doing
+ * nothing, if -msgworkers is 0.
+ */
+bool QueueMessageWork(CNode* pnode, const boost::function<void()>& fn);
+/** Start nWorkers threads in threadGroup that run the work from QueueMessageWork(). */
+void StartMessageWorkers(boost::thread_group& threadGroup, int nWorkers);
+/**
+ * Stop accepting message work and release the nodes of work still queued.
+ * The worker threads are interrupted and joined with their thread group.
+ */
+void StopMessageWorkers();
+
+/** Timing of ThreadSocketHandler's loop, for getsocketeventsinfo. */
+struct CSocketEventsStats
+{
+    std::string strBackend;
+    uint64_t nLoops;
+    uint64_t nEvents;       // ready sockets reported by the backend
+    int64_t nWaitMicros;    // time spent waiting for events
+    int64_t nBusyMicros;    // time spent in the rest of the loop
+    int64_t nMaxBusyMicros; // longest single loop, not counting the wait
+
+    CSocketEventsStats() : nLoops(0), nEvents(0), nWaitMicros(0), nBusyMicros(0), nMaxBusyMicros(0) {}
+};
+CSocketEventsStats GetSocketEventsStats();
 
 typedef int NodeId;
 
@@ -163,6 +195,9 @@ extern CAddrMan addrman;
 /** Maximum number of connections to simultaneously allow (aka connection slots) */
 extern int nMaxConnections;
 
+/** Whether the -socketevents backend can watch sockets at or above FD_SETSIZE */
+extern bool fSocketEventsUnlimited;
+
 extern std::vector<CNode*> vNodes;
 extern CCriticalSection cs_vNodes;
 extern std::map<CInv, CDataStream> mapRelay;
@@ -214,27 +249,48 @@ public:
 
 
 
+/** Most payload buffers the receive buffer pool keeps for reuse */
+static const size_t MAX_RECV_BUFFER_POOL_SIZE = 128;
+/** Most bytes of payload buffers the receive buffer pool keeps for reuse */
+static const size_t MAX_RECV_BUFFER_POOL_BYTES = 16 * 1024 * 1024;
+
+/**
+ * Give stream, which must be empty, a buffer with room for nSize bytes from
+ * the receive buffer pool, if the pool has one. Recycled buffers only ever
+ * held network data, so unlike a freed CSerializeData they are not zeroed.
+ */
+void GetRecvBuffer(CDataStream& stream, size_t nSize);
+/** Move stream's buffer into the receive buffer pool, leaving stream empty. */
+void ReleaseRecvBuffer(CDataStream& stream);
+
 class CNetMessage {
 public:
     bool in_data;                   // parsing header (false) or data (true)
 
-    CDataStream hdrbuf;             // partially received header
+    char hdrbuf[24];                // partially received header
     CMessageHeader hdr;             // complete header
     unsigned int nHdrPos;
 
-    CDataStream vRecv;              // received message data
+    CDataStream vRecv;              // received message data, in a buffer from the receive buffer pool
     unsigned int nDataPos;
 
     int64_t nTime;                  // time (in microseconds) of message receipt.
 
-    CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
-        hdrbuf.resize(24);
+    CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
         in_data = false;
         nHdrPos = 0;
         nDataPos = 0;
         nTime = 0;
     }
 
+    CNetMessage(CNetMessage&&) = default;
+    CNetMessage& operator=(CNetMessage&&) = default;
+
+    ~CNetMessage()
+    {
+        ReleaseRecvBuffer(vRecv);
+    }
+
     bool complete() const
     {
         if (!in_data)
@@ -244,7 +300,6 @@ public:
 
     void SetVersion(int nVersionIn)
     {
-        hdrbuf.SetVersion(nVersionIn);
         vRecv.SetVersion(nVersionIn);
     }
 
@@ -327,10 +382,15 @@ public:
     uint64_t nSendBytes;
     std::deque<CSerializeData> vSendMsg;
     CCriticalSection cs_vSend;
+    // only used by ThreadSocketHandler
+    int nSocketEvents; // events last declared to the socket events backend, -1 if none
+    int nSocketReady;  // readiness from an edge-triggered backend not consumed yet
 
     std::deque<CInv> vRecvGetData;
     std::deque<CNetMessage> vRecvMsg;
     CCriticalSection cs_vRecvMsg;
+    // messages handed to a message worker and not finished yet
+    std::atomic<int> nMessagesInFlight;
     uint64_t nRecvBytes;
     int nRecvVersion;
 
@@ -466,6 +526,14 @@ public:
     // requires LOCK(cs_vRecvMsg)
     bool ReceiveMsgBytes(const char *pch, unsigned int nBytes);
 
+    // requires LOCK(cs_vRecvMsg)
+    // While a worker has one of the node's messages, its next message waits
+    // for ThreadMessageWorker's notify.
+    bool HasMessagesToProcess() const
+    {
+        return !vRecvGetData.empty() || (!vRecvMsg.empty() && vRecvMsg[0].complete() && nMessagesInFlight == 0);
+    }
+
     // requires LOCK(cs_vRecvMsg)
     void SetRecvVersion(int nVersionIn)
     {
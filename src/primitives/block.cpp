@@ -7,20 +7,81 @@
 #include "primitives/block.h"
 
 #include "hash.h"
+#include "cachemap.h"
+#include "streams.h"
+#include "sync.h"
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 //#include "crypto/common.h"
 
+/**
+ * The Hello PoW is memory-hard, so the hashes of recently used headers are
+ * kept, keyed by their serialization. Any change to a header changes its key,
+ * so entries never go stale.
+ */
+struct CBlockHashCache
+{
+    CCriticalSection cs;
+    CacheMap<std::vector<unsigned char>, uint256> mapHashes;
+    uint64_t nHits;
+    uint64_t nMisses;
+
+    CBlockHashCache() : mapHashes(DEFAULT_BLOCK_HASH_CACHE_SIZE), nHits(0), nMisses(0) {}
+};
+
+/** Constructed on first use: the chain params hash their genesis blocks during static initialization. */
+static CBlockHashCache& GetBlockHashCache()
+{
+    static CBlockHashCache cache;
+    return cache;
+}
+
+void SetBlockHashCacheSize(size_t nMaxSize)
+{
+    CBlockHashCache& cache = GetBlockHashCache();
+    LOCK(cache.cs);
+    cache.mapHashes.Clear();
+    cache.mapHashes.SetMaxSize(nMaxSize);
+}
+
 uint256 CBlockHeader::GetHash() const
 {
-//	return SerializeHash(*this);
 	uint256 hash;
+	CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+	ss << *this;
+	assert(ss.size() == INPUT_LEN);
+	std::vector<unsigned char> vchHeader(ss.begin(), ss.end());
+
+	CBlockHashCache& cache = GetBlockHashCache();
+	{
+		LOCK(cache.cs);
+		if (cache.mapHashes.GetAndTouch(vchHeader, hash)) {
+			cache.nHits++;
+			return hash;
+		}
+		cache.nMisses++;
+	}
+
+	helloHash(&vchHeader[0], INPUT_LEN, (unsigned char *)&hash);
 
-	CryptoHello(this, (unsigned char *)&hash);
-//	view_data_u8("PoW 3", (unsigned char *)&hash, OUTPUT_LEN); 
-//	std::cout<<"gethex() ="<<hash.GetHex()<<std::endl;
-//	std::cout<<"tostring ="<<hash.ToString()<<std::endl; 
-	return hash;	
+	{
+		LOCK(cache.cs);
+		if (cache.mapHashes.GetMaxSize() > 0)
+			cache.mapHashes.Insert(vchHeader, hash);
+	}
+	return hash;
+}
+
+CBlockHashCacheStats GetBlockHashCacheStats()
+{
+    CBlockHashCache& cache = GetBlockHashCache();
+    LOCK(cache.cs);
+    CBlockHashCacheStats stats;
+    stats.nSize = cache.mapHashes.GetSize();
+    stats.nMaxSize = cache.mapHashes.GetMaxSize();
+    stats.nHits = cache.nHits;
+    stats.nMisses = cache.nMisses;
+    return stats;
 }
 
 std::string CBlockHeader::ToString() const                                                                                                                                                                                                                                   
@@ -76,6 +76,24 @@ public:
 };
 
 
+/** Default for -blockhashcachesize, the number of header hashes kept by CBlockHeader::GetHash() */
+static const unsigned int DEFAULT_BLOCK_HASH_CACHE_SIZE = 10000;
+
+struct CBlockHashCacheStats
+{
+    size_t nSize;
+    size_t nMaxSize;
+    uint64_t nHits;
+    uint64_t nMisses;
+};
+
+/** Resize the CBlockHeader::GetHash() cache and drop its entries, 0 disables it */
+void SetBlockHashCacheSize(size_t nMaxSize);
+
+/** Occupancy and hit/miss counters of the CBlockHeader::GetHash() cache */
+CBlockHashCacheStats GetBlockHashCacheStats();
+
+
 class CBlock : public CBlockHeader
 {
 public:
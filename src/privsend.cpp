@@ -12,12 +12,15 @@
 #include "masternode-payments.h"
 #include "masternode-sync.h"
 #include "masternodeman.h"
+#include "memusage.h"
+#include "random.h"
 #include "script/sign.h"
 #include "txmempool.h"
 #include "util.h"
 #include "utilmoneystr.h"
 
 #include <boost/lexical_cast.hpp>
+#include <boost/unordered_set.hpp>
 
 int nPrivateSendRounds = DEFAULT_PRIVATESEND_ROUNDS;
 int nPrivateSendAmount = DEFAULT_PRIVATESEND_AMOUNT;
@@ -30,6 +33,98 @@ CPrivSendSigner privSendSigner;
 std::map<uint256, CPrivsendBroadcastTx> mapPrivSendBroadcastTxes;
 std::vector<CAmount> vecPrivateSendDenominations;
 
+namespace {
+
+class CMessageSigCacheHasher
+{
+public:
+    size_t operator()(const uint256& key) const {
+        return key.GetCheapHash();
+    }
+};
+
+/**
+ * Masternode broadcasts, pings and votes reach us from many peers, and every
+ * copy used to go through public key recovery. Signatures that passed
+ * VerifyMessage() are remembered here, the same way CSignatureCache does for
+ * transaction signatures.
+ */
+class CMessageSigCache
+{
+private:
+    //! Entries are SHA256(nonce || message hash || public key || signature):
+    uint256 nonce;
+    typedef boost::unordered_set<uint256, CMessageSigCacheHasher> map_type;
+    map_type setValid;
+    CCriticalSection cs_sigcache;
+    uint64_t nHits;
+    uint64_t nMisses;
+
+public:
+    CMessageSigCache() : nHits(0), nMisses(0)
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    void ComputeEntry(uint256& entry, const uint256& hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(pubkey.begin(), pubkey.size()).Write(&vchSig[0], vchSig.size()).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry)
+    {
+        LOCK(cs_sigcache);
+        if(setValid.count(entry)) {
+            nHits++;
+            return true;
+        }
+        nMisses++;
+        return false;
+    }
+
+    void Set(const uint256& entry)
+    {
+        size_t nMaxCacheSize = GetArg("-maxmnsigcachesize", DEFAULT_MAX_MN_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+        if (nMaxCacheSize <= 0) return;
+
+        LOCK(cs_sigcache);
+        while (memusage::DynamicUsage(setValid) > nMaxCacheSize)
+        {
+            map_type::size_type s = GetRand(setValid.bucket_count());
+            map_type::local_iterator it = setValid.begin(s);
+            if (it != setValid.end(s)) {
+                setValid.erase(*it);
+            }
+        }
+
+        setValid.insert(entry);
+    }
+
+    CMessageSigCacheStats GetStats()
+    {
+        LOCK(cs_sigcache);
+        CMessageSigCacheStats stats;
+        stats.nSize = setValid.size();
+        stats.nHits = nHits;
+        stats.nMisses = nMisses;
+        return stats;
+    }
+};
+
+/** Constructed on first use, so the nonce is not drawn during static initialization. */
+CMessageSigCache& GetMessageSigCache()
+{
+    static CMessageSigCache messageSigCache;
+    return messageSigCache;
+}
+
+}
+
+CMessageSigCacheStats GetMessageSigCacheStats()
+{
+    return GetMessageSigCache().GetStats();
+}
+
 void CPrivSendPool::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
 {
     if(fLiteMode) return; // ignore all Ulord related functionality
@@ -2285,9 +2380,22 @@ bool CPrivSendSigner::VerifyMessage(CPubKey pubkey, const std::vector<unsigned c
     CHashWriter ss(SER_GETHASH, 0);
     ss << strMessageMagic;
     ss << strMessage;
+    uint256 hash = ss.GetHash();
+
+    if(vchSig.empty()) {
+        strErrorRet = "Error recovering public key.";
+        return false;
+    }
+
+    CMessageSigCache& messageSigCache = GetMessageSigCache();
+    uint256 entry;
+    messageSigCache.ComputeEntry(entry, hash, vchSig, pubkey);
+    if(messageSigCache.Get(entry)) {
+        return true;
+    }
 
     CPubKey pubkeyFromSig;
-    if(!pubkeyFromSig.RecoverCompact(ss.GetHash(), vchSig)) {
+    if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
         strErrorRet = "Error recovering public key.";
         return false;
     }
@@ -2299,6 +2407,7 @@ bool CPrivSendSigner::VerifyMessage(CPubKey pubkey, const std::vector<unsigned c
         return false;
     }
 
+    messageSigCache.Set(entry);
     return true;
 }
 
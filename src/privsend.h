@@ -36,6 +36,9 @@ static const int PRIVATESEND_KEYS_THRESHOLD_WARNING = 100;
 // Stop mixing completely, it's too dangerous to continue when we have only this many keys left
 static const int PRIVATESEND_KEYS_THRESHOLD_STOP    = 50;
 
+// Limit the cache of verified message signatures to this many MiB
+static const unsigned int DEFAULT_MAX_MN_SIG_CACHE_SIZE = 10;
+
 extern int nPrivateSendRounds;
 extern int nPrivateSendAmount;
 extern int nLiquidityProvider;
@@ -249,6 +252,16 @@ public:
     bool VerifyMessage(CPubKey pubkey, const std::vector<unsigned char>& vchSig, std::string strMessage, std::string& strErrorRet);
 };
 
+struct CMessageSigCacheStats
+{
+    size_t nSize;
+    uint64_t nHits;
+    uint64_t nMisses;
+};
+
+/** Occupancy and hit/miss counters of the CPrivSendSigner::VerifyMessage() cache */
+CMessageSigCacheStats GetMessageSigCacheStats();
+
 /** Used to keep track of current status of mixing pool
  */
 class CPrivSendPool
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chain.h"
+#include "claimtrie.h"
 #include "chainparams.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
@@ -24,6 +25,40 @@
 using namespace std;
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const size_t REST_CLAIMTRIE_PAGE = 1000; //nodes serialized per chunk while cs_main is held
+static const size_t REST_CLAIMTRIE_MAX_PENDING = 1 << 20; //bytes of a claim trie stream waiting for the client before the next page
+
+// Claim trie streams running now. Each holds an HTTP worker until the client
+// has read the whole trie, so at least one worker is always left for others.
+static CCriticalSection cs_claimTrieStreams;
+static int nClaimTrieStreams = 0;
+
+/** Takes one of the claim trie stream slots, if a worker can be spared, until it goes out of scope */
+class CClaimTrieStreamSlot
+{
+private:
+    bool fTaken;
+
+public:
+    CClaimTrieStreamSlot()
+    {
+        int nMaxStreams = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L) - 1;
+        LOCK(cs_claimTrieStreams);
+        fTaken = nClaimTrieStreams < nMaxStreams;
+        if (fTaken)
+            nClaimTrieStreams++;
+    }
+
+    ~CClaimTrieStreamSlot()
+    {
+        if (!fTaken)
+            return;
+        LOCK(cs_claimTrieStreams);
+        nClaimTrieStreams--;
+    }
+
+    bool IsTaken() const { return fTaken; }
+};
 
 enum RetFormat {
     RF_UNDEF,
@@ -64,6 +99,8 @@ extern UniValue mempoolInfoToJSON();
 extern UniValue mempoolToJSON(bool fVerbose = false);
 extern void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
 extern UniValue blockheaderToJSON(const CBlockIndex* blockindex);
+extern UniValue claimsInTrieNodeToJSON(const CCoinsViewCache& view, const std::string& name, const CClaimTrieNode& trieNode);
+extern UniValue claimTrieNodeToJSON(const std::string& name, const CClaimTrieNode& trieNode);
 
 static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, string message)
 {
@@ -348,6 +385,83 @@ static bool rest_mempool_contents(HTTPRequest* req, const std::string& strURIPar
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+// Stream the whole trie as one JSON array. cs_main is only held while a page
+// of nodes is copied out and serialized, so a large trie neither blocks block
+// processing nor gets built up in memory as a single UniValue. A stream keeps
+// its HTTP worker busy, so fewer run at once than there are -rpcthreads.
+static bool rest_claimtrie_stream(HTTPRequest* req, const std::string& strURIPart, bool fClaimsOnly)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    switch (rf) {
+    case RF_JSON: {
+        CClaimTrieStreamSlot slot;
+        if (!slot.IsTaken())
+            return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "Too many claim trie requests, try again later (or raise -rpcthreads)");
+        const int64_t nTimeout = GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT);
+
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReplyStart(HTTP_OK);
+        req->WriteReplyChunk("[");
+
+        std::string startName;
+        bool fMore = true, fFirst = true, fTimedOut = false;
+        while (fMore && !req->IsReplyClosed()) {
+            std::string strChunk;
+            {
+                LOCK(cs_main);
+                CCoinsViewCache view(pcoinsTip);
+                std::vector<namedNodeType> nodes;
+                std::string nextName;
+                fMore = pclaimTrie->getNodesFrom(startName, REST_CLAIMTRIE_PAGE, fClaimsOnly, nodes, nextName);
+                for (std::vector<namedNodeType>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+                    if (!fFirst)
+                        strChunk += ",";
+                    fFirst = false;
+                    if (fClaimsOnly)
+                        strChunk += claimsInTrieNodeToJSON(view, it->first, it->second).write();
+                    else
+                        strChunk += claimTrieNodeToJSON(it->first, it->second).write();
+                }
+                startName = nextName;
+            }
+            if (!strChunk.empty())
+                req->WriteReplyChunk(strChunk);
+            // give the worker back if the client stops reading; the array is
+            // left unterminated so the client can tell the reply is incomplete
+            if (!req->WaitReplyDrained(REST_CLAIMTRIE_MAX_PENDING, nTimeout)) {
+                LogPrint("http", "claim trie stream timed out, client not reading\n");
+                fTimedOut = true;
+                break;
+            }
+        }
+        if (!fTimedOut)
+            req->WriteReplyChunk("]\n");
+        req->WriteReplyEnd();
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+static bool rest_claimtrie(HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_claimtrie_stream(req, strURIPart, false);
+}
+
+static bool rest_claimsintrie(HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_claimtrie_stream(req, strURIPart, true);
+}
+
 static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -608,6 +722,8 @@ static const struct {
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/claimtrie", rest_claimtrie},
+      {"/rest/claimsintrie", rest_claimsintrie},
 };
 
 bool StartREST()
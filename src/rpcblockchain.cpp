@@ -1020,6 +1020,33 @@ UniValue getmempoolinfo(const UniValue& params, bool fHelp)
     return mempoolInfoToJSON();
 }
 
+UniValue getblockhashcacheinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getblockhashcacheinfo\n"
+            "\nReturns details on the cache of block header hashes.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"size\": xxxxx,               (numeric) Current number of cached hashes\n"
+            "  \"maxsize\": xxxxx,            (numeric) Maximum number of cached hashes\n"
+            "  \"hits\": xxxxx,               (numeric) Hashes served from the cache\n"
+            "  \"misses\": xxxxx              (numeric) Hashes that had to be computed\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockhashcacheinfo", "")
+            + HelpExampleRpc("getblockhashcacheinfo", "")
+        );
+
+    CBlockHashCacheStats stats = GetBlockHashCacheStats();
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("size", (int64_t) stats.nSize));
+    ret.push_back(Pair("maxsize", (int64_t) stats.nMaxSize));
+    ret.push_back(Pair("hits", (int64_t) stats.nHits));
+    ret.push_back(Pair("misses", (int64_t) stats.nMisses));
+    return ret;
+}
+
 UniValue invalidateblock(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -13,18 +13,89 @@
 
 
 
-// Maximum block decrement that is allowed from rpc calls
-const int MAX_RPC_BLOCK_DECREMENTS = 50;
+UniValue claimsInTrieNodeToJSON(const CCoinsViewCache& view, const std::string& name, const CClaimTrieNode& trieNode)
+{
+    UniValue node(UniValue::VOBJ);
+    node.push_back(Pair("name", name));
+    UniValue claims(UniValue::VARR);
+    for (std::vector<CClaimValue>::const_iterator itClaims = trieNode.claims.begin(); itClaims != trieNode.claims.end(); ++itClaims)
+    {
+        UniValue claim(UniValue::VOBJ);
+        claim.push_back(Pair("claimId", itClaims->claimId.GetHex()));
+        claim.push_back(Pair("txid", itClaims->outPoint.hash.GetHex()));
+        claim.push_back(Pair("n", (int)itClaims->outPoint.n));
+        claim.push_back(Pair("amount", ValueFromAmount(itClaims->nAmount)));
+        claim.push_back(Pair("height", itClaims->nHeight));
+        const CCoins* coin = view.AccessCoins(itClaims->outPoint.hash);
+        if (!coin)
+        {
+            LogPrintf("%s: %s does not exist in the coins view, despite being associated with a name\n",
+                      __func__, itClaims->outPoint.hash.GetHex());
+            claim.push_back(Pair("error", "No value found for claim"));
+        }
+        else if (coin->vout.size() <= itClaims->outPoint.n || coin->vout[itClaims->outPoint.n].IsNull())
+        {
+            LogPrintf("%s: the specified txout of %s appears to have been spent\n", __func__, itClaims->outPoint.hash.GetHex());
+            claim.push_back(Pair("error", "Txout spent"));
+        }
+        else
+        {
+            int op;
+            std::vector<std::vector<unsigned char> > vvchParams;
+            if (!DecodeClaimScript(coin->vout[itClaims->outPoint.n].scriptPubKey, op, vvchParams))
+            {
+                LogPrintf("%s: the specified txout of %s does not have an claim command\n", __func__, itClaims->outPoint.hash.GetHex());
+                claim.push_back(Pair("error", "No claim command found"));
+            }
+            else
+            {
+                // Add a layer of base58check encoding to the value
+                std::string sValue(vvchParams[1].begin(), vvchParams[1].end());
+                claim.push_back(Pair("address", sValue));
+            }
+        }
+        claims.push_back(claim);
+    }
+    node.push_back(Pair("claims", claims));
+    return node;
+}
+
+UniValue claimTrieNodeToJSON(const std::string& name, const CClaimTrieNode& trieNode)
+{
+    UniValue node(UniValue::VOBJ);
+    node.push_back(Pair("name", name));
+    node.push_back(Pair("hash", trieNode.hash.GetHex()));
+    CClaimValue claim;
+    if (trieNode.getBestClaim(claim))
+    {
+        node.push_back(Pair("txid", claim.outPoint.hash.GetHex()));
+        node.push_back(Pair("n", (int)claim.outPoint.n));
+        node.push_back(Pair("value", ValueFromAmount(claim.nAmount)));
+        node.push_back(Pair("height", claim.nHeight));
+    }
+    return node;
+}
+
+static size_t ParsePageLimit(const UniValue& params)
+{
+    if (params.size() < 2)
+        return 0;
+    int nLimit = params[1].get_int();
+    if (nLimit < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid limit");
+    return nLimit;
+}
 
 UniValue getclaimsintrie(const UniValue& params, bool fHelp)
 {
-    if (fHelp || params.size() > 0)
+    if (fHelp || params.size() > 2)
         throw std::runtime_error(
-            "getclaimsintrie\n"
-            "Return all claims in the name trie.\n"
+            "getclaimsintrie ( \"start_name\" limit )\n"
+            "Return the claims in the name trie, in name order.\n"
             "Arguments:\n"
-            "None\n"
-            "Result: \n"
+            "1. \"start_name\"    (string, optional) return names from this one on\n"
+            "2. limit           (numeric, optional, default=0) the most names to return, 0 for all\n"
+            "Result (without arguments): \n"
             "[\n"
             "  {\n"
             "    \"name\"          (string) the name claimed\n"
@@ -40,103 +111,94 @@ UniValue getclaimsintrie(const UniValue& params, bool fHelp)
             "    ]\n"
             "  }\n"
             "]\n"
+            "Result (with arguments): \n"
+            "{\n"
+            "  \"claims\": [...]     (array of object) the names as above\n"
+            "  \"next_name\"        (string, if there are more) the start_name of the next page\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getclaimsintrie", "\"\" 1000")
+            + HelpExampleRpc("getclaimsintrie", "\"\", 1000")
         );
-    
+
+    std::string startName;
+    if (params.size() > 0)
+        startName = params[0].get_str();
+    size_t nLimit = ParsePageLimit(params);
+
     LOCK(cs_main);
     UniValue ret(UniValue::VARR);
 
     CCoinsViewCache view(pcoinsTip);
-    std::vector<namedNodeType> nodes = pclaimTrie->flattenTrie();
+    std::vector<namedNodeType> nodes;
+    std::string nextName;
+    bool fMore = pclaimTrie->getNodesFrom(startName, nLimit, true, nodes, nextName);
 
     for (std::vector<namedNodeType>::iterator it = nodes.begin(); it != nodes.end(); ++it)
-    {
-        if (!it->second.claims.empty())
-        {
-            UniValue node(UniValue::VOBJ);
-            node.push_back(Pair("name", it->first));
-            UniValue claims(UniValue::VARR);
-            for (std::vector<CClaimValue>::iterator itClaims = it->second.claims.begin(); itClaims != it->second.claims.end(); ++itClaims)
-            {
-                UniValue claim(UniValue::VOBJ);
-                claim.push_back(Pair("claimId", itClaims->claimId.GetHex()));
-                claim.push_back(Pair("txid", itClaims->outPoint.hash.GetHex()));
-                claim.push_back(Pair("n", (int)itClaims->outPoint.n));
-                claim.push_back(Pair("amount", ValueFromAmount(itClaims->nAmount)));
-                claim.push_back(Pair("height", itClaims->nHeight));
-                const CCoins* coin = view.AccessCoins(itClaims->outPoint.hash);
-                if (!coin)
-                {
-                    LogPrintf("%s: %s does not exist in the coins view, despite being associated with a name\n",
-                              __func__, itClaims->outPoint.hash.GetHex());
-                    claim.push_back(Pair("error", "No value found for claim"));
-                }
-                else if (coin->vout.size() < itClaims->outPoint.n || coin->vout[itClaims->outPoint.n].IsNull())
-                {
-                    LogPrintf("%s: the specified txout of %s appears to have been spent\n", __func__, itClaims->outPoint.hash.GetHex());
-                    claim.push_back(Pair("error", "Txout spent"));
-                }
-                else
-                {
-                    int op;
-                    std::vector<std::vector<unsigned char> > vvchParams;
-                    if (!DecodeClaimScript(coin->vout[itClaims->outPoint.n].scriptPubKey, op, vvchParams))
-                    {
-                        LogPrintf("%s: the specified txout of %s does not have an claim command\n", __func__, itClaims->outPoint.hash.GetHex());
-                    }
-	            // Add a layer of base58check encoding to the value
-		    std::string sValue(vvchParams[1].begin(), vvchParams[1].end());
-                    claim.push_back(Pair("address", sValue));
-                }
-                claims.push_back(claim);
-            }
-            node.push_back(Pair("claims", claims));
-            ret.push_back(node);
-        }
-    }
-    return ret;
+        ret.push_back(claimsInTrieNodeToJSON(view, it->first, it->second));
+    if (params.size() == 0)
+        return ret;
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("claims", ret));
+    if (fMore)
+        result.push_back(Pair("next_name", nextName));
+    return result;
 }
 
 UniValue getclaimtrie(const UniValue& params, bool fHelp)
 {
-    if (fHelp || params.size() > 0)
+    if (fHelp || params.size() > 2)
         throw std::runtime_error(
-            "getclaimtrie\n"
-            "Return the entire name trie.\n"
+            "getclaimtrie ( \"start_name\" limit )\n"
+            "Return the name trie, in name order.\n"
             "Arguments:\n"
-            "None\n"
-            "Result: \n"
+            "1. \"start_name\"    (string, optional) return nodes from this name on\n"
+            "2. limit           (numeric, optional, default=0) the most nodes to return, 0 for all\n"
+            "Result (without arguments): \n"
+            "[\n"
+            "  {\n"
+            "    \"name\"           (string) the name of the node\n"
+            "    \"hash\"           (string) the hash of the node\n"
+            "    \"txid\"           (string) (if value exists) the hash of the transaction which has successfully claimed this name\n"
+            "    \"n\"              (numeric) (if value exists) vout value\n"
+            "    \"value\"          (numeric) (if value exists) txout value\n"
+            "    \"height\"         (numeric) (if value exists) the height of the block in which this transaction is located\n"
+            "  }\n"
+            "]\n"
+            "Result (with arguments): \n"
             "{\n"
-            "  \"name\"           (string) the name of the node\n"
-            "  \"hash\"           (string) the hash of the node\n"
-            "  \"txid\"           (string) (if value exists) the hash of the transaction which has successfully claimed this name\n"
-            "  \"n\"              (numeric) (if value exists) vout value\n"
-            "  \"value\"          (numeric) (if value exists) txout value\n"
-            "  \"height\"         (numeric) (if value exists) the height of the block in which this transaction is located\n"
+            "  \"nodes\": [...]      (array of object) the nodes as above\n"
+            "  \"next_name\"        (string, if there are more) the start_name of the next page\n"
             "}\n"
             "\nExamples:\n"
+            + HelpExampleCli("getclaimtrie", "\"\" 1000")
+            + HelpExampleRpc("getclaimtrie", "\"\", 1000")
         );
 
+    std::string startName;
+    if (params.size() > 0)
+        startName = params[0].get_str();
+    size_t nLimit = ParsePageLimit(params);
+
     LOCK(cs_main);
     UniValue ret(UniValue::VARR);
 
-    std::vector<namedNodeType> nodes = pclaimTrie->flattenTrie();
+    std::vector<namedNodeType> nodes;
+    std::string nextName;
+    bool fMore = pclaimTrie->getNodesFrom(startName, nLimit, false, nodes, nextName);
     for (std::vector<namedNodeType>::iterator it = nodes.begin(); it != nodes.end(); ++it)
-    {
-        UniValue node(UniValue::VOBJ);
-        node.push_back(Pair("name", it->first));                                                       
-        node.push_back(Pair("hash", it->second.hash.GetHex()));
-        CClaimValue claim;
-        if (it->second.getBestClaim(claim))
-        {
-            node.push_back(Pair("txid", claim.outPoint.hash.GetHex()));                                    
-            node.push_back(Pair("n", (int)claim.outPoint.n));                                             
-            node.push_back(Pair("value", ValueFromAmount(claim.nAmount)));                                           
-            node.push_back(Pair("height", claim.nHeight));                                          
-        }
-        ret.push_back(node);
-    }
-    return ret;
+        ret.push_back(claimTrieNodeToJSON(it->first, it->second));
+    if (params.size() == 0)
+        return ret;
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("nodes", ret));
+    if (fMore)
+        result.push_back(Pair("next_name", nextName));
+    return result;
 }
+
 UniValue getaccountnamefromaddress(const UniValue& params, bool fHelp)
 {
 	if (fHelp || params.size() != 1)
@@ -169,32 +231,30 @@ UniValue getaccountnamefromaddress(const UniValue& params, bool fHelp)
 	}
 
 	unsigned int i_num = 0;
-    std::vector<namedNodeType> nodes = pclaimTrie->flattenTrie();
-    for (std::vector<namedNodeType>::iterator it = nodes.begin(); it != nodes.end(); ++it)
-    {
-    	UniValue node(UniValue::VOBJ);
-    	node.push_back(Pair("name", it->first));                                                       
-		node.push_back(Pair("hash", it->second.hash.GetHex()));
+	std::vector<nameOutPointType> names = pclaimTrie->getNamesForAddress(sAddress);
+	for (std::vector<nameOutPointType>::iterator it = names.begin(); it != names.end(); ++it)
+	{
+		// Only names whose controlling claim is bound to the address count.
+		const CClaimTrieNode* current = pclaimTrie->getNodeForName(it->name);
 		CClaimValue claim;
-		if (it->second.getBestClaim(claim))
-        {
-        	if ( i_num > MAX_NUM )
-        	{
-        	    break;
-        	}
-		if ( !claim.saddr.compare(sAddress) )
-	    	{	 
-				node.push_back(Pair("txid", claim.outPoint.hash.GetHex()));                                    
-				node.push_back(Pair("n", (int)claim.outPoint.n));                                             
-				node.push_back(Pair("value", ValueFromAmount(claim.nAmount)));                                           
-				node.push_back(Pair("height", claim.nHeight)); 
-				node.push_back(Pair("address",claim.saddr)); 
-				ret.push_back(node);
-				i_num++;
-	   	}
-        }
-    }
-    return ret;
+		if (!current || !current->getBestClaim(claim) || claim.outPoint != it->outPoint)
+			continue;
+		if ( i_num > MAX_NUM )
+		{
+			break;
+		}
+		UniValue node(UniValue::VOBJ);
+		node.push_back(Pair("name", it->name));
+		node.push_back(Pair("hash", current->hash.GetHex()));
+		node.push_back(Pair("txid", claim.outPoint.hash.GetHex()));
+		node.push_back(Pair("n", (int)claim.outPoint.n));
+		node.push_back(Pair("value", ValueFromAmount(claim.nAmount)));
+		node.push_back(Pair("height", claim.nHeight));
+		node.push_back(Pair("address", sAddress));
+		ret.push_back(node);
+		i_num++;
+	}
+	return ret;
 
 }
 
@@ -208,7 +268,7 @@ bool getValueForClaim(const COutPoint& out, std::string& sValue)
                   __func__, out.hash.GetHex());
         return true;
     }
-    if (coin->vout.size() < out.n || coin->vout[out.n].IsNull())
+    if (coin->vout.size() <= out.n || coin->vout[out.n].IsNull())
     {
         LogPrintf("%s: the specified txout of %s appears to have been spent\n", __func__, out.hash.GetHex());
         return true;
@@ -445,27 +505,20 @@ UniValue getclaimbyid(const UniValue& params, bool fHelp)
     uint160 claimId;
     claimId.SetHex(params[0].get_str());
     UniValue claim(UniValue::VOBJ);
-    std::vector<namedNodeType> nodes = pclaimTrie->flattenTrie();
-    for (std::vector<namedNodeType>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
-        if (!it->second.claims.empty()) {
-            for (std::vector<CClaimValue>::iterator itClaims = it->second.claims.begin();
-                 itClaims != it->second.claims.end(); ++itClaims) {
-                if (claimId == itClaims->claimId) {
-                    std::string sValue;
-                    getValueForClaim(itClaims->outPoint, sValue);
-                    claim.push_back(Pair("name", it->first));
-                    claim.push_back(Pair("address", sValue));
-                    claim.push_back(Pair("claimId", itClaims->claimId.GetHex()));
-                    claim.push_back(Pair("txid", itClaims->outPoint.hash.GetHex()));
-                    claim.push_back(Pair("n", (int) itClaims->outPoint.n));
-                    claim.push_back(Pair("amount", itClaims->nAmount));
-                    claim.push_back(Pair("effective amount",
-                                         pclaimTrie->getEffectiveAmountForClaim(it->first, itClaims->claimId)));
-                    claim.push_back(Pair("height", itClaims->nHeight));
-                    return claim;
-                }
-            }
-        }
+    std::string name;
+    CClaimValue claimValue;
+    if (pclaimTrie->getClaimById(claimId, name, claimValue)) {
+        std::string sValue;
+        getValueForClaim(claimValue.outPoint, sValue);
+        claim.push_back(Pair("name", name));
+        claim.push_back(Pair("address", sValue));
+        claim.push_back(Pair("claimId", claimValue.claimId.GetHex()));
+        claim.push_back(Pair("txid", claimValue.outPoint.hash.GetHex()));
+        claim.push_back(Pair("n", (int) claimValue.outPoint.n));
+        claim.push_back(Pair("amount", claimValue.nAmount));
+        claim.push_back(Pair("effective amount",
+                             pclaimTrie->getEffectiveAmountForClaim(name, claimValue.claimId)));
+        claim.push_back(Pair("height", claimValue.nHeight));
     }
     return claim;
 }
@@ -746,7 +799,10 @@ UniValue getnameproof(const UniValue& params, bool fHelp)
             "                                            of the proof. If\n"
             "                                            none is given, \n"
             "                                            the latest block\n"
-            "                                            will be used.\n"
+            "                                            will be used. It\n"
+            "                                            can be at most\n"
+            "                                            -claimtriehistory\n"
+            "                                            blocks deep.\n"
             "Result: \n"
             "{\n"
             "  \"nodes\" : [       (array of object) full nodes (i.e.\n"
@@ -810,7 +866,7 @@ UniValue getnameproof(const UniValue& params, bool fHelp)
     if (!chainActive.Contains(pblockIndex))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not in main chain");
 
-    if (chainActive.Tip()->nHeight > (pblockIndex->nHeight + MAX_RPC_BLOCK_DECREMENTS))
+    if (pblockIndex->nHeight < pclaimTrie->getOldestProofHeight())
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Block too deep to generate proof");
 
     CClaimTrieProof proof;
@@ -130,6 +130,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getaddressdeltas", 0},
     { "getaddressutxos", 0},
     { "getaddressmempool", 0},
+    { "getclaimsintrie", 1 },
+    { "getclaimtrie", 1 },
 };
 
 class CRPCConvertTable
@@ -88,6 +88,34 @@ UniValue getpoolinfo(const UniValue& params, bool fHelp)
     return obj;
 }
 
+UniValue getmnsigcacheinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw std::runtime_error(
+            "getmnsigcacheinfo\n"
+            "\nReturns details on the cache of verified masternode message signatures.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"size\": xxxxx,               (numeric) Current number of cached signatures\n"
+            "  \"hits\": xxxxx,               (numeric) Signatures found in the cache\n"
+            "  \"misses\": xxxxx,             (numeric) Signatures that had to be verified\n"
+            "  \"hitrate\": x.xxx             (numeric) hits / (hits + misses)\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmnsigcacheinfo", "")
+            + HelpExampleRpc("getmnsigcacheinfo", "")
+        );
+
+    CMessageSigCacheStats stats = GetMessageSigCacheStats();
+    uint64_t nLookups = stats.nHits + stats.nMisses;
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("size", (int64_t) stats.nSize));
+    ret.push_back(Pair("hits", (int64_t) stats.nHits));
+    ret.push_back(Pair("misses", (int64_t) stats.nMisses));
+    ret.push_back(Pair("hitrate", nLookups ? (double) stats.nHits / nLookups : 0.0));
+    return ret;
+}
+
 typedef std::pair<std::string, int> WINPAIR;
 bool cmp_by_value(const WINPAIR& lhs, const WINPAIR& rhs)
 {
@@ -403,6 +403,37 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
     return obj;
 }
 
+UniValue getsocketeventsinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 0)
+        throw runtime_error(
+            "getsocketeventsinfo\n"
+            "\nReturns timing of the socket handler loop since it started.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"backend\": \"xxxx\",   (string) The socket events backend in use (select or epoll)\n"
+            "  \"loops\": n,            (numeric) Number of loop iterations\n"
+            "  \"events\": n,           (numeric) Number of ready sockets reported by the backend\n"
+            "  \"avgwait\": n,          (numeric) Average time waiting for events per loop, in microseconds\n"
+            "  \"avgbusy\": n,          (numeric) Average time spent in the rest of the loop, in microseconds\n"
+            "  \"maxbusy\": n           (numeric) Longest loop iteration not counting the wait, in microseconds\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getsocketeventsinfo", "")
+            + HelpExampleRpc("getsocketeventsinfo", "")
+       );
+
+    CSocketEventsStats stats = GetSocketEventsStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("backend", stats.strBackend));
+    obj.push_back(Pair("loops", (int64_t)stats.nLoops));
+    obj.push_back(Pair("events", (int64_t)stats.nEvents));
+    obj.push_back(Pair("avgwait", stats.nLoops ? stats.nWaitMicros / (int64_t)stats.nLoops : 0));
+    obj.push_back(Pair("avgbusy", stats.nLoops ? stats.nBusyMicros / (int64_t)stats.nLoops : 0));
+    obj.push_back(Pair("maxbusy", stats.nMaxBusyMicros));
+    return obj;
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
@@ -271,6 +271,7 @@ static const CRPCCommand vRPCCommands[] =
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true  },
     { "network",            "getconnectioncount",     &getconnectioncount,     true  },
     { "network",            "getnettotals",           &getnettotals,           true  },
+    { "network",            "getsocketeventsinfo",    &getsocketeventsinfo,    true  },
     { "network",            "getpeerinfo",            &getpeerinfo,            true  },
     { "network",            "ping",                   &ping,                   true  },
     { "network",            "setban",                 &setban,                 true  },
@@ -290,6 +291,7 @@ static const CRPCCommand vRPCCommands[] =
     { "blockchain",         "getchaintips",           &getchaintips,           true  },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
+    { "blockchain",         "getblockhashcacheinfo",  &getblockhashcacheinfo,  true  },
     { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
     { "blockchain",         "gettxout",               &gettxout,               true  },
     { "blockchain",         "gettxoutproof",          &gettxoutproof,          true  },
@@ -358,6 +360,7 @@ static const CRPCCommand vRPCCommands[] =
     { "ulord",               "mnsync",                 &mnsync,                 true  },
     { "ulord",               "spork",                  &spork,                  true  },
     { "ulord",               "getpoolinfo",            &getpoolinfo,            true  },
+    { "ulord",               "getmnsigcacheinfo",      &getmnsigcacheinfo,      true  },
     { "ulord",               "signmnpmessage",         &signmnpmessage,         true  },
 #ifdef ENABLE_WALLET
     { "ulord",               "privatesend",            &privatesend,            false },
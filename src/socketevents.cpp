@@ -0,0 +1,209 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "socketevents.h"
+
+#include "netbase.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <algorithm>
+
+#include <boost/foreach.hpp>
+
+#ifdef USE_EPOLL
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+/** select(): rebuilds its fd_sets before every wait, limited to FD_SETSIZE. */
+class CSocketEventsSelect : public CSocketEvents
+{
+private:
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    SOCKET hSocketMax;
+    std::vector<SOCKET> vSockets;
+
+    void Reset()
+    {
+        FD_ZERO(&fdsetRecv);
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        hSocketMax = 0;
+        vSockets.clear();
+    }
+
+public:
+    CSocketEventsSelect() { Reset(); }
+
+    const char* GetName() const { return "select"; }
+    bool IsEdgeTriggered() const { return false; }
+    bool IsWatchable(SOCKET s) const { return s != INVALID_SOCKET && IsSelectableSocket(s); }
+
+    void Watch(SOCKET s, int nEvents, int nPrevEvents)
+    {
+        if (!IsWatchable(s) || nEvents == 0)
+            return;
+        if (nEvents & SOCKET_EVENT_RECV)
+            FD_SET(s, &fdsetRecv);
+        if (nEvents & SOCKET_EVENT_SEND)
+            FD_SET(s, &fdsetSend);
+        if (nEvents & SOCKET_EVENT_ERR)
+            FD_SET(s, &fdsetError);
+        hSocketMax = std::max(hSocketMax, s);
+        vSockets.push_back(s);
+    }
+
+    bool Wait(int64_t nTimeoutMs, std::vector<std::pair<SOCKET, int> >& vReady)
+    {
+        struct timeval timeout = MillisToTimeval(nTimeoutMs);
+        bool fHaveFds = !vSockets.empty();
+        int nSelect = select(fHaveFds ? hSocketMax + 1 : 0,
+                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        bool fRet = true;
+        if (nSelect == SOCKET_ERROR)
+        {
+            if (fHaveFds)
+            {
+                int nErr = WSAGetLastError();
+                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+                // let the caller find out which socket is bad
+                BOOST_FOREACH(SOCKET s, vSockets)
+                    vReady.push_back(std::make_pair(s, (int)SOCKET_EVENT_RECV));
+                fRet = false;
+            }
+            MilliSleep(nTimeoutMs);
+        }
+        else if (nSelect > 0)
+        {
+            BOOST_FOREACH(SOCKET s, vSockets)
+            {
+                int nEvents = 0;
+                if (FD_ISSET(s, &fdsetRecv))
+                    nEvents |= SOCKET_EVENT_RECV;
+                if (FD_ISSET(s, &fdsetSend))
+                    nEvents |= SOCKET_EVENT_SEND;
+                if (FD_ISSET(s, &fdsetError))
+                    nEvents |= SOCKET_EVENT_ERR;
+                if (nEvents != 0)
+                    vReady.push_back(std::make_pair(s, nEvents));
+            }
+        }
+        Reset();
+        return fRet;
+    }
+};
+
+#ifdef USE_EPOLL
+/**
+ * Edge-triggered epoll: sockets stay registered until they are closed, so
+ * neither registering nor waiting costs anything per idle socket.
+ */
+class CSocketEventsEpoll : public CSocketEvents
+{
+private:
+    int fdEpoll;
+    std::vector<struct epoll_event> vEvents;
+
+public:
+    CSocketEventsEpoll() : fdEpoll(epoll_create1(EPOLL_CLOEXEC)), vEvents(256) {}
+    ~CSocketEventsEpoll()
+    {
+        if (fdEpoll != -1)
+            close(fdEpoll);
+    }
+
+    bool IsValid() const { return fdEpoll != -1; }
+
+    const char* GetName() const { return "epoll"; }
+    bool IsEdgeTriggered() const { return true; }
+    bool IsWatchable(SOCKET s) const { return s != INVALID_SOCKET; }
+
+    void Watch(SOCKET s, int nEvents, int nPrevEvents)
+    {
+        if (!IsWatchable(s) || nEvents == nPrevEvents)
+            return;
+
+        struct epoll_event event;
+        event.events = EPOLLET | EPOLLRDHUP;
+        if (nEvents & SOCKET_EVENT_RECV)
+            event.events |= EPOLLIN;
+        if (nEvents & SOCKET_EVENT_SEND)
+            event.events |= EPOLLOUT;
+        event.data.u64 = 0;
+        event.data.fd = s;
+
+        int nOp = nPrevEvents < 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+        if (epoll_ctl(fdEpoll, nOp, s, &event) == 0)
+            return;
+        // A socket number can be reused before we notice the old one was closed.
+        if (errno == EEXIST && epoll_ctl(fdEpoll, EPOLL_CTL_MOD, s, &event) == 0)
+            return;
+        if (errno == ENOENT && epoll_ctl(fdEpoll, EPOLL_CTL_ADD, s, &event) == 0)
+            return;
+        LogPrintf("epoll_ctl error for socket %d: %s\n", s, NetworkErrorString(errno));
+    }
+
+    bool Wait(int64_t nTimeoutMs, std::vector<std::pair<SOCKET, int> >& vReady)
+    {
+        int nReady = epoll_wait(fdEpoll, &vEvents[0], vEvents.size(), nTimeoutMs);
+        if (nReady < 0)
+        {
+            if (errno == EINTR)
+                return true;
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(errno));
+            MilliSleep(nTimeoutMs);
+            return false;
+        }
+        for (int i = 0; i < nReady; i++)
+        {
+            int nEvents = 0;
+            if (vEvents[i].events & EPOLLIN)
+                nEvents |= SOCKET_EVENT_RECV;
+            if (vEvents[i].events & EPOLLOUT)
+                nEvents |= SOCKET_EVENT_SEND;
+            if (vEvents[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+                nEvents |= SOCKET_EVENT_ERR;
+            vReady.push_back(std::make_pair((SOCKET)vEvents[i].data.fd, nEvents));
+        }
+        // fetch more at once next time if we filled the array
+        if ((size_t)nReady == vEvents.size())
+            vEvents.resize(vEvents.size() * 2);
+        return true;
+    }
+};
+#endif // USE_EPOLL
+
+} // namespace
+
+CSocketEvents* CreateSocketEvents(const std::string& strName)
+{
+    if (strName == "select")
+        return new CSocketEventsSelect();
+#ifdef USE_EPOLL
+    if (strName == "epoll") {
+        CSocketEventsEpoll* pEpoll = new CSocketEventsEpoll();
+        if (pEpoll->IsValid())
+            return pEpoll;
+        LogPrintf("epoll_create1 failed: %s\n", NetworkErrorString(errno));
+        delete pEpoll;
+    }
+#endif
+    return NULL;
+}
+
+std::vector<std::string> GetSocketEventsBackends()
+{
+    std::vector<std::string> vBackends;
+    vBackends.push_back("select");
+#ifdef USE_EPOLL
+    vBackends.push_back("epoll");
+#endif
+    return vBackends;
+}
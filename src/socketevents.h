@@ -0,0 +1,82 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SOCKETEVENTS_H
+#define BITCOIN_SOCKETEVENTS_H
+
+#if defined(HAVE_CONFIG_H)
+#include "config/ulord-config.h"
+#endif
+
+#include "compat.h"
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(HAVE_SYS_EPOLL_H) && !defined(WIN32)
+#define USE_EPOLL
+#endif
+
+/** Events a socket can be watched for and reported ready with. */
+enum SocketEvent
+{
+    SOCKET_EVENT_RECV = (1 << 0),
+    SOCKET_EVENT_SEND = (1 << 1),
+    SOCKET_EVENT_ERR  = (1 << 2),
+};
+
+//! -socketevents default
+#ifdef USE_EPOLL
+static const char* const DEFAULT_SOCKET_EVENTS = "epoll";
+#else
+static const char* const DEFAULT_SOCKET_EVENTS = "select";
+#endif
+
+/**
+ * Waits for readiness on a set of sockets, for ThreadSocketHandler.
+ *
+ * Before each Wait() the caller calls Watch() for every socket it wants
+ * events for, passing the events it declared for that socket last time
+ * (-1 for a new socket). The select() backend forgets everything after
+ * Wait(); the epoll backend keeps its registrations in the kernel and only
+ * makes a system call when the declared events change. Closing a socket is
+ * enough to unregister it.
+ */
+class CSocketEvents
+{
+public:
+    virtual ~CSocketEvents() {}
+
+    virtual const char* GetName() const = 0;
+
+    /**
+     * Whether readiness is reported only once per change (epoll with
+     * EPOLLET) rather than on every Wait() while it lasts (select). The
+     * caller must then remember readiness until recv()/send()/accept()
+     * would block.
+     */
+    virtual bool IsEdgeTriggered() const = 0;
+
+    /** Whether this backend can watch socket s at all. */
+    virtual bool IsWatchable(SOCKET s) const = 0;
+
+    /** Declare the events (a mask of SocketEvent) to wait for on s. */
+    virtual void Watch(SOCKET s, int nEvents, int nPrevEvents) = 0;
+
+    /**
+     * Wait up to nTimeoutMs milliseconds and append the ready sockets and
+     * their events to vReady. Returns false if waiting failed.
+     */
+    virtual bool Wait(int64_t nTimeoutMs, std::vector<std::pair<SOCKET, int> >& vReady) = 0;
+};
+
+/** Create the named backend ("select" or "epoll"), or NULL if it is not available. */
+CSocketEvents* CreateSocketEvents(const std::string& strName);
+
+/** Names of the backends available on this platform. */
+std::vector<std::string> GetSocketEventsBackends();
+
+#endif // BITCOIN_SOCKETEVENTS_H
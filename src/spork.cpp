@@ -35,25 +35,35 @@ void CSporkManager::ProcessSpork(CNode* pfrom, std::string& strCommand, CDataStr
             strLogMsg = strprintf("SPORK -- hash: %s id: %d value: %10d bestHeight: %d peer=%d", hash.ToString(), spork.nSporkID, spork.nValue, chainActive.Height(), pfrom->id);
         }
 
-        if(mapSporksActive.count(spork.nSporkID)) {
-            if (mapSporksActive[spork.nSporkID].nTimeSigned >= spork.nTimeSigned) {
-                LogPrint("spork", "%s seen\n", strLogMsg);
-                return;
+        {
+            LOCK(cs);
+            if(mapSporksActive.count(spork.nSporkID)) {
+                if (mapSporksActive[spork.nSporkID].nTimeSigned >= spork.nTimeSigned) {
+                    LogPrint("spork", "%s seen\n", strLogMsg);
+                    return;
+                } else {
+                    LogPrintf("%s updated\n", strLogMsg);
+                }
             } else {
-                LogPrintf("%s updated\n", strLogMsg);
+                LogPrintf("%s new\n", strLogMsg);
             }
-        } else {
-            LogPrintf("%s new\n", strLogMsg);
         }
 
+        // checked without holding any lock, this is the expensive part
         if(!spork.CheckSignature()) {
             LogPrintf("CSporkManager::ProcessSpork -- invalid signature\n");
+            LOCK(cs_main);
             Misbehaving(pfrom->GetId(), 100);
             return;
         }
 
-        mapSporks[hash] = spork;
-        mapSporksActive[spork.nSporkID] = spork;
+        {
+            LOCK2(cs_main, cs);
+            // another peer's copy may have been accepted meanwhile
+            if(mapSporksActive.count(spork.nSporkID) && mapSporksActive[spork.nSporkID].nTimeSigned >= spork.nTimeSigned) return;
+            mapSporks[hash] = spork;
+            mapSporksActive[spork.nSporkID] = spork;
+        }
         spork.Relay();
 
         //does a task if needed
@@ -61,6 +71,7 @@ void CSporkManager::ProcessSpork(CNode* pfrom, std::string& strCommand, CDataStr
 
     } else if (strCommand == NetMsgType::GETSPORKS) {
 
+        LOCK(cs);
         std::map<int, CSporkMessage>::iterator it = mapSporksActive.begin();
 
         while(it != mapSporksActive.end()) {
@@ -107,6 +118,7 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue)
 
     if(spork.Sign(strMasterPrivKey)) {
         spork.Relay();
+        LOCK2(cs_main, cs);
         mapSporks[spork.GetHash()] = spork;
         mapSporksActive[nSporkID] = spork;
         return true;
@@ -120,6 +132,7 @@ bool CSporkManager::IsSporkActive(int nSporkID)
 {
     int64_t r = -1;
 
+    LOCK(cs);
     if(mapSporksActive.count(nSporkID)){
         r = mapSporksActive[nSporkID].nValue;
     } else {
@@ -147,6 +160,7 @@ bool CSporkManager::IsSporkActive(int nSporkID)
 // grab the value of the spork on the network, or the default
 int64_t CSporkManager::GetSporkValue(int nSporkID)
 {
+    LOCK(cs);
     if (mapSporksActive.count(nSporkID))
         return mapSporksActive[nSporkID].nValue;
 
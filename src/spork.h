@@ -102,6 +102,8 @@ class CSporkManager
 private:
     std::vector<unsigned char> vchSig;
     std::string strMasterPrivKey;
+    // protects mapSporksActive, sporks can arrive on a message worker
+    CCriticalSection cs;
     std::map<int, CSporkMessage> mapSporksActive;
 
 public:
@@ -118,6 +120,9 @@ public:
     std::string GetSporkNameByID(int nSporkID);
 
     bool SetPrivKey(std::string strPrivKey);
+
+    ///for test
+    void SetPrivKeyForTest(const std::string& strPrivKey) { strMasterPrivKey = strPrivKey; }
 };
 
 #endif
@@ -116,9 +116,12 @@ public:
     bool empty() const                               { return vch.size() == nReadPos; }
     void resize(size_type n, value_type c=0)         { vch.resize(n + nReadPos, c); }
     void reserve(size_type n)                        { vch.reserve(n + nReadPos); }
+    size_type capacity() const                       { return vch.capacity() - nReadPos; }
     const_reference operator[](size_type pos) const  { return vch[pos + nReadPos]; }
     reference operator[](size_type pos)              { return vch[pos + nReadPos]; }
     void clear()                                     { vch.clear(); nReadPos = 0; }
+    /** Exchange the underlying buffer with vchOther, for recycling buffers; reading restarts at its beginning. */
+    void SwapBuffer(vector_type& vchOther)           { vch.swap(vchOther); nReadPos = 0; }
     iterator insert(iterator it, const char& x=char()) { return vch.insert(it, x); }
     void insert(iterator it, size_type n, const char& x) { vch.insert(it, n, x); }
 
@@ -329,6 +332,61 @@ public:
 
 
 
+/**
+ * Read-only stream over bytes owned by someone else, to deserialize them in
+ * place instead of copying them into a CDataStream first. The bytes must
+ * outlive the view.
+ */
+class CStreamView
+{
+private:
+    const char* pcur;
+    const char* pend;
+
+public:
+    int nType;
+    int nVersion;
+
+    CStreamView(const char* pbegin, const char* pendIn, int nTypeIn, int nVersionIn) :
+        pcur(pbegin), pend(pendIn), nType(nTypeIn), nVersion(nVersionIn)
+    {
+        assert(pend >= pcur);
+    }
+
+    const char* begin() const { return pcur; }
+    const char* end() const   { return pend; }
+    size_t size() const       { return pend - pcur; }
+    bool empty() const        { return pcur == pend; }
+    bool eof() const          { return pcur == pend; }
+
+    int GetType() const       { return nType; }
+    int GetVersion() const    { return nVersion; }
+
+    CStreamView& read(char* pch, size_t nSize)
+    {
+        if (nSize > size())
+            throw std::ios_base::failure("CStreamView::read(): end of data");
+        memcpy(pch, pcur, nSize);
+        pcur += nSize;
+        return (*this);
+    }
+
+    CStreamView& ignore(size_t nSize)
+    {
+        if (nSize > size())
+            throw std::ios_base::failure("CStreamView::ignore(): end of data");
+        pcur += nSize;
+        return (*this);
+    }
+
+    template<typename T>
+    CStreamView& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
 
 /** Non-refcounted RAII wrapper for FILE*
  *
@@ -124,4 +124,30 @@ BOOST_AUTO_TEST_CASE(cachemap_test)
     BOOST_CHECK(Compare(mapTest1, mapTest4));
 }
 
+BOOST_AUTO_TEST_CASE(cachemap_touch_test)
+{
+    CacheMap<int,int> mapTest(3);
+    for(int i = 0; i < 3; ++i) {
+        mapTest.Insert(i, i);
+    }
+
+    // touching the oldest item protects it from the next prune
+    int nVal = -1;
+    BOOST_CHECK(mapTest.GetAndTouch(0, nVal) == true);
+    BOOST_CHECK(nVal == 0);
+    BOOST_CHECK(mapTest.GetAndTouch(5, nVal) == false);
+
+    mapTest.Insert(3, 3);
+    BOOST_CHECK(mapTest.GetSize() == 3);
+    BOOST_CHECK(mapTest.HasKey(0) == true);
+    BOOST_CHECK(mapTest.HasKey(1) == false);
+    BOOST_CHECK(mapTest.HasKey(2) == true);
+    BOOST_CHECK(mapTest.HasKey(3) == true);
+
+    // the index still points at the moved item
+    mapTest.Erase(0);
+    BOOST_CHECK(mapTest.GetSize() == 2);
+    BOOST_CHECK(mapTest.HasKey(0) == false);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -16,7 +16,9 @@
 #include "chainparams.h"
 #include "policy/policy.h"
 #include "pow.h"
+#include <boost/scoped_ptr.hpp>
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
 #include <iostream>
 #include "test/test_ulord.h"
 #include <string>
@@ -1006,4 +1008,476 @@ bool verify_proof(const CClaimTrieProof proof, uint256 rootHash, const std::stri
 }
 
 
+BOOST_AUTO_TEST_CASE(claimtrie_address_index)
+{
+    LOCK(cs_main);
+    std::string sName("addrtest");
+    std::string sAddress("uwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg");
+    COutPoint outPoint(uint256S("0000000000000000000000000000000000000000000000000000000000000abc"), 1);
+    CClaimValue claim(outPoint, ClaimIdHash(outPoint.hash, outPoint.n), 100, 1, 1, sAddress, sName);
+
+    CClaimTrieCache cacheInsert(pclaimTrie);
+    BOOST_CHECK(cacheInsert.insertClaimIntoTrie(sName, claim));
+    BOOST_CHECK(pclaimTrie->getNamesForAddress(sAddress).empty());
+    BOOST_CHECK(cacheInsert.flush());
+
+    // Served from the dirty entries first, then from the database.
+    for (int i = 0; i < 2; ++i) {
+        std::vector<nameOutPointType> names = pclaimTrie->getNamesForAddress(sAddress);
+        BOOST_CHECK_EQUAL(names.size(), 1U);
+        BOOST_CHECK(names.size() == 1 && names[0].name == sName && names[0].outPoint == outPoint);
+        BOOST_CHECK(pclaimTrie->getNamesForAddress("u" + sAddress).empty());
+        BOOST_CHECK(pclaimTrie->WriteToDisk());
+    }
+
+    CClaimTrieCache cacheRemove(pclaimTrie);
+    CClaimValue removed;
+    BOOST_CHECK(cacheRemove.removeClaimFromTrie(sName, outPoint, removed));
+    BOOST_CHECK(cacheRemove.flush());
+    BOOST_CHECK(pclaimTrie->getNamesForAddress(sAddress).empty());
+    BOOST_CHECK(pclaimTrie->WriteToDisk());
+    BOOST_CHECK(pclaimTrie->getNamesForAddress(sAddress).empty());
+
+    // The address outlives the claim so that an undone removal can index it again.
+    std::string sStored;
+    BOOST_CHECK(!pclaimTrie->getAddressForClaim(outPoint, sStored));
+    CClaimTrieCache cacheRestore(pclaimTrie);
+    claim.saddr.clear();
+    BOOST_CHECK(cacheRestore.undoSpendClaim(sName, outPoint, claim.claimId, claim.nAmount, claim.nHeight, 0, sAddress));
+    BOOST_CHECK(cacheRestore.flush());
+    BOOST_CHECK(pclaimTrie->getAddressForClaim(outPoint, sStored) && sStored == sAddress);
+    BOOST_CHECK_EQUAL(pclaimTrie->getNamesForAddress(sAddress).size(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(claimtrie_claimid_index)
+{
+    LOCK(cs_main);
+    std::string sName("idtest");
+    COutPoint outPoint(uint256S("0000000000000000000000000000000000000000000000000000000000000def"), 0);
+    uint160 claimId = ClaimIdHash(outPoint.hash, outPoint.n);
+    CClaimValue claim(outPoint, claimId, 100, 1, 1, "", sName);
+
+    std::string sFound;
+    CClaimValue found;
+    BOOST_CHECK(!pclaimTrie->getClaimById(claimId, sFound, found));
+
+    CClaimTrieCache cacheInsert(pclaimTrie);
+    BOOST_CHECK(cacheInsert.insertClaimIntoTrie(sName, claim));
+    BOOST_CHECK(cacheInsert.flush());
+    for (int i = 0; i < 2; ++i) {
+        BOOST_CHECK(pclaimTrie->getClaimById(claimId, sFound, found));
+        BOOST_CHECK(sFound == sName && found.outPoint == outPoint && found.claimId == claimId);
+        BOOST_CHECK(pclaimTrie->WriteToDisk());
+    }
+
+    CClaimTrieCache cacheRemove(pclaimTrie);
+    CClaimValue removed;
+    BOOST_CHECK(cacheRemove.removeClaimFromTrie(sName, outPoint, removed));
+    BOOST_CHECK(cacheRemove.flush());
+    BOOST_CHECK(!pclaimTrie->getClaimById(claimId, sFound, found));
+    BOOST_CHECK(pclaimTrie->WriteToDisk());
+    BOOST_CHECK(!pclaimTrie->getClaimById(claimId, sFound, found));
+}
+
+BOOST_AUTO_TEST_CASE(claimtrie_parallel_merkle_hash)
+{
+    LOCK(cs_main);
+    std::vector<std::pair<std::string, CClaimValue> > claims;
+    const char* names[] = {"a", "ab", "abc", "b", "ba", "bb", "c", "d", "da", "x", "xyz"};
+    for (unsigned int i = 0; i < ARRAYLEN(names); ++i) {
+        COutPoint outPoint(ArithToUint256(arith_uint256(0xbeef00 + i)), i);
+        CClaimValue claim(outPoint, ClaimIdHash(outPoint.hash, outPoint.n), 10 + i, 1, 1, "", names[i]);
+        claims.push_back(std::make_pair(std::string(names[i]), claim));
+    }
+
+    CClaimTrieCache cacheBase(pclaimTrie, false);
+    for (unsigned int i = 0; i < 4; ++i)
+        BOOST_CHECK(cacheBase.insertClaimIntoTrie(claims[i].first, claims[i].second));
+    BOOST_CHECK(cacheBase.flush());
+
+    // Subtrees hashed on the queue must give the same root as the serial walk.
+    uint256 hashes[2];
+    for (int nThreads = 0; nThreads < 2; ++nThreads) {
+        nClaimTrieHashThreads = nThreads * 2;
+        CClaimTrieCache trieCache(pclaimTrie, false);
+        for (unsigned int i = 4; i < claims.size(); ++i)
+            BOOST_CHECK(trieCache.insertClaimIntoTrie(claims[i].first, claims[i].second));
+        hashes[nThreads] = trieCache.getMerkleHash();
+        BOOST_CHECK(hashes[nThreads] == trieCache.getMerkleHash());
+    }
+    nClaimTrieHashThreads = 0;
+    BOOST_CHECK(hashes[0] == hashes[1]);
+    BOOST_CHECK(hashes[0] != pclaimTrie->getMerkleHash());
+
+    CClaimTrieCache cacheRemove(pclaimTrie, false);
+    CClaimValue removed;
+    for (unsigned int i = 0; i < 4; ++i)
+        BOOST_CHECK(cacheRemove.removeClaimFromTrie(claims[i].first, claims[i].second.outPoint, removed));
+    BOOST_CHECK(cacheRemove.flush());
+}
+
+static bool ProofsEqual(const CClaimTrieProof& a, const CClaimTrieProof& b)
+{
+    if (a.hasValue != b.hasValue || a.nodes.size() != b.nodes.size())
+        return false;
+    if (a.hasValue && (a.outPoint != b.outPoint || a.nHeightOfLastTakeover != b.nHeightOfLastTakeover))
+        return false;
+    for (unsigned int i = 0; i < a.nodes.size(); ++i) {
+        if (a.nodes[i].children != b.nodes[i].children || a.nodes[i].hasValue != b.nodes[i].hasValue || a.nodes[i].valHash != b.nodes[i].valHash)
+            return false;
+    }
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(claimtrie_history_proofs)
+{
+    LOCK(cs_main);
+    const char* names[] = {"hist", "histo", "hx"};
+    const unsigned int nNames = ARRAYLEN(names);
+    std::vector<CClaimValue> claims;
+    for (unsigned int i = 0; i < nNames; ++i) {
+        COutPoint outPoint(ArithToUint256(arith_uint256(0xfeed00 + i)), i);
+        claims.push_back(CClaimValue(outPoint, ClaimIdHash(outPoint.hash, outPoint.n), 10 + i, 1, 1, "", names[i]));
+    }
+
+    // Blocks 0-2 add a claim each, block 3 spends the first one again.
+    insertUndoType insertUndo, insertSupportUndo;
+    claimQueueRowType expireUndo;
+    supportQueueRowType expireSupportUndo;
+    std::vector<std::pair<std::string, int> > takeoverHeightUndo;
+    std::vector<int> heights;
+    std::vector<std::vector<CClaimTrieProof> > proofs;
+    for (unsigned int n = 0; n < 4; ++n) {
+        insertUndo.clear();
+        expireUndo.clear();
+        insertSupportUndo.clear();
+        expireSupportUndo.clear();
+        takeoverHeightUndo.clear();
+        CClaimTrieCache trieCache(pclaimTrie);
+        CClaimValue removed;
+        if (n < nNames)
+            BOOST_CHECK(trieCache.insertClaimIntoTrie(names[n], claims[n], true));
+        else
+            BOOST_CHECK(trieCache.removeClaimFromTrie(names[0], claims[0].outPoint, removed, true));
+        BOOST_CHECK(trieCache.incrementBlock(insertUndo, expireUndo, insertSupportUndo, expireSupportUndo, takeoverHeightUndo));
+        BOOST_CHECK(trieCache.flush());
+        // Keep some of the history on disk and some of it dirty
+        if (n == 1)
+            BOOST_CHECK(pclaimTrie->WriteToDisk());
+        heights.push_back(pclaimTrie->nCurrentHeight - 1);
+        CClaimTrieCache proofCache(pclaimTrie);
+        proofs.push_back(std::vector<CClaimTrieProof>());
+        for (unsigned int i = 0; i < nNames; ++i)
+            proofs.back().push_back(proofCache.getProofForName(names[i]));
+    }
+    BOOST_CHECK(!proofs[0][1].hasValue && proofs[2][1].hasValue && !proofs[3][0].hasValue);
+
+    for (int nPass = 0; nPass < 2; ++nPass) {
+        for (unsigned int n = 0; n < heights.size(); ++n) {
+            for (unsigned int i = 0; i < nNames; ++i) {
+                CClaimTrieProof proof;
+                BOOST_CHECK(pclaimTrie->getProofForName(names[i], heights[n], proof));
+                BOOST_CHECK_MESSAGE(ProofsEqual(proof, proofs[n][i]), "block " << n << " name " << names[i]);
+            }
+        }
+        BOOST_CHECK(pclaimTrie->WriteToDisk());
+    }
+    CClaimTrieProof proof;
+    BOOST_CHECK(!pclaimTrie->getProofForName(names[0], heights[3] + 1, proof));
+
+    // Disconnecting the last block drops its history
+    CClaimTrieCache trieCache(pclaimTrie);
+    BOOST_CHECK(trieCache.decrementBlock(insertUndo, expireUndo, insertSupportUndo, expireSupportUndo, takeoverHeightUndo));
+    BOOST_CHECK(trieCache.insertClaimIntoTrie(names[0], claims[0], false));
+    BOOST_CHECK(trieCache.finalizeDecrement());
+    BOOST_CHECK(trieCache.flush());
+    BOOST_CHECK(!pclaimTrie->getProofForName(names[0], heights[3], proof));
+    for (unsigned int n = 0; n < 3; ++n) {
+        for (unsigned int i = 0; i < nNames; ++i) {
+            BOOST_CHECK(pclaimTrie->getProofForName(names[i], heights[n], proof));
+            BOOST_CHECK_MESSAGE(ProofsEqual(proof, proofs[n][i]), "block " << n << " name " << names[i]);
+        }
+    }
+
+    // Blocks deeper than -claimtriehistory can not be proven
+    pclaimTrie->setHistoryDepth(1);
+    BOOST_CHECK(pclaimTrie->getProofForName(names[0], heights[1], proof));
+    BOOST_CHECK(!pclaimTrie->getProofForName(names[0], heights[0], proof));
+
+    // And the next block drops every version below the new horizon
+    insertUndo.clear();
+    expireUndo.clear();
+    insertSupportUndo.clear();
+    expireSupportUndo.clear();
+    takeoverHeightUndo.clear();
+    CClaimTrieCache pruneCache(pclaimTrie);
+    BOOST_CHECK(pruneCache.incrementBlock(insertUndo, expireUndo, insertSupportUndo, expireSupportUndo, takeoverHeightUndo));
+    BOOST_CHECK(pruneCache.flush());
+    BOOST_CHECK(pclaimTrie->WriteToDisk());
+    boost::scoped_ptr<CDBIterator> pcursor(pclaimTrie->db.NewIterator());
+    std::pair<char, CBigEndianHeight> key;
+    for (pcursor->Seek(NODE_VERSION_ROW); pcursor->Valid() && pcursor->GetKey(key) && key.first == NODE_VERSION_ROW; pcursor->Next())
+        BOOST_CHECK(key.second.nHeight > pclaimTrie->nCurrentHeight - 1);
+    pclaimTrie->setHistoryDepth(DEFAULT_CLAIMTRIE_HISTORY);
+}
+
+BOOST_AUTO_TEST_CASE(claimtrie_paged_nodes)
+{
+    LOCK(cs_main);
+    const char* names[] = {"p", "page", "paged", "pager", "q", "qr"};
+    const unsigned int nNames = ARRAYLEN(names);
+    std::vector<CClaimValue> claims;
+    CClaimTrieCache cacheInsert(pclaimTrie, false);
+    for (unsigned int i = 0; i < nNames; ++i) {
+        COutPoint outPoint(ArithToUint256(arith_uint256(0xabba00 + i)), i);
+        claims.push_back(CClaimValue(outPoint, ClaimIdHash(outPoint.hash, outPoint.n), 10 + i, 1, 1, "", names[i]));
+        BOOST_CHECK(cacheInsert.insertClaimIntoTrie(names[i], claims[i]));
+    }
+    BOOST_CHECK(cacheInsert.flush());
+    BOOST_CHECK(pclaimTrie->WriteToDisk());
+    uint256 hash = pclaimTrie->getMerkleHash();
+
+    // The first pass only clears the access bits
+    pclaimTrie->setCacheSize(1);
+    BOOST_CHECK(pclaimTrie->WriteToDisk());
+    BOOST_CHECK(pclaimTrie->WriteToDisk());
+    const CClaimTrieNode* node = pclaimTrie->getNodeForName("p");
+    BOOST_CHECK(node && !node->children.loaded());
+    BOOST_CHECK(pclaimTrie->getMerkleHash() == hash);
+    BOOST_CHECK(pclaimTrie->checkConsistency());
+
+    // Only the full check reads the nodes left on disk, and it does not keep them
+    CClaimTrieNode onDisk;
+    BOOST_CHECK(pclaimTrie->db.Read(std::make_pair(TRIE_NODE, std::string("pager")), onDisk));
+    CClaimTrieNode corrupt(onDisk);
+    corrupt.hash = uint256();
+    BOOST_CHECK(pclaimTrie->db.Write(std::make_pair(TRIE_NODE, std::string("pager")), corrupt));
+    BOOST_CHECK(pclaimTrie->checkConsistency());
+    BOOST_CHECK(!pclaimTrie->checkConsistency(true));
+    BOOST_CHECK(pclaimTrie->db.Write(std::make_pair(TRIE_NODE, std::string("pager")), onDisk));
+    BOOST_CHECK(pclaimTrie->checkConsistency(true));
+    BOOST_CHECK(!node->children.loaded());
+
+    // Reading the evicted nodes brings them back from disk
+    CClaimValue claim;
+    BOOST_CHECK(pclaimTrie->getInfoForName("pager", claim) && claim.outPoint == claims[3].outPoint);
+    BOOST_CHECK_EQUAL(pclaimTrie->getTotalNamesInTrie(), nNames);
+    BOOST_CHECK(pclaimTrie->checkConsistency());
+
+    // And so does changing them
+    BOOST_CHECK(pclaimTrie->WriteToDisk());
+    BOOST_CHECK(pclaimTrie->WriteToDisk());
+    CClaimTrieCache cacheRemove(pclaimTrie, false);
+    CClaimValue removed;
+    BOOST_CHECK(cacheRemove.removeClaimFromTrie("paged", claims[2].outPoint, removed));
+    BOOST_CHECK(cacheRemove.flush());
+    BOOST_CHECK(pclaimTrie->WriteToDisk());
+    BOOST_CHECK(!pclaimTrie->getInfoForName("paged", claim));
+    BOOST_CHECK(pclaimTrie->getInfoForName("pager", claim) && claim.outPoint == claims[3].outPoint);
+    BOOST_CHECK_EQUAL(pclaimTrie->getTotalNamesInTrie(), nNames - 1);
+    BOOST_CHECK(pclaimTrie->checkConsistency());
+    BOOST_CHECK(pclaimTrie->getMerkleHash() != hash);
+    pclaimTrie->setCacheSize(0);
+}
+
+BOOST_AUTO_TEST_CASE(claimtrie_parallel_merkle_hash_paged)
+{
+    LOCK(cs_main);
+    const char* names[] = {"a", "ab", "abc", "b", "ba", "bb", "c", "ca", "d", "da", "x", "xyz"};
+    const unsigned int nNames = ARRAYLEN(names);
+    CClaimTrieCache cacheInsert(pclaimTrie, false);
+    for (unsigned int i = 0; i < nNames; ++i) {
+        COutPoint outPoint(ArithToUint256(arith_uint256(0xfeed00 + i)), i);
+        CClaimValue claim(outPoint, ClaimIdHash(outPoint.hash, outPoint.n), 100 + i, 1, 1, "", names[i]);
+        BOOST_CHECK(cacheInsert.insertClaimIntoTrie(names[i], claim));
+    }
+    BOOST_CHECK(cacheInsert.flush());
+    BOOST_CHECK(pclaimTrie->WriteToDisk());
+
+    boost::thread_group threadGroup;
+    for (int i = 0; i < 2; ++i)
+        threadGroup.create_thread(&ThreadClaimTrieHash);
+
+    // Add a smaller claim to every name, so that every subtree is dirty and
+    // the workers look up the takeover heights in the paged base trie.
+    uint256 hashes[2];
+    for (int nThreads = 2; nThreads >= 0; nThreads -= 2) {
+        pclaimTrie->setCacheSize(1);
+        BOOST_CHECK(pclaimTrie->WriteToDisk());
+        BOOST_CHECK(pclaimTrie->WriteToDisk());
+        BOOST_CHECK(!pclaimTrie->getNodeForName("")->children.begin()->second->children.loaded());
+
+        nClaimTrieHashThreads = nThreads;
+        CClaimTrieCache trieCache(pclaimTrie, true);
+        for (unsigned int i = 0; i < nNames; ++i) {
+            COutPoint outPoint(ArithToUint256(arith_uint256(0xfeef00 + i)), i);
+            CClaimValue claim(outPoint, ClaimIdHash(outPoint.hash, outPoint.n), 1, 1, 1, "", names[i]);
+            BOOST_CHECK(trieCache.insertClaimIntoTrie(names[i], claim));
+        }
+        hashes[nThreads / 2] = trieCache.getMerkleHash();
+    }
+    nClaimTrieHashThreads = 0;
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    BOOST_CHECK(hashes[0] == hashes[1]);
+    BOOST_CHECK(hashes[0] != pclaimTrie->getMerkleHash());
+    BOOST_CHECK(pclaimTrie->checkConsistency());
+    pclaimTrie->setCacheSize(0);
+}
+
+BOOST_AUTO_TEST_CASE(claimtrie_nodes_from)
+{
+    LOCK(cs_main);
+    const char* names[] = {"n", "na", "nab", "nb", "o", "oa"};
+    const unsigned int nNames = ARRAYLEN(names);
+    CClaimTrieCache cacheInsert(pclaimTrie, false);
+    for (unsigned int i = 0; i < nNames; ++i) {
+        COutPoint outPoint(ArithToUint256(arith_uint256(0xcafe00 + i)), i);
+        CClaimValue claim(outPoint, ClaimIdHash(outPoint.hash, outPoint.n), 10 + i, 1, 1, "", names[i]);
+        BOOST_CHECK(cacheInsert.insertClaimIntoTrie(names[i], claim));
+    }
+    BOOST_CHECK(cacheInsert.flush());
+
+    // Walking in pages of any size visits the same nodes as flattenTrie
+    std::vector<namedNodeType> flat = pclaimTrie->flattenTrie();
+    for (size_t nLimit = 1; nLimit <= flat.size() + 1; ++nLimit) {
+        std::vector<namedNodeType> all;
+        std::string startName;
+        bool fMore = true;
+        while (fMore) {
+            std::vector<namedNodeType> nodes;
+            std::string nextName;
+            fMore = pclaimTrie->getNodesFrom(startName, nLimit, false, nodes, nextName);
+            BOOST_CHECK(nodes.size() <= nLimit);
+            all.insert(all.end(), nodes.begin(), nodes.end());
+            startName = nextName;
+        }
+        BOOST_CHECK_EQUAL(all.size(), flat.size());
+        for (size_t i = 0; i < all.size() && i < flat.size(); ++i)
+            BOOST_CHECK_EQUAL(all[i].first, flat[i].first);
+    }
+
+    // Claims only skips the inner nodes without a claim and starts mid-trie
+    std::vector<namedNodeType> nodes;
+    std::string nextName;
+    BOOST_CHECK(pclaimTrie->getNodesFrom("nab", 2, true, nodes, nextName));
+    BOOST_CHECK_EQUAL(nodes.size(), 2U);
+    BOOST_CHECK_EQUAL(nodes[0].first, "nab");
+    BOOST_CHECK_EQUAL(nodes[1].first, "nb");
+    BOOST_CHECK_EQUAL(nextName, "o");
+    BOOST_CHECK(!nodes[0].second.empty() && !nodes[1].second.empty());
+}
+
+static bool QueueRowHasClaim(const claimQueueRowType& row, const std::string& name, const COutPoint& outPoint)
+{
+    for (claimQueueRowType::const_iterator it = row.begin(); it != row.end(); ++it)
+        if (it->first == name && it->second.outPoint == outPoint)
+            return true;
+    return false;
+}
+
+BOOST_AUTO_TEST_CASE(claimtrie_queue_entries)
+{
+    LOCK(cs_main);
+    int nHeight = pclaimTrie->nCurrentHeight;
+    COutPoint a(ArithToUint256(arith_uint256(0xbeef01)), 0);
+    COutPoint b(ArithToUint256(arith_uint256(0xbeef02)), 1);
+    CClaimTrieCache cacheAdd(pclaimTrie);
+    BOOST_CHECK(cacheAdd.addClaim("queued", a, ClaimIdHash(a.hash, a.n), 10, nHeight, ""));
+    BOOST_CHECK(cacheAdd.addClaim("queued", b, ClaimIdHash(b.hash, b.n), 20, nHeight, ""));
+    BOOST_CHECK(cacheAdd.flush());
+
+    queueNameRowType nameRow;
+    BOOST_CHECK(pclaimTrie->getQueueNameRow("queued", nameRow));
+    BOOST_CHECK_EQUAL(nameRow.size(), 2U);
+    int nValidAtHeight = nameRow[0].nHeight;
+    claimQueueRowType row;
+    BOOST_CHECK(pclaimTrie->getQueueRow(nValidAtHeight, row));
+    BOOST_CHECK_EQUAL(row.size(), 2U);
+
+    // The rows read back from their entries once they are no longer dirty
+    BOOST_CHECK(pclaimTrie->WriteToDisk());
+    BOOST_CHECK(pclaimTrie->getQueueNameRow("queued", nameRow));
+    BOOST_CHECK_EQUAL(nameRow.size(), 2U);
+    BOOST_CHECK(pclaimTrie->getQueueRow(nValidAtHeight, row));
+    BOOST_CHECK_EQUAL(row.size(), 2U);
+    BOOST_CHECK(QueueRowHasClaim(row, "queued", a) && QueueRowHasClaim(row, "queued", b));
+
+    // Taking one claim out leaves the other entry alone
+    CClaimTrieCache cacheUndo(pclaimTrie);
+    BOOST_CHECK(cacheUndo.undoAddClaim("queued", b, nHeight));
+    BOOST_CHECK(cacheUndo.flush());
+    BOOST_CHECK(pclaimTrie->WriteToDisk());
+    BOOST_CHECK(pclaimTrie->getQueueNameRow("queued", nameRow));
+    BOOST_CHECK_EQUAL(nameRow.size(), 1U);
+    BOOST_CHECK(nameRow[0].outPoint == a);
+    BOOST_CHECK(pclaimTrie->getQueueRow(nValidAtHeight, row));
+    BOOST_CHECK_EQUAL(row.size(), 1U);
+    BOOST_CHECK(QueueRowHasClaim(row, "queued", a));
+
+    // And an empty row has no entries left
+    CClaimTrieCache cacheUndoAll(pclaimTrie);
+    BOOST_CHECK(cacheUndoAll.undoAddClaim("queued", a, nHeight));
+    BOOST_CHECK(cacheUndoAll.flush());
+    BOOST_CHECK(pclaimTrie->WriteToDisk());
+    BOOST_CHECK(!pclaimTrie->getQueueNameRow("queued", nameRow));
+    BOOST_CHECK(!pclaimTrie->getQueueRow(nValidAtHeight, row));
+    BOOST_CHECK(pclaimTrie->queueEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(claimtrie_db_version)
+{
+    LOCK(cs_main);
+    CClaimTrie trie(true, false, 1);
+
+    // A row of the old layout is rewritten as entries
+    COutPoint a(ArithToUint256(arith_uint256(0xbeef03)), 0);
+    claimQueueRowType oldRow;
+    oldRow.push_back(std::make_pair(std::string("old"), CClaimValue(a, ClaimIdHash(a.hash, a.n), 10, 5, 7, "", "old")));
+    BOOST_CHECK(trie.db.Write(std::make_pair(CLAIM_QUEUE_ROW, 7), oldRow));
+    BOOST_CHECK(trie.ReadFromDisk());
+    claimQueueRowType row;
+    BOOST_CHECK(trie.getQueueRow(7, row));
+    BOOST_CHECK_EQUAL(row.size(), 1U);
+    BOOST_CHECK(QueueRowHasClaim(row, "old", a));
+    BOOST_CHECK(!trie.db.Exists(std::make_pair(CLAIM_QUEUE_ROW, 7)));
+    int nVersion = 0;
+    BOOST_CHECK(trie.db.Read(TRIE_DB_VERSION, nVersion));
+    BOOST_CHECK_EQUAL(nVersion, CLAIMTRIE_DB_VERSION);
+
+    // A row that can not be read stops the upgrade and is left on disk
+    BOOST_CHECK(trie.db.Write(std::make_pair(CLAIM_QUEUE_ROW, 8), std::string("x")));
+    BOOST_CHECK(!trie.ReadFromDisk());
+    BOOST_CHECK(trie.db.Exists(std::make_pair(CLAIM_QUEUE_ROW, 8)));
+    BOOST_CHECK(trie.db.Erase(std::make_pair(CLAIM_QUEUE_ROW, 8)));
+    BOOST_CHECK(trie.ReadFromDisk());
+
+    // A database written by a newer layout is refused
+    BOOST_CHECK(trie.db.Write(TRIE_DB_VERSION, CLAIMTRIE_DB_VERSION + 1));
+    BOOST_CHECK(!trie.ReadFromDisk());
+}
+
+BOOST_AUTO_TEST_CASE(claimtrie_claimid_index_upgrade)
+{
+    LOCK(cs_main);
+    CClaimTrie trie(true, false, 1);
+
+    // A claim written before the claimId index was kept is indexed on start
+    COutPoint a(ArithToUint256(arith_uint256(0xbeef04)), 0);
+    uint160 claimId = ClaimIdHash(a.hash, a.n);
+    CClaimTrieNode node;
+    node.claims.push_back(CClaimValue(a, claimId, 10, 5, 5, "", "i"));
+    BOOST_CHECK(trie.db.Write(std::make_pair(TRIE_NODE, std::string("i")), node));
+    BOOST_CHECK(trie.ReadFromDisk());
+    std::string name;
+    CClaimValue claim;
+    BOOST_CHECK(trie.getClaimById(claimId, name, claim));
+    BOOST_CHECK_EQUAL(name, "i");
+    BOOST_CHECK(claim.outPoint == a);
+    int nVersion = 0;
+    BOOST_CHECK(trie.db.Read(TRIE_DB_VERSION, nVersion));
+    BOOST_CHECK_EQUAL(nVersion, CLAIMTRIE_DB_VERSION);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
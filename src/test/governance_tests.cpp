@@ -0,0 +1,95 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-object.h"
+#include "governance-vote.h"
+#include "key.h"
+#include "masternodeman.h"
+#include "random.h"
+#include "streams.h"
+#include "utiltime.h"
+
+#include "test/test_ulord.h"
+
+#include <boost/test/unit_test.hpp>
+
+// Votes are checked against the global masternode list, which is emptied again afterwards
+struct GovernanceTestingSetup : public TestingSetup {
+    ~GovernanceTestingSetup()
+    {
+        mnodeman.Clear();
+        SetMockTime(0);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(governance_tests, GovernanceTestingSetup)
+
+static bool Vote(CGovernanceObject& govobj, const CMasternode& mn, CKey& keyMasternode,
+                 vote_signal_enum_t eSignal, vote_outcome_enum_t eOutcome)
+{
+    CGovernanceVote vote(mn.vin, govobj.GetHash(), eSignal, eOutcome);
+    CPubKey pubKeyMasternode = keyMasternode.GetPubKey();
+    BOOST_CHECK(vote.Sign(keyMasternode, pubKeyMasternode));
+    CGovernanceException exception;
+    return govobj.ProcessVoteForTest(vote, exception);
+}
+
+BOOST_AUTO_TEST_CASE(governance_vote_tally)
+{
+    std::vector<CMasternode> vecMasternodes;
+    std::vector<CKey> vecKeys(4);
+    for (size_t i = 0; i < vecKeys.size(); i++) {
+        vecMasternodes.push_back(MakeTestMasternode(vecKeys[i]));
+        BOOST_CHECK(mnodeman.Add(vecMasternodes.back()));
+    }
+
+    CGovernanceObject govobj(uint256(), 1, GetAdjustedTime(), GetRandHash(), "");
+    BOOST_CHECK(govobj.IsVoteTallyConsistent());
+
+    // Added votes
+    BOOST_CHECK(Vote(govobj, vecMasternodes[0], vecKeys[0], VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES));
+    BOOST_CHECK(Vote(govobj, vecMasternodes[1], vecKeys[1], VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES));
+    BOOST_CHECK(Vote(govobj, vecMasternodes[2], vecKeys[2], VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO));
+    BOOST_CHECK(Vote(govobj, vecMasternodes[3], vecKeys[3], VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_ABSTAIN));
+    BOOST_CHECK(Vote(govobj, vecMasternodes[0], vecKeys[0], VOTE_SIGNAL_VALID, VOTE_OUTCOME_YES));
+    BOOST_CHECK(govobj.IsVoteTallyConsistent());
+    BOOST_CHECK_EQUAL(govobj.GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(govobj.GetAbstainCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_VALID), 1);
+
+    // A vote signed with the wrong key is rejected
+    BOOST_CHECK(!Vote(govobj, vecMasternodes[1], vecKeys[0], VOTE_SIGNAL_DELETE, VOTE_OUTCOME_YES));
+    BOOST_CHECK(govobj.IsVoteTallyConsistent());
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_DELETE), 0);
+
+    // Replaced votes, once the rate limit has passed
+    SetMockTime(GetTime() + GOVERNANCE_UPDATE_MIN + 1);
+    BOOST_CHECK(Vote(govobj, vecMasternodes[1], vecKeys[1], VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO));
+    BOOST_CHECK(Vote(govobj, vecMasternodes[3], vecKeys[3], VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES));
+    BOOST_CHECK(govobj.IsVoteTallyConsistent());
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_FUNDING), 2);
+    BOOST_CHECK_EQUAL(govobj.GetNoCount(VOTE_SIGNAL_FUNDING), 2);
+    BOOST_CHECK_EQUAL(govobj.GetAbstainCount(VOTE_SIGNAL_FUNDING), 0);
+
+    // Removed votes, when their masternode leaves the list
+    mnodeman.Find(vecMasternodes[0].vin)->nActiveState = CMasternode::MASTERNODE_OUTPOINT_SPENT;
+    RemoveSpentMasternodes(mnodeman);
+    BOOST_CHECK(!mnodeman.Has(vecMasternodes[0].vin));
+    govobj.ClearMasternodeVotesForTest();
+    BOOST_CHECK(govobj.IsVoteTallyConsistent());
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(govobj.GetNoCount(VOTE_SIGNAL_FUNDING), 2);
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_VALID), 0);
+
+    // The tally is rebuilt when the object is read back
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << govobj;
+    CGovernanceObject govobjRead;
+    ss >> govobjRead;
+    BOOST_CHECK(govobjRead.IsVoteTallyConsistent());
+    BOOST_CHECK_EQUAL(govobjRead.GetYesCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(govobjRead.GetNoCount(VOTE_SIGNAL_FUNDING), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
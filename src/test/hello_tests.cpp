@@ -0,0 +1,287 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arith_uint256.h"
+#include "hello/PoW.h"
+#include "hello/kernels.h"
+#include "hello/oneWayFunction.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "streams.h"
+#include "utilstrencodings.h"
+#include "test/test_ulord.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(hello_tests, BasicTestingSetup)
+
+// Outputs of the original scalar helloHash for the inputs built by
+// KnownAnswerInput(k).
+static const char* knownAnswers[] = {
+    "f61f7ccd5ae44f72bc78f07c5795b45e7faaed2792cc7c371fc462db7b77b9b7",
+    "2f8fe144959b9cdb04f442c01d2fdf52d99ceb73c26d92c59ee4451e4db49721",
+    "2edc056b7cc3b1a548e2b893ea73f2fb8784c6152fa55deb57d170f91d7e89f8",
+    "96c1466dc45a68d51561b418333c2638bc441e7de5192cf161a129b9c686616c",
+    "1d93cacb68f1cd37f4e084030f7315bb2c8c9676eb255d3e4582ac59e75692f8",
+};
+
+// Outputs of the funcInfor one-way functions, in table order, for the 32
+// byte input (i * 29 + 3). A regression corpus for reworking them.
+static const char* oneWayKnownAnswers[FUNCTION_NUM] = {
+    "711654ad7b538b4b922dc6ba3b1324c0465e37abc64e0782394de4446fdc9964", // SHA3-256
+    "6063d2f2c098369f13f956e6b4182eda74e6422faccdcdf77d35163e80a24450", // SHA1
+    "2a4a594f111a869ac960d455a5f4f0a714eb6603e86edea4009dd3e37770f24f", // SHA256
+    "a6b948489b4245a7b76a6129556743ea7c3690a8466c28a6497157bddc8ab93f", // SHA512
+    "671e7fb991462747eff761924c96719a28ee181d8837fb4350420ebb0b8e0b20", // Whirlpool
+    "2440202ff01bf75cfe5fcfc696824b36c4df3e782f3c7a45d46a764c28b0f09b", // RIPEMD-160
+    "daabc129113bc02ca5dd6c5ca500c3cbe4bebae1efcfe7cf01fc9aabf4adfda1", // BLAKE2s(256bits)
+    "9df091ed346bd64bf5bba7e1d46f6abef0f61348144adb8b044b9a396fb8dbfa", // AES(128bits)
+    "40c652047a888aebef41c6ab9858a73f7714ab10986fd016d2bc44efef998728", // DES
+    "ad22ccbc30e33d86a6878c9e7366f59fef02585fd1c5ba69166cbd4daecb05b8", // RC4
+    "3c12aacb4de057664cc335acc478ee4e11b7feefef4e2bc1c743cdd59d4b196b", // Camellia(128bits)
+    "4c22dc1ed78c53a5d010839cd13a32b50ebd26f181dfc6bea1d1994757f0b443", // CRC32
+    "f8e21faf362a1eb57dc0c995c3085a58e6d5999053156ecb06873c7d433b356f", // HMAC(MD5)
+    "48d58b2797b3bfc57914b29f6e8e3f0a3ea0c91a6aef01733fcbd567f3fd2759", // GOST R 34.11-94
+    "949b31eebbcd4a2b518698bf8bc986aea26c9e238a853c5db811dcaf94a5a15c", // HAVAL-256/5
+    "c6fc9933d82866cc035815cacced6ca6a6cb9c4baa604172b983f5fcb49e7947", // Skein-512(256bits)
+};
+
+static void KnownAnswerInput(uint8_t input[INPUT_LEN], int k)
+{
+    for (int i = 0; i < INPUT_LEN; ++i)
+        input[i] = (uint8_t)(i * 31 + k * 7 + k * k);
+}
+
+static std::vector<helloImpl> SupportedImpls()
+{
+    std::vector<helloImpl> impls;
+    for (int impl = 0; impl < HELLO_IMPL_NUM; ++impl)
+        if (helloImplSupported((helloImpl)impl))
+            impls.push_back((helloImpl)impl);
+    return impls;
+}
+
+static void RandomBytes(uint8_t* data, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+        data[i] = (uint8_t)insecure_rand();
+}
+
+BOOST_AUTO_TEST_CASE(hello_known_answers)
+{
+    helloInit();
+    const helloImpl best = helloBestImpl();
+    std::vector<helloImpl> impls = SupportedImpls();
+    for (size_t n = 0; n < impls.size(); ++n) {
+        BOOST_CHECK(helloSelectImpl(impls[n]));
+        for (int k = 0; k < (int)ARRAYLEN(knownAnswers); ++k) {
+            uint8_t input[INPUT_LEN], output[OUTPUT_LEN];
+            KnownAnswerInput(input, k);
+            helloHash(input, INPUT_LEN, output);
+            BOOST_CHECK_MESSAGE(HexStr(output, output + OUTPUT_LEN) == knownAnswers[k],
+                helloActiveKernels->name << " answer " << k);
+        }
+    }
+    helloSelectImpl(best);
+}
+
+BOOST_AUTO_TEST_CASE(hello_oneway_known_answers)
+{
+    helloInit();
+    uint8_t input[OUTPUT_LEN];
+    for (int i = 0; i < OUTPUT_LEN; ++i)
+        input[i] = (uint8_t)(i * 29 + 3);
+    for (int n = 0; n < FUNCTION_NUM; ++n) {
+        uint8_t output[OUTPUT_LEN] = {};
+        funcInfor[n].func(input, OUTPUT_LEN, output);
+        BOOST_CHECK_MESSAGE(HexStr(output, output + OUTPUT_LEN) == oneWayKnownAnswers[n], funcInfor[n].funcName);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(hello_oneway_fixed32_matches_generic)
+{
+    for (int round = 0; round < 256; ++round) {
+        uint8_t input[OUTPUT_LEN];
+        RandomBytes(input, sizeof(input));
+        for (int n = 0; n < FUNCTION_NUM; ++n) {
+            uint8_t expected[OUTPUT_LEN], output[OUTPUT_LEN];
+            funcInfor[n].func(input, OUTPUT_LEN, expected);
+            funcInfor[n].func32(input, output);
+            BOOST_CHECK_MESSAGE(memcmp(output, expected, OUTPUT_LEN) == 0, funcInfor[n].funcName);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(hello_rrs32_matches_rrs)
+{
+    std::vector<helloImpl> impls = SupportedImpls();
+    for (int round = 0; round < 16; ++round) {
+        uint8_t input[OUTPUT_LEN];
+        RandomBytes(input, sizeof(input));
+        for (uint32_t bits = 0; bits < 256; ++bits) {
+            uint8_t expected[OUTPUT_LEN];
+            rrs(input, OUTPUT_LEN, expected, bits);
+            for (size_t n = 0; n < impls.size(); ++n) {
+                const helloKernels* kernels = helloGetKernels(impls[n]);
+                uint8_t output[OUTPUT_LEN];
+                kernels->rrs32(input, output, bits);
+                BOOST_CHECK_MESSAGE(memcmp(output, expected, OUTPUT_LEN) == 0,
+                    kernels->name << " rrs32 bits=" << bits);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(hello_fill_rows_matches_reference)
+{
+    const uint32_t count = 127, first = 129;
+    std::vector<helloImpl> impls = SupportedImpls();
+    for (int round = 0; round < 8; ++round) {
+        struct my_rand48_data seeded[4];
+        for (int j = 0; j < 4; ++j) {
+            uint64_t seed;
+            RandomBytes((uint8_t*)&seed, sizeof(seed));
+            my_seed48_r(seed, &seeded[j]);
+        }
+        uint8_t a0[OUTPUT_LEN];
+        RandomBytes(a0, sizeof(a0));
+
+        // The loop initWorkMemory used to run for the rows between reseeds.
+        struct my_rand48_data refBuffer[4];
+        memcpy(refBuffer, seeded, sizeof(refBuffer));
+        uint8_t refA[OUTPUT_LEN];
+        memcpy(refA, a0, sizeof(refA));
+        std::vector<uint8_t> refMem((first + count) * OUTPUT_LEN, 0);
+        for (uint32_t i = first; i < first + count; ++i) {
+            uint8_t b[OUTPUT_LEN], result[OUTPUT_LEN], shift_num;
+            for (int j = 0; j < 4; ++j) {
+                uint64_t num = 0;
+                my_rand64_r(&refBuffer[j], &num);
+                memcpy(b + (j << 3), (uint8_t*)&num, 8);
+            }
+            reduce_bit((uint8_t*)&i, 4, &shift_num, 8);
+            rrs(b, OUTPUT_LEN, result, shift_num);
+            memcpy(&refMem[i << 5], result, OUTPUT_LEN);
+            for (int j = 0; j < OUTPUT_LEN; ++j)
+                refA[j] ^= result[j];
+        }
+
+        for (size_t n = 0; n < impls.size(); ++n) {
+            const helloKernels* kernels = helloGetKernels(impls[n]);
+            struct my_rand48_data buffer[4];
+            memcpy(buffer, seeded, sizeof(buffer));
+            uint8_t a[OUTPUT_LEN];
+            memcpy(a, a0, sizeof(a));
+            std::vector<uint8_t> mem(refMem.size(), 0);
+            kernels->fillRows(buffer, &mem[0], first, count, a);
+
+            BOOST_CHECK_MESSAGE(mem == refMem, kernels->name << " rows");
+            BOOST_CHECK_MESSAGE(memcmp(a, refA, OUTPUT_LEN) == 0, kernels->name << " accumulator");
+            for (int j = 0; j < 4; ++j)
+                BOOST_CHECK_MESSAGE(buffer[j].__x == refBuffer[j].__x, kernels->name << " stream " << j);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(hello_xor_rows_matches_reference)
+{
+    std::vector<helloImpl> impls = SupportedImpls();
+    std::vector<uint8_t> rows(256 * OUTPUT_LEN);
+    RandomBytes(&rows[0], rows.size());
+    uint8_t start[OUTPUT_LEN];
+    RandomBytes(start, sizeof(start));
+
+    for (uint32_t count = 0; count <= 256; count += 37) {
+        uint8_t expected[OUTPUT_LEN];
+        memcpy(expected, start, OUTPUT_LEN);
+        for (uint32_t i = 0; i < count; ++i)
+            for (int k = 0; k < OUTPUT_LEN; ++k)
+                expected[k] ^= rows[i * OUTPUT_LEN + k];
+
+        for (size_t n = 0; n < impls.size(); ++n) {
+            const helloKernels* kernels = helloGetKernels(impls[n]);
+            uint8_t result[OUTPUT_LEN];
+            memcpy(result, start, OUTPUT_LEN);
+            kernels->xorRows(result, &rows[0], count);
+            BOOST_CHECK_MESSAGE(memcmp(result, expected, OUTPUT_LEN) == 0,
+                kernels->name << " xorRows count=" << count);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(hello_batch_matches_single)
+{
+    // Nonce bytes chosen so that the increments carry across bytes.
+    uint8_t header[INPUT_LEN];
+    KnownAnswerInput(header, 7);
+    memset(header + INPUT_LEN - 32, 0xff, 3);
+    header[INPUT_LEN - 29] = 0xfe;
+
+    const uint32_t count = 2 * HELLO_BATCH_LANES + 1;
+    std::vector<uint8_t> batch(count * OUTPUT_LEN);
+    helloContext* ctx = helloCreateContext();
+    helloHashBatch(ctx, header, count, &batch[0]);
+
+    for (uint32_t k = 0; k < count; ++k) {
+        uint8_t input[INPUT_LEN], output[OUTPUT_LEN];
+        memcpy(input, header, INPUT_LEN);
+        arith_uint256 nonce = UintToArith256(uint256(std::vector<unsigned char>(input + INPUT_LEN - 32, input + INPUT_LEN)));
+        uint256 next = ArithToUint256(nonce + k);
+        memcpy(input + INPUT_LEN - 32, next.begin(), 32);
+        helloHash(input, INPUT_LEN, output);
+        BOOST_CHECK_MESSAGE(memcmp(output, &batch[k * OUTPUT_LEN], OUTPUT_LEN) == 0, "nonce offset " << k);
+    }
+
+    // A target equal to one of the hashes must find it or an earlier one.
+    uint32_t offset = count;
+    uint8_t hash[OUTPUT_LEN];
+    const uint8_t* target = &batch[(count - 1) * OUTPUT_LEN];
+    BOOST_CHECK(helloScanNonces(ctx, header, count, target, &offset, hash));
+    BOOST_CHECK(offset < count);
+    BOOST_CHECK(memcmp(hash, &batch[offset * OUTPUT_LEN], OUTPUT_LEN) == 0);
+    BOOST_CHECK(UintToArith256(uint256(std::vector<unsigned char>(hash, hash + OUTPUT_LEN))) <=
+                UintToArith256(uint256(std::vector<unsigned char>(target, target + OUTPUT_LEN))));
+
+    uint8_t zero[OUTPUT_LEN] = {};
+    BOOST_CHECK(!helloScanNonces(ctx, header, count, zero, &offset, hash));
+    helloFreeContext(ctx);
+}
+
+BOOST_AUTO_TEST_CASE(hello_block_hash_cache)
+{
+    CBlockHeader header;
+    header.nVersion = 1;
+    header.nTime = 1524057440;
+    header.nBits = 0x1f00ffff;
+    header.nNonce = GetRandHash();
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << header;
+    uint256 expected;
+    helloHash((const uint8_t*)&ss[0], INPUT_LEN, expected.begin());
+
+    CBlockHashCacheStats before = GetBlockHashCacheStats();
+    BOOST_CHECK(header.GetHash() == expected);
+    BOOST_CHECK(header.GetHash() == expected);
+    CBlockHashCacheStats after = GetBlockHashCacheStats();
+    BOOST_CHECK_EQUAL(after.nMisses, before.nMisses + 1);
+    BOOST_CHECK_EQUAL(after.nHits, before.nHits + 1);
+    BOOST_CHECK(after.nSize <= after.nMaxSize);
+
+    // Mutating the header must not return the cached hash.
+    header.nTime++;
+    BOOST_CHECK(header.GetHash() != expected);
+    BOOST_CHECK_EQUAL(GetBlockHashCacheStats().nMisses, before.nMisses + 2);
+
+    // A zero size disables the cache.
+    SetBlockHashCacheSize(0);
+    BOOST_CHECK(header.GetHash() != expected);
+    BOOST_CHECK_EQUAL(GetBlockHashCacheStats().nSize, 0U);
+    BOOST_CHECK_EQUAL(GetBlockHashCacheStats().nMisses, before.nMisses + 3);
+    SetBlockHashCacheSize(DEFAULT_BLOCK_HASH_CACHE_SIZE);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,226 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arith_uint256.h"
+#include "key.h"
+#include "main.h"
+#include "masternodeman.h"
+#include "random.h"
+#include "streams.h"
+
+#include "test/test_ulord.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternodeman_tests, TestingSetup)
+
+// Every masternode in vecMasternodes is found by each of its keys
+static void CheckLookups(CMasternodeMan& man, const std::vector<CMasternode>& vecMasternodes)
+{
+    BOOST_CHECK_EQUAL(man.size(), (int)vecMasternodes.size());
+    for (size_t i = 0; i < vecMasternodes.size(); i++) {
+        const CMasternode& mn = vecMasternodes[i];
+        CMasternode* pmn = man.Find(mn.vin);
+        BOOST_CHECK(pmn && pmn->vin == mn.vin);
+        pmn = man.Find(mn.pubKeyMasternode);
+        BOOST_CHECK(pmn && pmn->vin == mn.vin);
+        pmn = man.Find(GetScriptForDestination(mn.payeeAddress.Get()));
+        BOOST_CHECK(pmn && pmn->vin == mn.vin);
+    }
+}
+
+// The ranks agree with each other and cover every masternode
+static void CheckRanks(CMasternodeMan& man)
+{
+    std::vector<std::pair<int, CMasternode> > vecRanks = man.GetMasternodeRanks(0);
+    BOOST_CHECK_EQUAL(vecRanks.size(), (size_t)man.size());
+    for (size_t i = 0; i < vecRanks.size(); i++) {
+        BOOST_CHECK_EQUAL(vecRanks[i].first, (int)i + 1);
+        BOOST_CHECK_EQUAL(man.GetMasternodeRank(vecRanks[i].second.vin, 0), (int)i + 1);
+        CMasternode* pmn = man.GetMasternodeByRank(i + 1, 0);
+        BOOST_CHECK(pmn && pmn->vin == vecRanks[i].second.vin);
+    }
+}
+
+// The ranking the list used to compute on every call: score each eligible
+// masternode on its own and sort, best score first, ties by outpoint
+static std::vector<CTxIn> RankByScore(CMasternodeMan& man, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
+{
+    uint256 blockHash;
+    BOOST_REQUIRE(GetBlockHash(blockHash, nBlockHeight));
+    std::vector<CMasternode> vecMasternodes = man.GetFullMasternodeVector();
+    std::vector<std::pair<int64_t, CTxIn> > vecScores;
+    for (size_t i = 0; i < vecMasternodes.size(); i++) {
+        CMasternode& mn = vecMasternodes[i];
+        if (mn.nProtocolVersion < nMinProtocol)
+            continue;
+        if (fOnlyActive ? !mn.IsEnabled() : !mn.IsValidForPayment())
+            continue;
+        vecScores.push_back(std::make_pair((int64_t)mn.CalculateScore(blockHash).GetCompact(false), mn.vin));
+    }
+    std::sort(vecScores.rbegin(), vecScores.rend());
+
+    std::vector<CTxIn> vecRanked;
+    for (size_t i = 0; i < vecScores.size(); i++)
+        vecRanked.push_back(vecScores[i].second);
+    return vecRanked;
+}
+
+// Every rank lookup agrees with RankByScore()
+static void CheckRanksByScore(CMasternodeMan& man, int nMinProtocol)
+{
+    std::vector<CTxIn> vecActive = RankByScore(man, 0, nMinProtocol, true);
+    std::vector<CTxIn> vecPayable = RankByScore(man, 0, nMinProtocol, false);
+
+    std::vector<std::pair<int, CMasternode> > vecRanks = man.GetMasternodeRanks(0, nMinProtocol);
+    BOOST_REQUIRE_EQUAL(vecRanks.size(), vecActive.size());
+    for (size_t i = 0; i < vecRanks.size(); i++) {
+        BOOST_CHECK_EQUAL(vecRanks[i].first, (int)i + 1);
+        BOOST_CHECK(vecRanks[i].second.vin == vecActive[i]);
+        CMasternode* pmn = man.GetMasternodeByRank(i + 1, 0, nMinProtocol);
+        BOOST_CHECK(pmn && pmn->vin == vecActive[i]);
+    }
+    BOOST_CHECK(!man.GetMasternodeByRank(vecActive.size() + 1, 0, nMinProtocol));
+
+    // masternodes that are not eligible have no rank
+    std::vector<CMasternode> vecMasternodes = man.GetFullMasternodeVector();
+    for (size_t i = 0; i < vecMasternodes.size(); i++) {
+        const CTxIn& vin = vecMasternodes[i].vin;
+        std::vector<CTxIn>::iterator it = std::find(vecActive.begin(), vecActive.end(), vin);
+        BOOST_CHECK_EQUAL(man.GetMasternodeRank(vin, 0, nMinProtocol, true), it == vecActive.end() ? -1 : int(it - vecActive.begin()) + 1);
+        it = std::find(vecPayable.begin(), vecPayable.end(), vin);
+        BOOST_CHECK_EQUAL(man.GetMasternodeRank(vin, 0, nMinProtocol, false), it == vecPayable.end() ? -1 : int(it - vecPayable.begin()) + 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(masternodeman_ranks_match_scores)
+{
+    CMasternodeMan man;
+    std::vector<CMasternode> vecMasternodes;
+    CKey key;
+    for (int i = 0; i < 16; i++) {
+        vecMasternodes.push_back(MakeTestMasternode(key));
+        BOOST_CHECK(man.Add(vecMasternodes.back()));
+    }
+
+    // Scores only depend on outpoint hash + n, so these pairs tie
+    uint256 hash = GetRandHash();
+    const COutPoint vTied[] = {COutPoint(hash, 1), COutPoint(ArithToUint256(UintToArith256(hash) + 1), 0),
+                               COutPoint(hash, 7), COutPoint(ArithToUint256(UintToArith256(hash) + 3), 4)};
+    for (size_t i = 0; i < sizeof(vTied) / sizeof(vTied[0]); i++) {
+        CMasternode mn = MakeTestMasternode(key);
+        mn.vin = CTxIn(vTied[i]);
+        vecMasternodes.push_back(mn);
+        BOOST_CHECK(man.Add(vecMasternodes.back()));
+    }
+    uint256 blockHash;
+    BOOST_REQUIRE(GetBlockHash(blockHash, 0));
+    BOOST_CHECK(man.Find(CTxIn(vTied[0]))->CalculateScore(blockHash) == man.Find(CTxIn(vTied[1]))->CalculateScore(blockHash));
+    BOOST_CHECK(man.Find(CTxIn(vTied[2]))->CalculateScore(blockHash) == man.Find(CTxIn(vTied[3]))->CalculateScore(blockHash));
+
+    CheckRanksByScore(man, 0);
+    CheckRanksByScore(man, PROTOCOL_VERSION);
+
+    // Inactive masternodes, one of them still paid, and older protocols, one
+    // of each tied pair among them. The cached order is filtered as it stands.
+    man.Find(vecMasternodes[0].vin)->nActiveState = CMasternode::MASTERNODE_EXPIRED;
+    man.Find(vecMasternodes[1].vin)->nActiveState = CMasternode::MASTERNODE_POSE_BAN;
+    man.Find(vecMasternodes[2].vin)->nActiveState = CMasternode::MASTERNODE_WATCHDOG_EXPIRED;
+    man.Find(CTxIn(vTied[0]))->nActiveState = CMasternode::MASTERNODE_NEW_START_REQUIRED;
+    man.Find(vecMasternodes[3].vin)->nProtocolVersion = PROTOCOL_VERSION - 1;
+    man.Find(vecMasternodes[4].vin)->nProtocolVersion = PROTOCOL_VERSION - 1;
+    man.Find(CTxIn(vTied[3]))->nProtocolVersion = PROTOCOL_VERSION - 1;
+    BOOST_CHECK_EQUAL(man.RankCacheSize(), 1U);
+
+    CheckRanksByScore(man, 0);
+    CheckRanksByScore(man, PROTOCOL_VERSION);
+    BOOST_CHECK_EQUAL(man.GetMasternodeRanks(0, PROTOCOL_VERSION).size(), vecMasternodes.size() - 7);
+}
+
+BOOST_AUTO_TEST_CASE(masternodeman_rank_cache)
+{
+    CMasternodeMan man;
+    CKey key;
+    for (int i = 0; i < 5; i++) {
+        CMasternode mn = MakeTestMasternode(key);
+        BOOST_CHECK(man.Add(mn));
+    }
+
+    // The first lookup ranks the list for the block, the ones after reuse it
+    BOOST_CHECK_EQUAL(man.RankCacheSize(), 0U);
+    CheckRanks(man);
+    BOOST_CHECK_EQUAL(man.RankCacheSize(), 1U);
+    CheckRanks(man);
+    BOOST_CHECK_EQUAL(man.RankCacheSize(), 1U);
+
+    // Adding a masternode drops the ranking, which then includes it
+    CMasternode mnNew = MakeTestMasternode(key);
+    BOOST_CHECK(man.Add(mnNew));
+    BOOST_CHECK_EQUAL(man.RankCacheSize(), 0U);
+    CheckRanks(man);
+    BOOST_CHECK(man.GetMasternodeRank(mnNew.vin, 0) > 0);
+
+    // And so does removing one
+    man.Find(mnNew.vin)->nActiveState = CMasternode::MASTERNODE_OUTPOINT_SPENT;
+    RemoveSpentMasternodes(man);
+    BOOST_CHECK_EQUAL(man.RankCacheSize(), 0U);
+    CheckRanks(man);
+    BOOST_CHECK_EQUAL(man.GetMasternodeRank(mnNew.vin, 0), -1);
+
+    // Masternodes that are no longer enabled are skipped without reranking
+    CMasternode* pmnBest = man.GetMasternodeByRank(1, 0);
+    BOOST_CHECK(pmnBest);
+    CTxIn vinBest = pmnBest->vin;
+    pmnBest->nActiveState = CMasternode::MASTERNODE_EXPIRED;
+    BOOST_CHECK_EQUAL(man.GetMasternodeRank(vinBest, 0), -1);
+    BOOST_CHECK_EQUAL(man.GetMasternodeRanks(0).size(), (size_t)man.size() - 1);
+    BOOST_CHECK(man.GetMasternodeByRank(1, 0)->vin != vinBest);
+    BOOST_CHECK_EQUAL(man.RankCacheSize(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(masternodeman_lookup_indexes)
+{
+    CMasternodeMan man;
+    std::vector<CMasternode> vecMasternodes;
+    CKey key;
+    for (int i = 0; i < 5; i++) {
+        vecMasternodes.push_back(MakeTestMasternode(key));
+        BOOST_CHECK(man.Add(vecMasternodes.back()));
+    }
+    CheckLookups(man, vecMasternodes);
+    BOOST_CHECK(!man.Add(vecMasternodes[0]));
+
+    // Removing one shifts the positions of the masternodes after it
+    CMasternode mnRemoved = vecMasternodes[1];
+    man.Find(mnRemoved.vin)->nActiveState = CMasternode::MASTERNODE_OUTPOINT_SPENT;
+    RemoveSpentMasternodes(man);
+    vecMasternodes.erase(vecMasternodes.begin() + 1);
+    CheckLookups(man, vecMasternodes);
+    BOOST_CHECK(!man.Find(mnRemoved.vin));
+    BOOST_CHECK(!man.Find(mnRemoved.pubKeyMasternode));
+    BOOST_CHECK(!man.Find(GetScriptForDestination(mnRemoved.payeeAddress.Get())));
+
+    // A newer broadcast with another masternode key moves the key index
+    CKey keyNew;
+    keyNew.MakeNewKey(true);
+    CPubKey pubKeyOld = vecMasternodes[2].pubKeyMasternode;
+    CMasternodeBroadcast mnb(vecMasternodes[2]);
+    mnb.pubKeyMasternode = keyNew.GetPubKey();
+    mnb.sigTime = vecMasternodes[2].sigTime + 1;
+    man.UpdateMasternodeList(mnb);
+    vecMasternodes[2].pubKeyMasternode = keyNew.GetPubKey();
+    CheckLookups(man, vecMasternodes);
+    BOOST_CHECK(!man.Find(pubKeyOld));
+
+    // The indexes are rebuilt when the list is read back
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << man;
+    CMasternodeMan manRead;
+    ss >> manRead;
+    CheckLookups(manRead, vecMasternodes);
+    BOOST_CHECK(!manRead.Find(mnRemoved.vin));
+    CheckRanks(manRead);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,297 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "hash.h"
+#include "main.h"
+#include "net.h"
+#include "spork.h"
+#include "utiltime.h"
+#include "version.h"
+
+#include "test/test_ulord.h"
+
+#include <atomic>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(net_tests, BasicTestingSetup)
+
+namespace {
+
+/** A complete message on the wire: header followed by payload. */
+std::vector<char> MakeMessage(const char* pszCommand, const std::vector<char>& vPayload)
+{
+    CMessageHeader hdr(Params().MessageStart(), pszCommand, vPayload.size());
+    uint256 hash = Hash(vPayload.begin(), vPayload.end());
+    memcpy(&hdr.nChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << hdr;
+    std::vector<char> vMsg(ss.begin(), ss.end());
+    vMsg.insert(vMsg.end(), vPayload.begin(), vPayload.end());
+    return vMsg;
+}
+
+/** Feed vMsg to msg in nChunk byte pieces, like CNode::ReceiveMsgBytes. */
+bool Receive(CNetMessage& msg, const std::vector<char>& vMsg, unsigned int nChunk)
+{
+    unsigned int nPos = 0;
+    while (nPos < vMsg.size()) {
+        unsigned int nBytes = std::min(nChunk, (unsigned int)vMsg.size() - nPos);
+        int nHandled = msg.in_data ? msg.readData(&vMsg[nPos], nBytes) : msg.readHeader(&vMsg[nPos], nBytes);
+        if (nHandled < 0)
+            return false;
+        nPos += nHandled;
+    }
+    return msg.complete();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(netmessage_receive)
+{
+    std::vector<char> vPayload;
+    for (int i = 0; i < 1000; i++)
+        vPayload.push_back((char)i);
+    std::vector<char> vMsg = MakeMessage("ping", vPayload);
+
+    // headers and payloads split at awkward places are put back together
+    const unsigned int vChunks[] = {1, 7, 24, 25, 500, 100000};
+    for (unsigned int i = 0; i < sizeof(vChunks) / sizeof(vChunks[0]); i++) {
+        CNetMessage msg(Params().MessageStart(), SER_NETWORK, PROTOCOL_VERSION);
+        BOOST_CHECK(Receive(msg, vMsg, vChunks[i]));
+        BOOST_CHECK_EQUAL(msg.hdr.GetCommand(), "ping");
+        BOOST_CHECK_EQUAL(msg.hdr.nMessageSize, vPayload.size());
+        BOOST_CHECK(std::vector<char>(msg.vRecv.begin(), msg.vRecv.end()) == vPayload);
+    }
+
+    // a message without payload is complete after its header
+    CNetMessage msgEmpty(Params().MessageStart(), SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK(Receive(msgEmpty, MakeMessage("verack", std::vector<char>()), 24));
+    BOOST_CHECK(msgEmpty.vRecv.empty());
+
+    // a header claiming more than MAX_SIZE is rejected
+    CMessageHeader hdr(Params().MessageStart(), "block", MAX_SIZE + 1);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << hdr;
+    CNetMessage msgHuge(Params().MessageStart(), SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK_EQUAL(msgHuge.readHeader(&ss[0], ss.size()), -1);
+}
+
+BOOST_AUTO_TEST_CASE(netmessage_receive_large)
+{
+    // an odd size, so no buffer in the pool fits it
+    std::vector<char> vPayload(4 * 1024 * 1024 + 17);
+    for (size_t i = 0; i < vPayload.size(); i++)
+        vPayload[i] = (char)(i * 7);
+    std::vector<char> vMsg = MakeMessage("block", vPayload);
+
+    // small reads, as from a slow peer, and count how often the buffer moves
+    CNetMessage msg(Params().MessageStart(), SER_NETWORK, PROTOCOL_VERSION);
+    const unsigned int nChunk = 1000;
+    unsigned int nPos = 0, nMoves = 0;
+    const char* pchLast = NULL;
+    while (nPos < vMsg.size()) {
+        unsigned int nBytes = std::min(nChunk, (unsigned int)vMsg.size() - nPos);
+        int nHandled = msg.in_data ? msg.readData(&vMsg[nPos], nBytes) : msg.readHeader(&vMsg[nPos], nBytes);
+        BOOST_REQUIRE(nHandled > 0);
+        nPos += nHandled;
+        if (!msg.vRecv.empty() && &msg.vRecv[0] != pchLast) {
+            pchLast = &msg.vRecv[0];
+            nMoves++;
+        }
+    }
+    BOOST_CHECK(msg.complete());
+    BOOST_CHECK(std::vector<char>(msg.vRecv.begin(), msg.vRecv.end()) == vPayload);
+
+    // growth doubles the buffer, so a few dozen moves at most, not one per step,
+    // and it stops at the size of the message
+    BOOST_CHECK(nMoves <= 32);
+    BOOST_CHECK(nMoves == 1 || msg.vRecv.capacity() == msg.hdr.nMessageSize);
+}
+
+BOOST_AUTO_TEST_CASE(netmessage_buffer_reuse)
+{
+    // a size no other test leaves in the pool
+    std::vector<char> vPayload(12345, 'x');
+    std::vector<char> vMsg = MakeMessage("mnp", vPayload);
+
+    const char* pchBuffer;
+    {
+        CNetMessage msg(Params().MessageStart(), SER_NETWORK, PROTOCOL_VERSION);
+        BOOST_CHECK(Receive(msg, vMsg, 4096));
+        pchBuffer = &msg.vRecv[0];
+    }
+
+    // the next message of that size gets the same buffer back
+    {
+        CNetMessage msg(Params().MessageStart(), SER_NETWORK, PROTOCOL_VERSION);
+        BOOST_CHECK(Receive(msg, vMsg, 4096));
+        BOOST_CHECK(&msg.vRecv[0] == pchBuffer);
+        BOOST_CHECK(std::vector<char>(msg.vRecv.begin(), msg.vRecv.end()) == vPayload);
+
+        // a stream that took the buffer over returns it too
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        std::swap(stream, msg.vRecv);
+        ReleaseRecvBuffer(stream);
+        BOOST_CHECK(stream.empty());
+    }
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    GetRecvBuffer(stream, vPayload.size());
+    stream.write(&vPayload[0], vPayload.size());
+    BOOST_CHECK(&stream[0] == pchBuffer);
+    ReleaseRecvBuffer(stream);
+}
+
+static void AppendMessageWork(std::vector<int>* pvDone, int n)
+{
+    pvDone->push_back(n);
+}
+
+/** Wait for the message workers to finish with pnode and drop their references. */
+static bool WaitForMessageWork(CNode* pnode, int nRefCount)
+{
+    for (int i = 0; i < 1000 && (pnode->nMessagesInFlight > 0 || pnode->GetRefCount() != nRefCount); i++)
+        MilliSleep(10);
+    return pnode->nMessagesInFlight == 0 && pnode->GetRefCount() == nRefCount;
+}
+
+/** Hold a message worker until *pfRelease is set. */
+static void BlockMessageWorker(const std::atomic<bool>* pfRelease)
+{
+    while (!*pfRelease)
+        MilliSleep(1);
+}
+
+/** The first nProcessed of vHashes are gone from setAskFor and the rest are still there. */
+static bool CheckProcessedInOrder(CNode* pnode, const std::vector<uint256>& vHashes, size_t nProcessed)
+{
+    LOCK(cs_main);
+    for (size_t i = 0; i < vHashes.size(); i++) {
+        if (pnode->setAskFor.count(vHashes[i]) != (i < nProcessed ? 0U : 1U))
+            return false;
+    }
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(message_workers)
+{
+    CNode node(INVALID_SOCKET, CAddress(CService("127.0.0.1", 0), NODE_NETWORK), "", true);
+    int nRefCount = node.GetRefCount();
+    std::vector<int> vDone;
+
+    // Without workers the caller processes the message itself
+    BOOST_CHECK(!QueueMessageWork(&node, boost::bind(&AppendMessageWork, &vDone, -1)));
+    BOOST_CHECK_EQUAL(node.nMessagesInFlight, 0);
+    BOOST_CHECK_EQUAL(node.GetRefCount(), nRefCount);
+
+    // The node's work runs in the order it was queued, and the node is
+    // released once it has
+    boost::thread_group threadGroup;
+    StartMessageWorkers(threadGroup, 1);
+    for (int i = 0; i < 10; i++)
+        BOOST_CHECK(QueueMessageWork(&node, boost::bind(&AppendMessageWork, &vDone, i)));
+    BOOST_CHECK(WaitForMessageWork(&node, nRefCount));
+    BOOST_CHECK_EQUAL(vDone.size(), 10U);
+    for (size_t i = 0; i < vDone.size(); i++)
+        BOOST_CHECK_EQUAL(vDone[i], (int)i);
+
+    // Work for a disconnected node is skipped but still releases it
+    node.fDisconnect = true;
+    BOOST_CHECK(QueueMessageWork(&node, boost::bind(&AppendMessageWork, &vDone, 10)));
+    BOOST_CHECK(WaitForMessageWork(&node, nRefCount));
+    BOOST_CHECK_EQUAL(vDone.size(), 10U);
+    node.fDisconnect = false;
+
+    // Work still queued when the workers stop is released by StopMessageWorkers
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    BOOST_CHECK(QueueMessageWork(&node, boost::bind(&AppendMessageWork, &vDone, 11)));
+    BOOST_CHECK_EQUAL(node.nMessagesInFlight, 1);
+    BOOST_CHECK_EQUAL(node.GetRefCount(), nRefCount + 1);
+    StopMessageWorkers();
+    BOOST_CHECK_EQUAL(node.nMessagesInFlight, 0);
+    BOOST_CHECK_EQUAL(node.GetRefCount(), nRefCount);
+    BOOST_CHECK_EQUAL(vDone.size(), 10U);
+    BOOST_CHECK(!QueueMessageWork(&node, boost::bind(&AppendMessageWork, &vDone, 12)));
+}
+
+BOOST_FIXTURE_TEST_CASE(message_workers_peers, TestingSetup)
+{
+    // Unsigned sporks go to the message workers, and ProcessSpork() takes
+    // each one's hash out of setAskFor before it rejects the signature, so
+    // setAskFor shows which of a peer's messages have been processed.
+    const int nPeers = 3;
+    const int nMessages = 4;
+    std::vector<CNode*> vPeers;
+    std::vector<std::vector<uint256> > vHashes(nPeers);
+    for (int i = 0; i < nPeers; i++) {
+        vPeers.push_back(new CNode(INVALID_SOCKET, CAddress(CService("127.0.0.1", 0), NODE_NETWORK), "", true));
+        CNode* pnode = vPeers.back();
+        pnode->nVersion = PROTOCOL_VERSION;
+        pnode->fSuccessfullyConnected = true;
+        for (int j = 0; j < nMessages; j++) {
+            CSporkMessage spork(SPORK_9_SUPERBLOCKS_ENABLED, i * nMessages + j, GetTime());
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << spork;
+            std::vector<char> vMsg = MakeMessage(NetMsgType::SPORK, std::vector<char>(ss.begin(), ss.end()));
+            {
+                LOCK(pnode->cs_vRecvMsg);
+                BOOST_CHECK(pnode->ReceiveMsgBytes(&vMsg[0], vMsg.size()));
+            }
+            LOCK(cs_main);
+            pnode->setAskFor.insert(spork.GetHash());
+            vHashes[i].push_back(spork.GetHash());
+        }
+    }
+
+    // Both workers are held, so everything queued after them stays in flight
+    boost::thread_group threadGroup;
+    StartMessageWorkers(threadGroup, 2);
+    CNode nodeBlocker(INVALID_SOCKET, CAddress(CService("127.0.0.1", 0), NODE_NETWORK), "", true);
+    int nRefCount = nodeBlocker.GetRefCount();
+    std::atomic<bool> fRelease(false);
+    for (int i = 0; i < 2; i++)
+        BOOST_CHECK(QueueMessageWork(&nodeBlocker, boost::bind(&BlockMessageWorker, &fRelease)));
+
+    // Each peer has one message dispatched, and none while that one is in
+    // flight, however often the handler comes back to it
+    for (int n = 0; n < 3; n++) {
+        for (int i = 0; i < nPeers; i++) {
+            LOCK(vPeers[i]->cs_vRecvMsg);
+            BOOST_CHECK(ProcessMessages(vPeers[i]));
+            BOOST_CHECK_EQUAL(vPeers[i]->vRecvMsg.size(), (size_t)nMessages - 1);
+            BOOST_CHECK_EQUAL(vPeers[i]->nMessagesInFlight, 1);
+            BOOST_CHECK(!vPeers[i]->HasMessagesToProcess());
+        }
+    }
+    for (int i = 0; i < nPeers; i++)
+        BOOST_CHECK(CheckProcessedInOrder(vPeers[i], vHashes[i], 0));
+    fRelease = true;
+
+    // The peers' messages run side by side on the workers, but each peer
+    // only ever has one in flight and they finish in the order received
+    for (int j = 1; j <= nMessages; j++) {
+        for (int i = 0; i < nPeers; i++) {
+            BOOST_CHECK(WaitForMessageWork(vPeers[i], nRefCount));
+            BOOST_CHECK(CheckProcessedInOrder(vPeers[i], vHashes[i], j));
+            LOCK(vPeers[i]->cs_vRecvMsg);
+            BOOST_CHECK_EQUAL(vPeers[i]->HasMessagesToProcess(), j < nMessages);
+            BOOST_CHECK(ProcessMessages(vPeers[i]));
+            BOOST_CHECK_EQUAL(vPeers[i]->vRecvMsg.size(), (size_t)std::max(nMessages - j - 1, 0));
+            BOOST_CHECK(vPeers[i]->nMessagesInFlight <= 1);
+        }
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    StopMessageWorkers();
+    BOOST_CHECK(WaitForMessageWork(&nodeBlocker, nRefCount));
+    for (int i = 0; i < nPeers; i++)
+        delete vPeers[i];
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,12 +4,15 @@
 
 #include "chain.h"
 #include "chainparams.h"
+#include "main.h"
 #include "pow.h"
 #include "random.h"
+#include "timedata.h"
 #include "util.h"
 #include "test/test_ulord.h"
 
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
 
 using namespace std;
 
@@ -96,4 +99,146 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+/** A chain of nCount headers on regtest difficulty, each meeting its target */
+static std::vector<CBlockHeader> MakeHeaderChain(size_t nCount)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    std::vector<CBlockHeader> headers(nCount);
+    for (size_t i = 0; i < headers.size(); i++) {
+        headers[i].nVersion = 1;
+        headers[i].hashPrevBlock = i ? headers[i - 1].GetHash() : GetRandHash();
+        headers[i].nTime = 1524057440 + i;
+        headers[i].nBits = 0x207fffff;
+        while (!CheckProofOfWork(headers[i].GetHash(), headers[i].nBits, params))
+            headers[i].nNonce = ArithToUint256(UintToArith256(headers[i].nNonce) + 1);
+    }
+    return headers;
+}
+
+/** Check the hashes of the first nHashed headers and that the rest were left alone */
+static void CheckHeaderHashes(const std::vector<CBlockHeader>& headers, size_t nHashed, const std::vector<uint256>& vHashes, const std::vector<char>& vPoWValid)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    BOOST_CHECK_EQUAL(vHashes.size(), headers.size());
+    BOOST_CHECK_EQUAL(vPoWValid.size(), headers.size());
+    for (size_t i = 0; i < headers.size(); i++) {
+        if (i < nHashed) {
+            BOOST_CHECK(vHashes[i] == headers[i].GetHash());
+            BOOST_CHECK_EQUAL((bool)vPoWValid[i], CheckProofOfWork(vHashes[i], headers[i].nBits, params));
+        } else {
+            BOOST_CHECK(vHashes[i].IsNull());
+            BOOST_CHECK(!vPoWValid[i]);
+        }
+    }
+}
+
+/* Hashes computed ahead of AcceptBlockHeader must match the serial checks */
+BOOST_AUTO_TEST_CASE(check_headers_proof_of_work)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    std::vector<CBlockHeader> headers = MakeHeaderChain(8);
+    std::vector<uint256> vHashes;
+    std::vector<char> vPoWValid;
+
+    BOOST_CHECK_EQUAL(CheckHeadersProofOfWork(headers, headers.size(), vHashes, vPoWValid), headers.size());
+    CheckHeaderHashes(headers, headers.size(), vHashes, vPoWValid);
+
+    // Headers past nCount are left unhashed.
+    BOOST_CHECK_EQUAL(CheckHeadersProofOfWork(headers, 3, vHashes, vPoWValid), 3U);
+    CheckHeaderHashes(headers, 3, vHashes, vPoWValid);
+
+    // Without check threads hashing stops at the first header that does not
+    // build on the one before it, or misses its target.
+    std::vector<CBlockHeader> vBroken(headers);
+    vBroken[5].hashPrevBlock = GetRandHash();
+    BOOST_CHECK_EQUAL(CheckHeadersProofOfWork(vBroken, vBroken.size(), vHashes, vPoWValid), 5U);
+    CheckHeaderHashes(vBroken, 6, vHashes, vPoWValid);
+
+    std::vector<CBlockHeader> vNoWork(headers);
+    vNoWork[4].nBits = 0x1d00ffff;
+    BOOST_CHECK_EQUAL(CheckHeadersProofOfWork(vNoWork, vNoWork.size(), vHashes, vPoWValid), 4U);
+    CheckHeaderHashes(vNoWork, 5, vHashes, vPoWValid);
+    BOOST_CHECK(!vPoWValid[4]);
+    SelectParams(CBaseChainParams::MAIN);
+}
+
+/* The same on the header check threads, one round of headers per thread */
+BOOST_AUTO_TEST_CASE(check_headers_proof_of_work_threads)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    std::vector<CBlockHeader> headers = MakeHeaderChain(12);
+    std::vector<uint256> vHashes;
+    std::vector<char> vPoWValid;
+
+    boost::thread_group threadGroup;
+    nScriptCheckThreads = 3;
+    for (int i = 0; i < nScriptCheckThreads - 1; i++)
+        threadGroup.create_thread(&ThreadHeaderCheck);
+
+    BOOST_CHECK_EQUAL(CheckHeadersProofOfWork(headers, headers.size(), vHashes, vPoWValid), headers.size());
+    CheckHeaderHashes(headers, headers.size(), vHashes, vPoWValid);
+
+    // A break in the chain stops hashing after the round it is in
+    std::vector<CBlockHeader> vBroken(headers);
+    vBroken[7].hashPrevBlock = GetRandHash();
+    BOOST_CHECK_EQUAL(CheckHeadersProofOfWork(vBroken, vBroken.size(), vHashes, vPoWValid), 7U);
+    CheckHeaderHashes(vBroken, 9, vHashes, vPoWValid);
+
+    // So does a header missing its target, with valid headers around it
+    std::vector<CBlockHeader> vNoWork(headers);
+    vNoWork[4].nBits = 0x1d00ffff;
+    BOOST_CHECK_EQUAL(CheckHeadersProofOfWork(vNoWork, vNoWork.size(), vHashes, vPoWValid), 4U);
+    CheckHeaderHashes(vNoWork, 6, vHashes, vPoWValid);
+    BOOST_CHECK(vPoWValid[3] && !vPoWValid[4] && vPoWValid[5]);
+
+    // Unrelated headers cost a single round
+    std::vector<CBlockHeader> vJunk(headers);
+    for (size_t i = 1; i < vJunk.size(); i++)
+        vJunk[i].hashPrevBlock = GetRandHash();
+    BOOST_CHECK_EQUAL(CheckHeadersProofOfWork(vJunk, vJunk.size(), vHashes, vPoWValid), 1U);
+    CheckHeaderHashes(vJunk, 3, vHashes, vPoWValid);
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    nScriptCheckThreads = 0;
+    SelectParams(CBaseChainParams::MAIN);
+}
+
+/* Only headers that survive the checks needing no hash go to the PoW queue */
+BOOST_AUTO_TEST_CASE(count_headers_to_precheck)
+{
+    LOCK(cs_main);
+    CBlockIndex index;
+    uint256 hashKnown = GetRandHash();
+    BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(hashKnown, &index)).first;
+    index.phashBlock = &mi->first;
+
+    std::vector<CBlockHeader> headers(6);
+    for (size_t i = 0; i < headers.size(); i++) {
+        headers[i].nTime = GetAdjustedTime();
+        headers[i].hashPrevBlock = i ? GetRandHash() : hashKnown;
+    }
+    BOOST_CHECK_EQUAL(CountHeadersToPrecheck(headers), headers.size());
+    BOOST_CHECK_EQUAL(CountHeadersToPrecheck(std::vector<CBlockHeader>()), 0U);
+
+    // A repeated parent cannot be part of a continuous chain.
+    std::vector<CBlockHeader> vDuplicate(headers);
+    vDuplicate[4].hashPrevBlock = vDuplicate[1].hashPrevBlock;
+    BOOST_CHECK_EQUAL(CountHeadersToPrecheck(vDuplicate), 4U);
+
+    std::vector<CBlockHeader> vFuture(headers);
+    vFuture[2].nTime = GetAdjustedTime() + 3 * 60 * 60;
+    BOOST_CHECK_EQUAL(CountHeadersToPrecheck(vFuture), 2U);
+
+    // Messages that do not connect, or connect to an invalid block, are
+    // rejected at the first header.
+    std::vector<CBlockHeader> vUnconnected(headers);
+    vUnconnected[0].hashPrevBlock = GetRandHash();
+    BOOST_CHECK_EQUAL(CountHeadersToPrecheck(vUnconnected), 0U);
+    index.nStatus |= BLOCK_FAILED_VALID;
+    BOOST_CHECK_EQUAL(CountHeadersToPrecheck(headers), 0U);
+
+    mapBlockIndex.erase(mi);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
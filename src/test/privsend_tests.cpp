@@ -0,0 +1,43 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "key.h"
+#include "privsend.h"
+
+#include "test/test_ulord.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(privsend_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(privsend_verify_message_cache)
+{
+    CKey key, keyOther;
+    key.MakeNewKey(true);
+    keyOther.MakeNewKey(true);
+    CPubKey pubkey = key.GetPubKey();
+
+    std::string strMessage = "127.0.0.1:9671" "1524057440";
+    std::vector<unsigned char> vchSig;
+    BOOST_CHECK(privSendSigner.SignMessage(strMessage, vchSig, key));
+
+    std::string strError;
+    CMessageSigCacheStats before = GetMessageSigCacheStats();
+    BOOST_CHECK(privSendSigner.VerifyMessage(pubkey, vchSig, strMessage, strError));
+    BOOST_CHECK(privSendSigner.VerifyMessage(pubkey, vchSig, strMessage, strError));
+    CMessageSigCacheStats after = GetMessageSigCacheStats();
+    BOOST_CHECK_EQUAL(after.nMisses, before.nMisses + 1);
+    BOOST_CHECK_EQUAL(after.nHits, before.nHits + 1);
+
+    // A cached signature must not vouch for another key, message or signature
+    std::vector<unsigned char> vchSigBad(vchSig);
+    vchSigBad[10] ^= 1;
+    BOOST_CHECK(!privSendSigner.VerifyMessage(keyOther.GetPubKey(), vchSig, strMessage, strError));
+    BOOST_CHECK(!privSendSigner.VerifyMessage(pubkey, vchSig, strMessage + "0", strError));
+    BOOST_CHECK(!privSendSigner.VerifyMessage(pubkey, vchSigBad, strMessage, strError));
+    BOOST_CHECK(!privSendSigner.VerifyMessage(pubkey, std::vector<unsigned char>(), strMessage, strError));
+    BOOST_CHECK_EQUAL(GetMessageSigCacheStats().nHits, after.nHits);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
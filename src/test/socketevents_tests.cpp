@@ -0,0 +1,159 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "netbase.h"
+#include "socketevents.h"
+
+#include "test/test_ulord.h"
+
+#include <map>
+#include <set>
+
+#include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(socketevents_tests, BasicTestingSetup)
+
+namespace {
+
+/** Connected loopback socket pairs; the server ends are non-blocking. */
+class LoopbackPeers
+{
+public:
+    std::vector<SOCKET> vClients;
+    std::vector<SOCKET> vServers;
+
+    explicit LoopbackPeers(int nPeers)
+    {
+        SOCKET hListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        BOOST_REQUIRE(hListen != INVALID_SOCKET);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        BOOST_REQUIRE(bind(hListen, (struct sockaddr*)&addr, len) != SOCKET_ERROR);
+        BOOST_REQUIRE(getsockname(hListen, (struct sockaddr*)&addr, &len) != SOCKET_ERROR);
+        BOOST_REQUIRE(listen(hListen, SOMAXCONN) != SOCKET_ERROR);
+
+        for (int i = 0; i < nPeers; i++) {
+            SOCKET hClient = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            BOOST_REQUIRE(hClient != INVALID_SOCKET);
+            BOOST_REQUIRE(connect(hClient, (struct sockaddr*)&addr, sizeof(addr)) != SOCKET_ERROR);
+            SOCKET hServer = accept(hListen, NULL, NULL);
+            BOOST_REQUIRE(hServer != INVALID_SOCKET);
+            BOOST_REQUIRE(SetSocketNonBlocking(hServer, true));
+            vClients.push_back(hClient);
+            vServers.push_back(hServer);
+        }
+        CloseSocket(hListen);
+    }
+
+    ~LoopbackPeers()
+    {
+        BOOST_FOREACH(SOCKET& s, vClients)
+            CloseSocket(s);
+        BOOST_FOREACH(SOCKET& s, vServers)
+            CloseSocket(s);
+    }
+};
+
+/** Wait until every socket in setExpected was reported, or give up after a second. */
+std::map<SOCKET, int> WaitFor(CSocketEvents& socketEvents, const std::set<SOCKET>& setExpected)
+{
+    std::map<SOCKET, int> mapReady;
+    for (int i = 0; i < 20; i++) {
+        std::vector<std::pair<SOCKET, int> > vReady;
+        BOOST_CHECK(socketEvents.Wait(50, vReady));
+        for (size_t j = 0; j < vReady.size(); j++)
+            mapReady[vReady[j].first] |= vReady[j].second;
+        bool fAll = true;
+        BOOST_FOREACH(SOCKET s, setExpected)
+            fAll = fAll && mapReady.count(s);
+        if (fAll)
+            break;
+    }
+    return mapReady;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(socketevents_backends)
+{
+    BOOST_CHECK(CreateSocketEvents("nonexistent") == NULL);
+    BOOST_FOREACH(const std::string& strName, GetSocketEventsBackends()) {
+        boost::scoped_ptr<CSocketEvents> socketEvents(CreateSocketEvents(strName));
+        BOOST_REQUIRE(socketEvents);
+        BOOST_CHECK_EQUAL(socketEvents->GetName(), strName);
+    }
+    boost::scoped_ptr<CSocketEvents> socketEvents(CreateSocketEvents(DEFAULT_SOCKET_EVENTS));
+    BOOST_CHECK(socketEvents);
+}
+
+// Many idle peers and a few busy ones: only the busy ones may be reported.
+BOOST_AUTO_TEST_CASE(socketevents_many_peers)
+{
+    // stays below FD_SETSIZE so that select() can take part
+    const int nPeers = 200;
+    LoopbackPeers peers(nPeers);
+
+    BOOST_FOREACH(const std::string& strName, GetSocketEventsBackends()) {
+        boost::scoped_ptr<CSocketEvents> socketEvents(CreateSocketEvents(strName));
+        BOOST_REQUIRE(socketEvents);
+        std::vector<int> vPrevEvents(nPeers, -1);
+        std::vector<std::pair<SOCKET, int> > vReady;
+
+        // nothing to report yet
+        for (int i = 0; i < nPeers; i++) {
+            socketEvents->Watch(peers.vServers[i], SOCKET_EVENT_RECV, vPrevEvents[i]);
+            vPrevEvents[i] = SOCKET_EVENT_RECV;
+        }
+        BOOST_CHECK(socketEvents->Wait(0, vReady));
+        BOOST_CHECK(vReady.empty());
+
+        // data arrives for every tenth peer
+        std::set<SOCKET> setBusy;
+        for (int i = 0; i < nPeers; i += 10) {
+            BOOST_CHECK_EQUAL(send(peers.vClients[i], "x", 1, MSG_NOSIGNAL), 1);
+            setBusy.insert(peers.vServers[i]);
+        }
+        for (int i = 0; i < nPeers; i++)
+            socketEvents->Watch(peers.vServers[i], SOCKET_EVENT_RECV, vPrevEvents[i]);
+        std::map<SOCKET, int> mapReady = WaitFor(*socketEvents, setBusy);
+        BOOST_CHECK_EQUAL(mapReady.size(), setBusy.size());
+        for (std::map<SOCKET, int>::const_iterator it = mapReady.begin(); it != mapReady.end(); ++it) {
+            BOOST_CHECK(setBusy.count(it->first));
+            BOOST_CHECK(it->second & SOCKET_EVENT_RECV);
+        }
+
+        // Unread data is reported again by select() but not by epoll, until
+        // more arrives.
+        for (int i = 0; i < nPeers; i++)
+            socketEvents->Watch(peers.vServers[i], SOCKET_EVENT_RECV, vPrevEvents[i]);
+        vReady.clear();
+        BOOST_CHECK(socketEvents->Wait(0, vReady));
+        BOOST_CHECK_EQUAL(vReady.size(), socketEvents->IsEdgeTriggered() ? 0 : setBusy.size());
+
+        // drain, so the next backend starts from idle sockets
+        BOOST_FOREACH(SOCKET s, setBusy) {
+            char ch;
+            BOOST_CHECK_EQUAL(recv(s, &ch, 1, MSG_DONTWAIT), 1);
+        }
+
+        // write interest is reported straight away on a socket with room to send
+        socketEvents->Watch(peers.vServers[0], SOCKET_EVENT_RECV | SOCKET_EVENT_SEND, vPrevEvents[0]);
+        vPrevEvents[0] = SOCKET_EVENT_RECV | SOCKET_EVENT_SEND;
+        for (int i = 1; i < nPeers; i++)
+            socketEvents->Watch(peers.vServers[i], SOCKET_EVENT_RECV, vPrevEvents[i]);
+        std::set<SOCKET> setSend;
+        setSend.insert(peers.vServers[0]);
+        mapReady = WaitFor(*socketEvents, setSend);
+        BOOST_CHECK_EQUAL(mapReady.size(), 1U);
+        BOOST_CHECK(mapReady[peers.vServers[0]] & SOCKET_EVENT_SEND);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
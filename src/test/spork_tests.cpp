@@ -0,0 +1,65 @@
+// Copyright (c) 2016-2018 Ulord Foundation Ltd.
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "base58.h"
+#include "key.h"
+#include "spork.h"
+
+#include "test/test_ulord.h"
+
+#include <atomic>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(spork_tests, BasicTestingSetup)
+
+// Boost.Test checks are not thread safe, so the threads below count failures instead
+static void UpdateSporks(CSporkManager* pmanager, int nSporkID, int nUpdates, std::atomic<int>* pnFailures)
+{
+    for (int i = 1; i <= nUpdates; i++) {
+        if (!pmanager->UpdateSpork(nSporkID, i))
+            (*pnFailures)++;
+    }
+}
+
+// The values written by UpdateSporks() only ever grow
+static void ReadSporks(CSporkManager* pmanager, int nSporkID, int nReads, std::atomic<int>* pnFailures)
+{
+    int64_t nLast = 0;
+    for (int i = 0; i < nReads; i++) {
+        pmanager->IsSporkActive(nSporkID);
+        int64_t nValue = pmanager->GetSporkValue(nSporkID);
+        if (nValue < nLast)
+            (*pnFailures)++;
+        nLast = nValue;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(spork_concurrent_access)
+{
+    CSporkManager manager;
+    CKey key;
+    key.MakeNewKey(true);
+    manager.SetPrivKeyForTest(CBitcoinSecret(key).ToString());
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_9_SUPERBLOCKS_ENABLED), SPORK_9_SUPERBLOCKS_ENABLED_DEFAULT);
+
+    // Writers update sporks while other threads read them, as message
+    // workers and the message handler do
+    const int nUpdates = 50;
+    std::atomic<int> nFailures(0);
+    boost::thread_group threadGroup;
+    threadGroup.create_thread(boost::bind(&UpdateSporks, &manager, SPORK_9_SUPERBLOCKS_ENABLED, nUpdates, &nFailures));
+    threadGroup.create_thread(boost::bind(&UpdateSporks, &manager, SPORK_12_RECONSIDER_BLOCKS, nUpdates, &nFailures));
+    threadGroup.create_thread(boost::bind(&ReadSporks, &manager, SPORK_9_SUPERBLOCKS_ENABLED, nUpdates * 20, &nFailures));
+    threadGroup.create_thread(boost::bind(&ReadSporks, &manager, SPORK_12_RECONSIDER_BLOCKS, nUpdates * 20, &nFailures));
+    threadGroup.join_all();
+
+    BOOST_CHECK_EQUAL(nFailures.load(), 0);
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_9_SUPERBLOCKS_ENABLED), nUpdates);
+    BOOST_CHECK_EQUAL(manager.GetSporkValue(SPORK_12_RECONSIDER_BLOCKS), nUpdates);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 
 #include "streams.h"
 #include "support/allocators/zeroafterfree.h"
+#include "version.h"
 #include "test/test_ulord.h"
 
 #include <boost/assign/std/vector.hpp> // for 'operator+=()'
@@ -64,4 +65,27 @@ BOOST_AUTO_TEST_CASE(streams_serializedata_xor)
             std::string(ds.begin(), ds.end()));  
 }         
 
+BOOST_AUTO_TEST_CASE(streams_view)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << (uint32_t)0x01020304 << std::string("view") << (uint8_t)7;
+    std::vector<char> vch(ss.begin(), ss.end());
+
+    CStreamView view(&vch[0], &vch[0] + vch.size(), SER_NETWORK, PROTOCOL_VERSION);
+    uint32_t n;
+    std::string str;
+    view >> n >> str;
+    BOOST_CHECK_EQUAL(n, 0x01020304U);
+    BOOST_CHECK_EQUAL(str, "view");
+    BOOST_CHECK_EQUAL(view.size(), 1U);
+    BOOST_CHECK(view.begin() == &vch[0] + vch.size() - 1);
+    view.ignore(1);
+    BOOST_CHECK(view.empty());
+
+    // reading past the end throws like CDataStream does
+    uint8_t ch;
+    BOOST_CHECK_THROW(view >> ch, std::ios_base::failure);
+    BOOST_CHECK_THROW(view.ignore(1), std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
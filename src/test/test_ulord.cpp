@@ -6,11 +6,15 @@
 
 #include "test_ulord.h"
 
+#include "base58.h"
 #include "chainparams.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
+#include "crypto/sha256.h"
 #include "key.h"
 #include "main.h"
+#include "masternode-sync.h"
+#include "masternodeman.h"
 #include "miner.h"
 #include "pubkey.h"
 #include "random.h"
@@ -19,6 +23,7 @@
 #include "ui_interface.h"
 #include "rpcserver.h"
 #include "util.h"
+#include "utiltime.h"
 #ifdef ENABLE_WALLET
 #include "wallet/db.h"
 #include "wallet/wallet.h"
@@ -36,6 +41,7 @@ extern void noui_connect();
 
 BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
 {
+        SHA256AutoDetect();
         ECC_Start();
         SetupEnvironment();
         SetupNetworking();
@@ -172,6 +178,31 @@ CTxMemPoolEntry TestMemPoolEntryHelper::FromTx(CMutableTransaction &tx, CTxMemPo
                            hasNoDependencies, inChainValue, spendsCoinbase, sigOpCount, lp);
 }
 
+CMasternode MakeTestMasternode(CKey& keyMasternode)
+{
+    CKey keyCollateral;
+    keyCollateral.MakeNewKey(true);
+    keyMasternode.MakeNewKey(true);
+    CMasternode mn(CService("127.0.0.1", 9671), CTxIn(COutPoint(GetRandHash(), 0)),
+                   keyCollateral.GetPubKey(), keyMasternode.GetPubKey(), PROTOCOL_VERSION);
+    mn.payeeAddress = CBitcoinAddress(keyCollateral.GetPubKey().GetID());
+    return mn;
+}
+
+void RemoveSpentMasternodes(CMasternodeMan& man)
+{
+    // CheckAndRemove only runs once the masternode list is synced
+    masternodeSync.Reset();
+    while (!masternodeSync.IsMasternodeListSynced())
+        masternodeSync.SwitchToNextAsset();
+    // It checks every masternode again first. Just after the epoch they all
+    // look checked a moment ago, so only the spent ones change.
+    SetMockTime(1);
+    man.CheckAndRemove();
+    SetMockTime(0);
+    masternodeSync.Reset();
+}
+
 void Shutdown(void* parg)
 {
   exit(0);
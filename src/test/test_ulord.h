@@ -89,4 +89,15 @@ struct TestMemPoolEntryHelper
     TestMemPoolEntryHelper &SpendsCoinbase(bool _flag) { spendsCoinbase = _flag; return *this; }
     TestMemPoolEntryHelper &SigOps(unsigned int _sigops) { sigOpCount = _sigops; return *this; }
 };
+
+class CMasternode;
+class CMasternodeMan;
+
+// A masternode with new keys and a random collateral outpoint, not in any list
+CMasternode MakeTestMasternode(CKey& keyMasternode);
+
+// Remove the masternodes marked MASTERNODE_OUTPOINT_SPENT from man through
+// CheckAndRemove, as the node does once their collateral is spent.
+// Clears the mock time.
+void RemoveSpentMasternodes(CMasternodeMan& man);
 #endif
@@ -15,6 +15,11 @@
 #include <stdint.h>
 #include <vector>
 
+#ifndef WIN32
+#include <signal.h>
+#endif
+
+#include <boost/filesystem/fstream.hpp>
 #include <boost/test/unit_test.hpp>
 
 using namespace std;
@@ -489,4 +494,66 @@ BOOST_AUTO_TEST_CASE(test_ParseFixedPoint)
     BOOST_CHECK(!ParseFixedPoint("1.", 8, &amount));
 }
 
+static std::string ReadDebugLog(const boost::filesystem::path& pathDebug)
+{
+    boost::filesystem::ifstream file(pathDebug);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+BOOST_FIXTURE_TEST_CASE(util_log_writer, TestingSetup)
+{
+#ifndef WIN32
+    // the writer installs crash handlers while it runs
+    struct sigaction saPrev;
+    BOOST_CHECK(sigaction(SIGSEGV, NULL, &saPrev) == 0);
+#endif
+    boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
+    bool fPrintToDebugLogPrev = fPrintToDebugLog;
+    fPrintToDebugLog = true;
+    OpenDebugLog();
+    // an hour between flushes and a large queue, so only the calls below write
+    StartLogWriter(60 * 60 * 1000, 1 << 20, true);
+
+    LogPrintf("util_log_writer first\n");
+    BOOST_CHECK(ReadDebugLog(pathDebug).find("util_log_writer first") == std::string::npos);
+    FlushDebugLog();
+    BOOST_CHECK(ReadDebugLog(pathDebug).find("util_log_writer first") != std::string::npos);
+
+    LogPrintf("util_log_writer second\n");
+    LogPrintf("util_log_writer third\n");
+    StopLogWriter();
+    std::string strLog = ReadDebugLog(pathDebug);
+    size_t nSecond = strLog.find("util_log_writer second");
+    BOOST_CHECK(nSecond != std::string::npos);
+    size_t nThird = strLog.find("util_log_writer third");
+    BOOST_CHECK(nThird != std::string::npos && nThird > nSecond);
+
+    // writes are synchronous again once the writer has stopped
+    LogPrintf("util_log_writer fourth\n");
+    BOOST_CHECK(ReadDebugLog(pathDebug).find("util_log_writer fourth") != std::string::npos);
+
+    // a second writer on a reopened log starts from an empty queue
+    CloseDebugLog();
+    OpenDebugLog();
+    StartLogWriter(60 * 60 * 1000, 1 << 20, true);
+#ifndef WIN32
+    struct sigaction saWriter;
+    BOOST_CHECK(sigaction(SIGSEGV, NULL, &saWriter) == 0);
+    BOOST_CHECK(saWriter.sa_handler != saPrev.sa_handler);
+#endif
+    LogPrintf("util_log_writer fifth\n");
+    FlushDebugLog();
+    strLog = ReadDebugLog(pathDebug);
+    BOOST_CHECK(strLog.find("util_log_writer fifth") != std::string::npos);
+    BOOST_CHECK(strLog.find("util_log_writer fifth") > strLog.find("util_log_writer fourth"));
+
+    CloseDebugLog();
+    fPrintToDebugLog = fPrintToDebugLogPrev;
+#ifndef WIN32
+    struct sigaction saAfter;
+    BOOST_CHECK(sigaction(SIGSEGV, NULL, &saAfter) == 0);
+    BOOST_CHECK(saAfter.sa_handler == saPrev.sa_handler);
+#endif
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -26,6 +26,7 @@ static const char DB_ADDRESSUNSPENTINDEX = 'u';
 static const char DB_TIMESTAMPINDEX = 's';
 static const char DB_SPENTINDEX = 'p';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_BLOCK_CHECKSUM = 'k';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_FLAG = 'F';
@@ -152,6 +153,8 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     batch.Write(DB_LAST_BLOCK, nLastFile);
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
         batch.Write(make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
+        if ((*it)->fHaveDataChecksum)
+            batch.Write(make_pair(DB_BLOCK_CHECKSUM, (*it)->GetBlockHash()), CDiskBlockChecksum(*it));
     }
     return WriteBatch(batch, true);
 }
@@ -348,5 +351,27 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
         }
     }
 
+    // Attach the checksums of stored blocks. One that no longer matches the
+    // position of the block (e.g. an older version stored it again) is
+    // ignored, and the block's proof of work is checked on read instead.
+    pcursor->Seek(make_pair(DB_BLOCK_CHECKSUM, uint256()));
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, uint256> key;
+        if (pcursor->GetKey(key) && key.first == DB_BLOCK_CHECKSUM) {
+            CDiskBlockChecksum checksum;
+            if (!pcursor->GetValue(checksum))
+                return error("LoadBlockIndex() : failed to read block checksum");
+            BlockMap::iterator mi = mapBlockIndex.find(key.second);
+            if (mi != mapBlockIndex.end() && checksum.Matches(mi->second)) {
+                mi->second->nDataChecksum = checksum.nChecksum;
+                mi->second->fHaveDataChecksum = true;
+            }
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+
     return true;
 }
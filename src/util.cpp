@@ -40,8 +40,10 @@
 
 #include <algorithm>
 #include <fcntl.h>
+#include <signal.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #else
 
@@ -209,11 +211,94 @@ static FILE* fileout = NULL;
 static boost::mutex* mutexDebugLog = NULL;
 static list<string> *vMsgsBeforeOpenLog;
 
+/**
+ * Background debug.log writer. While it runs, LogPrintStr() only appends the
+ * formatted line to vchLogQueue under mutexDebugLog and the writer thread does
+ * the file I/O, one write per batch. mutexLogWrite is held by whoever writes
+ * to fileout on behalf of the queue, so FlushDebugLog() can drain it in order.
+ * Lock order: mutexLogWrite before mutexDebugLog.
+ *
+ * Both buffers are allocated for nLogQueueMaxBytes up front and only swapped,
+ * so the queue doesn't move while lines are appended. pchLogCrash and
+ * nLogCrashBytes publish it to the crash signal handler, which can't lock.
+ */
+static boost::mutex mutexLogWrite;
+static boost::condition_variable condLogWriter; // wakes the writer thread
+static boost::condition_variable condLogSpace;  // wakes callers waiting for queue space
+static boost::thread* threadLogWriter = NULL;
+static std::vector<char> vchLogQueue;
+static std::vector<char> vchLogBatch; // taken from the queue, written under mutexLogWrite
+static size_t nLogQueueMaxBytes = 0;
+static const char* volatile pchLogCrash = NULL;
+static volatile size_t nLogCrashBytes = 0;
+static volatile int nLogCrashFd = -1;
+static uint64_t nLogDropped = 0;
+static int64_t nLogFlushInterval = 0;
+static bool fLogBlockOnOverflow = true;
+static bool fLogWriterRunning = false;
+static bool fLogWriterStop = false;
+
 static int FileWriteStr(const std::string &str, FILE *fp)
 {
     return fwrite(str.data(), 1, str.size(), fp);
 }
 
+static void ReopenDebugLogIfRequested()
+{
+    if (fReopenDebugLog) {
+        fReopenDebugLog = false;
+        boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
+        if (freopen(pathDebug.string().c_str(),"a",fileout) != NULL)
+            setbuf(fileout, NULL); // unbuffered
+        if (fLogWriterRunning)
+            nLogCrashFd = fileno(fileout);
+    }
+}
+
+/** Publish the queue to the crash handler. Caller holds mutexDebugLog. */
+static void PublishLogQueue()
+{
+    nLogCrashBytes = 0;
+    pchLogCrash = vchLogQueue.empty() ? NULL : &vchLogQueue[0];
+    nLogCrashBytes = vchLogQueue.size();
+}
+
+/** Append a line to the queue. Caller holds mutexDebugLog. */
+static void AppendLogQueue(const std::string& str)
+{
+    if (vchLogQueue.size() + str.size() > vchLogQueue.capacity()) {
+        // a line longer than the whole queue; hide the buffer while it moves
+        nLogCrashBytes = 0;
+        pchLogCrash = NULL;
+    }
+    vchLogQueue.insert(vchLogQueue.end(), str.begin(), str.end());
+    PublishLogQueue();
+}
+
+/** Move the queue to vchLogBatch. Caller holds mutexLogWrite and mutexDebugLog. */
+static void TakeLogQueue()
+{
+    nLogCrashBytes = 0;
+    vchLogQueue.swap(vchLogBatch);
+    vchLogQueue.clear();
+    PublishLogQueue();
+}
+
+/** Write vchLogBatch and empty it. Caller holds mutexLogWrite. */
+static void WriteLogBatch(uint64_t nDropped)
+{
+    if (nDropped > 0) {
+        std::string strDropped = strprintf("%s Log queue full: dropped %u messages\n", DateTimeStrFormat("%Y-%m-%d %H:%M:%S", GetTime()), nDropped);
+        vchLogBatch.insert(vchLogBatch.end(), strDropped.begin(), strDropped.end());
+    }
+
+    ReopenDebugLogIfRequested();
+    // fileout is unbuffered, so this is a single write for the whole batch.
+    if (!vchLogBatch.empty())
+        fwrite(&vchLogBatch[0], 1, vchLogBatch.size(), fileout);
+    vchLogBatch.clear();
+}
+
 static void DebugPrintInit()
 {
     assert(mutexDebugLog == NULL);
@@ -242,6 +327,19 @@ void OpenDebugLog()
     vMsgsBeforeOpenLog = NULL;
 }
 
+void CloseDebugLog()
+{
+    StopLogWriter();
+
+    boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+    boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+    if (fileout == NULL)
+        return;
+    fclose(fileout);
+    fileout = NULL;
+    vMsgsBeforeOpenLog = new list<string>;
+}
+
 bool LogAcceptCategory(const char* category)
 {
     if (category != NULL)
@@ -367,15 +465,33 @@ int LogPrintStr(const std::string &str)
             ret = strTimestamped.length();
             vMsgsBeforeOpenLog->push_back(strTimestamped);
         }
+        else if (fLogWriterRunning)
+        {
+            ret = strTimestamped.length();
+            // let a single oversized message through rather than wait forever
+            while (fLogWriterRunning && !vchLogQueue.empty() && vchLogQueue.size() + ret > nLogQueueMaxBytes) {
+                if (!fLogBlockOnOverflow) {
+                    nLogDropped++;
+                    return 0;
+                }
+                condLogWriter.notify_one();
+                condLogSpace.wait(scoped_lock);
+            }
+            if (fLogWriterRunning) {
+                AppendLogQueue(strTimestamped);
+                // wake the writer early once the queue is half full
+                if (vchLogQueue.size() >= nLogQueueMaxBytes / 2 && vchLogQueue.size() - ret < nLogQueueMaxBytes / 2)
+                    condLogWriter.notify_one();
+            } else {
+                // the writer stopped while we were waiting
+                ReopenDebugLogIfRequested();
+                ret = FileWriteStr(strTimestamped, fileout);
+            }
+        }
         else
         {
             // reopen the log file, if requested
-            if (fReopenDebugLog) {
-                fReopenDebugLog = false;
-                boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
-                if (freopen(pathDebug.string().c_str(),"a",fileout) != NULL)
-                    setbuf(fileout, NULL); // unbuffered
-            }
+            ReopenDebugLogIfRequested();
 
             ret = FileWriteStr(strTimestamped, fileout);
         }
@@ -383,6 +499,145 @@ int LogPrintStr(const std::string &str)
     return ret;
 }
 
+static void ThreadLogWriter()
+{
+    RenameThread("ulord-logwriter");
+
+    bool fStop = false;
+    while (!fStop) {
+        {
+            // Collect lines until the flush interval elapses, the queue is
+            // half full or we are asked to stop.
+            boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+            boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds(nLogFlushInterval);
+            while (!fLogWriterStop && vchLogQueue.size() < nLogQueueMaxBytes / 2) {
+                if (!condLogWriter.timed_wait(scoped_lock, deadline))
+                    break;
+            }
+        }
+
+        boost::mutex::scoped_lock write_lock(mutexLogWrite);
+        boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+        TakeLogQueue();
+        uint64_t nDropped = nLogDropped;
+        nLogDropped = 0;
+        fStop = fLogWriterStop;
+        if (fStop) {
+            // Final batch: write it before anyone can fall back to writing
+            // directly, so nothing is reordered or lost.
+            fLogWriterRunning = false;
+            nLogCrashFd = -1;
+            WriteLogBatch(nDropped);
+            condLogSpace.notify_all();
+            break;
+        }
+        scoped_lock.unlock();
+        condLogSpace.notify_all();
+
+        if (!vchLogBatch.empty() || nDropped > 0)
+            WriteLogBatch(nDropped);
+    }
+}
+
+#ifndef WIN32
+/** Fatal signals that would otherwise lose the queued lines; assert() and abort() raise SIGABRT */
+static const int LOG_CRASH_SIGNALS[] = { SIGABRT, SIGSEGV, SIGBUS, SIGFPE, SIGILL };
+static struct sigaction saLogCrashPrev[ARRAYLEN(LOG_CRASH_SIGNALS)];
+
+/**
+ * Write out whatever is still queued, then hand the signal to the previous
+ * handler. Only write(2) on the published queue, nothing that locks or
+ * allocates. Best effort: a batch the writer thread is in the middle of
+ * writing, or a line being appended, can still be lost.
+ */
+static void HandleLogCrashSignal(int nSignal)
+{
+    for (size_t i = 0; i < ARRAYLEN(LOG_CRASH_SIGNALS); i++)
+        sigaction(LOG_CRASH_SIGNALS[i], &saLogCrashPrev[i], NULL);
+    int fd = nLogCrashFd;
+    const char* pch = pchLogCrash;
+    size_t nBytes = nLogCrashBytes;
+    while (fd >= 0 && pch != NULL && nBytes > 0) {
+        ssize_t nWritten = write(fd, pch, nBytes);
+        if (nWritten <= 0)
+            break;
+        pch += nWritten;
+        nBytes -= nWritten;
+    }
+    raise(nSignal);
+}
+#endif
+
+void StartLogWriter(int64_t nFlushIntervalMs, size_t nMaxQueueBytes, bool fBlockOnOverflow)
+{
+    boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+    {
+        boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+        if (threadLogWriter != NULL || fileout == NULL || nFlushIntervalMs <= 0)
+            return;
+        nLogFlushInterval = nFlushIntervalMs;
+        nLogQueueMaxBytes = std::max(nMaxQueueBytes, (size_t)1);
+        fLogBlockOnOverflow = fBlockOnOverflow;
+        vchLogQueue.reserve(nLogQueueMaxBytes);
+        vchLogBatch.reserve(nLogQueueMaxBytes);
+        PublishLogQueue();
+        nLogCrashFd = fileno(fileout);
+        fLogWriterStop = false;
+        fLogWriterRunning = true;
+        threadLogWriter = new boost::thread(&ThreadLogWriter);
+    }
+
+    // Also drain the queue on exit paths that never reach Shutdown(),
+    // including a crash.
+    static bool fAtExitRegistered = false;
+    if (!fAtExitRegistered) {
+        fAtExitRegistered = true;
+        atexit(&StopLogWriter);
+    }
+#ifndef WIN32
+    struct sigaction sa;
+    sa.sa_handler = HandleLogCrashSignal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    for (size_t i = 0; i < ARRAYLEN(LOG_CRASH_SIGNALS); i++)
+        sigaction(LOG_CRASH_SIGNALS[i], &sa, &saLogCrashPrev[i]);
+#endif
+}
+
+void StopLogWriter()
+{
+    boost::thread* thread = NULL;
+    {
+        boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+        boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+        std::swap(thread, threadLogWriter);
+        if (thread == NULL)
+            return;
+        fLogWriterStop = true;
+        condLogWriter.notify_one();
+    }
+    thread->join();
+    delete thread;
+#ifndef WIN32
+    for (size_t i = 0; i < ARRAYLEN(LOG_CRASH_SIGNALS); i++)
+        sigaction(LOG_CRASH_SIGNALS[i], &saLogCrashPrev[i], NULL);
+#endif
+}
+
+void FlushDebugLog()
+{
+    boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+    boost::mutex::scoped_lock write_lock(mutexLogWrite);
+    boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+    if (!fLogWriterRunning || (vchLogQueue.empty() && nLogDropped == 0))
+        return;
+    TakeLogQueue();
+    uint64_t nDropped = nLogDropped;
+    nLogDropped = 0;
+    WriteLogBatch(nDropped);
+    condLogSpace.notify_all();
+}
+
 /** Interpret string as boolean, for argument parsing */
 static bool InterpretBool(const std::string& strValue)
 {
@@ -509,6 +764,7 @@ void PrintExceptionContinue(const std::exception* pex, const char* pszThread)
     std::string message = FormatException(pex, pszThread);
     LogPrintf("\n\n************************\n%s\n", message);
     fprintf(stderr, "\n\n************************\n%s\n", message.c_str());
+    FlushDebugLog();
 }
 
 boost::filesystem::path GetDefaultDataDir()
@@ -51,6 +51,9 @@ static const bool DEFAULT_LOGTIMEMICROS  = false;
 static const bool DEFAULT_LOGIPS         = false;
 static const bool DEFAULT_LOGTIMESTAMPS  = true;
 static const bool DEFAULT_LOGTHREADNAMES = false;
+static const int64_t DEFAULT_LOG_FLUSH_INTERVAL = 100;
+static const unsigned int DEFAULT_LOG_BUFFER_SIZE = 4096;
+static const bool DEFAULT_LOG_DROP_ON_OVERFLOW = false;
 
 /** Signals for translation. */
 class CTranslationInterface
@@ -158,6 +161,18 @@ boost::filesystem::path GetSpecialFolderPath(int nFolder, bool fCreate = true);
 #endif
 boost::filesystem::path GetTempPath();
 void OpenDebugLog();
+/** Stop the log writer and close debug.log, so OpenDebugLog() can be called again. */
+void CloseDebugLog();
+/**
+ * Hand debug.log writes to a background thread that writes the queued lines
+ * every nFlushIntervalMs milliseconds, or sooner once half of nMaxQueueBytes
+ * is queued. A full queue either blocks the logging thread or drops the line.
+ */
+void StartLogWriter(int64_t nFlushIntervalMs, size_t nMaxQueueBytes, bool fBlockOnOverflow);
+/** Write out everything still queued and go back to synchronous writes. */
+void StopLogWriter();
+/** Write out everything queued so far from the calling thread. */
+void FlushDebugLog();
 void ShrinkDebugFile();
 void runCommand(const std::string& strCommand);
 